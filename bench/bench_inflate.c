@@ -0,0 +1,152 @@
+/**
+ * Сравнение алгоритмов разжатия на наборе mat файлов
+ *
+ * Сборка (пример с libdeflate):
+ *  gcc -O2 -DI_MAT_USE_LIBDEFLATE -I.. bench_inflate.c ../i_mat.c -o bench_inflate -lgsl -lgslcblas -ldeflate -lz -lm
+ *
+ * Запуск:
+ *  ./bench_inflate [-n повторов] file1.mat file2.mat ...
+ *
+ * Для каждого собранного алгоритма все переменные каждого файла читаются n раз,
+ * печатается лучшее время чтения файла и ускорение относительно первого алгоритма.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "i_mat.h"
+
+static const char *backendNames[] = {"zlib", "zlib-ng", "libdeflate"};
+
+double nowSeconds(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/**
+ * Чтение переменной в подходящий по типу результат и его освобождение
+ */
+void readVar(IMatFile *matFile, const IMatVarInfo *info, IMatError *error)
+{
+    char *name = (char *)info->name;
+
+    switch (info->type)
+    {
+    case DT_INT:
+        readMatFileInt(matFile, name, error);
+        break;
+    case DT_INT_64:
+        readMatFileInt64(matFile, name, error);
+        break;
+    case DT_DOUBLE:
+        readMatFileDouble(matFile, name, error);
+        break;
+    case DT_COMPLEX:
+        readMatFileComplex(matFile, name, error);
+        break;
+    case DT_VECTOR:
+    case DT_VECTOR_INT:
+    case DT_MATRIX:
+    case DT_MATRIX_INT:
+    {
+        gsl_matrix *result = readMatFileMatrix(matFile, name, error);
+        if (result != NULL)
+            gsl_matrix_free(result);
+        break;
+    }
+    case DT_VECTOR_COMPLEX:
+    case DT_MATRIX_COMPLEX:
+    {
+        gsl_matrix_complex *result = readMatFileMatrixComplex(matFile, name, error);
+        if (result != NULL)
+            gsl_matrix_complex_free(result);
+        break;
+    }
+    default:
+        break;
+    }
+}
+
+/**
+ * Лучшее из repeats время чтения всех переменных файла, -1 при ошибке
+ */
+double benchFile(char *filePath, int repeats)
+{
+    double best = -1;
+
+    for (int r = 0; r < repeats; r++)
+    {
+        IMatError error;
+        double start = nowSeconds();
+
+        IMatFile *matFile = openMatFile(filePath, &error);
+        if (error.isErr)
+        {
+            fprintf(stderr, "%s: %s\n", filePath, error.stringErr);
+            return -1;
+        }
+
+        for (int i = 0; i < getMatFileVarsNumber(matFile) && !error.isErr; i++)
+            readVar(matFile, getMatFileVarInfo(matFile, i), &error);
+
+        closeMatFile(matFile);
+
+        if (error.isErr)
+        {
+            fprintf(stderr, "%s: %s\n", filePath, error.stringErr);
+            return -1;
+        }
+
+        double elapsed = nowSeconds() - start;
+        if (best < 0 || elapsed < best)
+            best = elapsed;
+    }
+
+    return best;
+}
+
+int main(int argc, char *argv[])
+{
+    int repeats = 5;
+    int firstFile = 1;
+
+    if (argc > 2 && strcmp(argv[1], "-n") == 0)
+    {
+        repeats = atoi(argv[2]);
+        firstFile = 3;
+    }
+
+    if (firstFile >= argc || repeats < 1)
+    {
+        fprintf(stderr, "usage: %s [-n repeats] file.mat ...\n", argv[0]);
+        return 1;
+    }
+
+    printf("%-40s %-12s %10s %8s\n", "file", "backend", "time, ms", "speedup");
+
+    for (int f = firstFile; f < argc; f++)
+    {
+        double baseline = -1;
+
+        for (int backend = IB_ZLIB; backend <= IB_LIBDEFLATE; backend++)
+        {
+            if (!setMatInflateBackend((enum EInflateBackend)backend))
+                continue;
+
+            double elapsed = benchFile(argv[f], repeats);
+            if (elapsed < 0)
+                return 1;
+
+            if (baseline < 0)
+                baseline = elapsed;
+
+            printf("%-40s %-12s %10.3f %7.2fx\n", argv[f], backendNames[backend], elapsed * 1e3, baseline / elapsed);
+        }
+    }
+
+    return 0;
+}
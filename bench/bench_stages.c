@@ -0,0 +1,502 @@
+/**
+ * Пропускная способность по стадиям чтения на наборе mat файлов (набор создает gen_corpus.c)
+ *
+ * Сборка:
+ *  gcc -O2 -I.. bench_stages.c ../i_mat.c -o bench_stages -lgsl -lgslcblas -lz -lm -lpthread
+ *
+ * Запуск:
+ *  ./bench_stages [-n повторов] [-o база.txt] [-b база.txt] file1.mat file2.mat ...
+ *
+ * Для каждого файла (первой переменной) измеряются стадии:
+ *  read      - чтение файла через fread (из кэша ОС после первого повтора)
+ *  inflate   - разжатие элемента через zlib (0 для несжатого элемента)
+ *  decode    - чтение переменной в порядке столбцов matlab (openMat*ColMajor) за вычетом read и inflate
+ *  transpose - перестановка матрицы в порядок gsl при чтении через openMat*, время берется из статистики
+ *              библиотеки (setMatStatsCallback). У чисел, векторов и пустых массивов стадии нет, у переменных,
+ *              которые читаются потоково (I_MAT_STREAM_THRESHOLD), она совмещена с decode - такие строки не печатаются
+ * Время стадии - лучшее из n повторов, короткие стадии повторяются в цикле не меньше 20 мс.
+ * Печатаются MB/s (read - по размеру файла, остальные - по размеру данных переменной) и ns на элемент
+ * (у пустого массива - на вызов). С -o результаты сохраняются в файл, с -b сравниваются с сохраненными ранее:
+ * speedup - во сколько раз стадия стала быстрее базы, в конце - среднее геометрическое по стадиям.
+ */
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <zlib.h>
+
+#include "i_mat.h"
+
+#define MI_COMPRESSED 15
+#define STAGES_NUMBER 4
+#define INFLATE_CHUNK_SIZE (256 << 10)
+#define MIN_REPEAT_SECONDS 20e-3
+
+static const char *stageNames[STAGES_NUMBER] = {"read", "inflate", "decode", "transpose"};
+
+/**
+ * Измеряемый файл
+ *
+ * filePath: char*            - путь
+ * fileName: char*            - имя без каталога (ключ в базе)
+ * type: EDataTypes           - тип первой переменной
+ * elemsNumber: size_t        - количество элементов переменной
+ * dataSize: size_t           - размер данных переменной в байтах
+ * contents: unsigned char*   - содержимое файла
+ * contentsSize: size_t       - размер файла
+ * inflateBuffer: unsigned char* - буфер для разжатых порций
+ */
+typedef struct
+{
+    char *filePath;
+    const char *fileName;
+    enum EDataTypes type;
+    size_t elemsNumber;
+    size_t dataSize;
+    unsigned char *contents;
+    size_t contentsSize;
+    unsigned char *inflateBuffer;
+} BenchFile;
+
+/**
+ * Запись базы: ns на элемент стадии файла
+ */
+typedef struct
+{
+    char fileName[256];
+    int stage;
+    double nsPerElement;
+} BaselineRecord;
+
+typedef int (*BenchStage)(BenchFile *bench, int argument);
+
+double nowSeconds(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/**
+ * Размер значения класса matlab в байтах
+ */
+int getClassSize(int matClass)
+{
+    switch (matClass)
+    {
+    case 8:
+    case 9:
+        return 1;
+    case 10:
+    case 11:
+        return 2;
+    case 7:
+    case 12:
+    case 13:
+        return 4;
+    default:
+        return 8;
+    }
+}
+
+/**
+ * Стадия read: файл целиком в bench->contents
+ */
+int readStage(BenchFile *bench, int argument)
+{
+    (void)argument;
+
+    FILE *file = fopen(bench->filePath, "rb");
+    if (file == NULL)
+        return 0;
+
+    int isRead = 1;
+
+    if (bench->contents == NULL)
+    {
+        isRead = fseek(file, 0, SEEK_END) == 0;
+        long size = isRead ? ftell(file) : -1;
+        isRead = size >= 0 && fseek(file, 0, SEEK_SET) == 0;
+
+        bench->contentsSize = isRead ? (size_t)size : 0;
+        bench->contents = (unsigned char *)malloc(bench->contentsSize + 1);
+    }
+
+    isRead = isRead && bench->contents != NULL && fread(bench->contents, 1, bench->contentsSize, file) == bench->contentsSize;
+    fclose(file);
+
+    return isRead;
+}
+
+/**
+ * Стадия inflate: разжатие первого элемента файла порциями (результат не сохраняется)
+ */
+int inflateStage(BenchFile *bench, int argument)
+{
+    (void)argument;
+
+    if (bench->contentsSize < 136 || bench->contents[128] != MI_COMPRESSED)
+        return 1;
+
+    uint32_t compressedSize;
+    memcpy(&compressedSize, &bench->contents[132], 4);
+    if (compressedSize > bench->contentsSize - 136)
+        return 0;
+
+    z_stream strm;
+    memset(&strm, 0, sizeof(strm));
+    if (inflateInit(&strm) != Z_OK)
+        return 0;
+
+    strm.next_in = &bench->contents[136];
+    strm.avail_in = compressedSize;
+
+    int status;
+    do
+    {
+        strm.next_out = bench->inflateBuffer;
+        strm.avail_out = INFLATE_CHUNK_SIZE;
+        status = inflate(&strm, Z_NO_FLUSH);
+    } while (status == Z_OK);
+
+    inflateEnd(&strm);
+
+    return status == Z_STREAM_END;
+}
+
+/**
+ * Чтение переменной файла библиотекой в подходящий по типу результат и его освобождение
+ *
+ * isColMajor: 1 - в порядке столбцов matlab (без транспонирования), 0 - обычное чтение
+ */
+int loadStage(BenchFile *bench, int isColMajor)
+{
+    IMatError error;
+
+    switch (bench->type)
+    {
+    case DT_INT:
+        openMatInt(bench->filePath, &error);
+        break;
+    case DT_INT_64:
+        openMatInt64(bench->filePath, &error);
+        break;
+    case DT_DOUBLE:
+        openMatDouble(bench->filePath, &error);
+        break;
+    case DT_COMPLEX:
+        openMatComplex(bench->filePath, &error);
+        break;
+    case DT_VECTOR:
+    case DT_VECTOR_INT:
+    case DT_MATRIX:
+    case DT_MATRIX_INT:
+    case DT_EMPTY:
+    {
+        gsl_matrix *result = isColMajor ? openMatMatrixColMajor(bench->filePath, &error) : openMatMatrix(bench->filePath, &error);
+        if (result != NULL)
+            gsl_matrix_free(result);
+        break;
+    }
+    case DT_VECTOR_COMPLEX:
+    case DT_MATRIX_COMPLEX:
+    {
+        gsl_matrix_complex *result =
+            isColMajor ? openMatMatrixComplexColMajor(bench->filePath, &error) : openMatMatrixComplex(bench->filePath, &error);
+        if (result != NULL)
+            gsl_matrix_complex_free(result);
+        break;
+    }
+    default:
+        fprintf(stderr, "%s: unsupported type\n", bench->filePath);
+        return 0;
+    }
+
+    if (error.isErr)
+        fprintf(stderr, "%s: %s\n", bench->filePath, error.stringErr);
+
+    return !error.isErr;
+}
+
+/**
+ * Лучшее из repeats время одного выполнения стадии в секундах, -1 при ошибке
+ */
+double timeStage(BenchStage stage, BenchFile *bench, int argument, int repeats)
+{
+    // Первый вызов прогревает кэш ОС и определяет, сколько раз повторять стадию в одном замере
+    double start = nowSeconds();
+    if (!stage(bench, argument))
+        return -1;
+
+    double once = nowSeconds() - start;
+    long iterations = once < MIN_REPEAT_SECONDS ? (long)(MIN_REPEAT_SECONDS / (once > 1e-9 ? once : 1e-9)) + 1 : 1;
+    double best = -1;
+
+    for (int r = 0; r < repeats; r++)
+    {
+        start = nowSeconds();
+
+        for (long i = 0; i < iterations; i++)
+            if (!stage(bench, argument))
+                return -1;
+
+        double elapsed = (nowSeconds() - start) / iterations;
+        if (best < 0 || elapsed < best)
+            best = elapsed;
+    }
+
+    return best;
+}
+
+/**
+ * Обработчик статистики: время транспонирования последнего чтения в ns
+ */
+void collectTransposeTime(const IMatStats *stats, void *opaque)
+{
+    *(uint64_t *)opaque = stats->transposeNs;
+}
+
+/**
+ * Лучшее из repeats время транспонирования при чтении переменной в gsl матрицу в секундах
+ *
+ * Возвращаемое значение: 0, если библиотека не транспонировала отдельно (потоковое чтение), -1 при ошибке
+ */
+double timeTranspose(BenchFile *bench, int repeats)
+{
+    uint64_t transposeNs = 0;
+    double best = -1;
+
+    setMatStatsCallback(collectTransposeTime, &transposeNs);
+
+    // Первое чтение прогревает кэш ОС, как и в timeStage
+    int isLoaded = loadStage(bench, 0);
+
+    for (int r = 0; r < repeats && isLoaded; r++)
+    {
+        isLoaded = loadStage(bench, 0);
+
+        if (best < 0 || transposeNs * 1e-9 < best)
+            best = transposeNs * 1e-9;
+    }
+
+    setMatStatsCallback(NULL, NULL);
+
+    return isLoaded ? best : -1;
+}
+
+/**
+ * Описание первой переменной файла: тип, количество элементов и размер данных
+ */
+int describeBenchFile(BenchFile *bench)
+{
+    IMatError error;
+
+    IMatFile *matFile = openMatFile(bench->filePath, &error);
+    if (error.isErr)
+    {
+        fprintf(stderr, "%s: %s\n", bench->filePath, error.stringErr);
+        return 0;
+    }
+
+    if (getMatFileVarsNumber(matFile) == 0)
+    {
+        fprintf(stderr, "%s: no variables\n", bench->filePath);
+        closeMatFile(matFile);
+        return 0;
+    }
+
+    const IMatVarInfo *info = getMatFileVarInfo(matFile, 0);
+    int isComplex = info->type == DT_COMPLEX || info->type == DT_VECTOR_COMPLEX || info->type == DT_MATRIX_COMPLEX;
+
+    bench->type = info->type;
+    bench->elemsNumber = (size_t)info->sizeI * (size_t)info->sizeJ;
+    bench->dataSize = bench->elemsNumber * getClassSize(info->matClass) * (isComplex ? 2 : 1);
+
+    closeMatFile(matFile);
+
+    return 1;
+}
+
+/**
+ * Чтение базы, сохраненной через -o: строки "файл стадия ns_на_элемент"
+ */
+BaselineRecord *loadBaseline(const char *path, int *recordsNumber)
+{
+    FILE *file = fopen(path, "r");
+    if (file == NULL)
+        return NULL;
+
+    BaselineRecord *records = NULL;
+    int capacity = 0;
+    char stageName[32];
+    BaselineRecord record;
+
+    *recordsNumber = 0;
+
+    while (fscanf(file, "%255s %31s %lf", record.fileName, stageName, &record.nsPerElement) == 3)
+    {
+        record.stage = -1;
+        for (int s = 0; s < STAGES_NUMBER; s++)
+            if (strcmp(stageName, stageNames[s]) == 0)
+                record.stage = s;
+
+        if (record.stage < 0)
+            continue;
+
+        if (*recordsNumber == capacity)
+        {
+            capacity = capacity ? capacity * 2 : 64;
+            records = (BaselineRecord *)realloc(records, sizeof(BaselineRecord) * capacity);
+        }
+        records[(*recordsNumber)++] = record;
+    }
+
+    fclose(file);
+
+    return records;
+}
+
+/**
+ * ns на элемент стадии файла из базы, -1 если записи нет
+ */
+double findBaseline(const BaselineRecord *records, int recordsNumber, const char *fileName, int stage)
+{
+    for (int i = 0; i < recordsNumber; i++)
+        if (records[i].stage == stage && strcmp(records[i].fileName, fileName) == 0)
+            return records[i].nsPerElement;
+
+    return -1;
+}
+
+int main(int argc, char *argv[])
+{
+    int repeats = 5;
+    const char *baselinePath = NULL, *outputPath = NULL;
+    int firstFile = 1;
+
+    for (; firstFile + 1 < argc && argv[firstFile][0] == '-'; firstFile += 2)
+    {
+        if (strcmp(argv[firstFile], "-n") == 0)
+            repeats = atoi(argv[firstFile + 1]);
+        else if (strcmp(argv[firstFile], "-b") == 0)
+            baselinePath = argv[firstFile + 1];
+        else if (strcmp(argv[firstFile], "-o") == 0)
+            outputPath = argv[firstFile + 1];
+        else
+            break;
+    }
+
+    if (firstFile >= argc || repeats < 1)
+    {
+        fprintf(stderr, "usage: %s [-n repeats] [-o baseline.txt] [-b baseline.txt] file.mat ...\n", argv[0]);
+        return 1;
+    }
+
+    int recordsNumber = 0;
+    BaselineRecord *records = NULL;
+    if (baselinePath != NULL && (records = loadBaseline(baselinePath, &recordsNumber)) == NULL)
+    {
+        fprintf(stderr, "%s: unable to read baseline\n", baselinePath);
+        return 1;
+    }
+
+    FILE *output = outputPath != NULL ? fopen(outputPath, "w") : NULL;
+    if (outputPath != NULL && output == NULL)
+    {
+        fprintf(stderr, "%s: unable to write baseline\n", outputPath);
+        return 1;
+    }
+
+    // Сумма логарифмов ускорения по стадиям для среднего геометрического
+    double logSpeedup[STAGES_NUMBER] = {0};
+    int comparedNumber[STAGES_NUMBER] = {0};
+
+    printf("%-36s %-10s %10s %10s", "file", "stage", "MB/s", "ns/elem");
+    if (records != NULL)
+        printf(" %12s %8s", "base ns/elem", "speedup");
+    printf("\n");
+
+    unsigned char *inflateBuffer = (unsigned char *)malloc(INFLATE_CHUNK_SIZE);
+
+    for (int f = firstFile; f < argc; f++)
+    {
+        BenchFile bench = {.filePath = argv[f], .inflateBuffer = inflateBuffer};
+        const char *slash = strrchr(argv[f], '/');
+        bench.fileName = slash != NULL ? slash + 1 : argv[f];
+
+        if (!describeBenchFile(&bench))
+            return 1;
+
+        double readTime = timeStage(readStage, &bench, 0, repeats);
+        double inflateTime = readTime < 0 ? -1 : 0;
+
+        // У несжатого элемента стадии inflate нет
+        if (readTime >= 0 && bench.contentsSize >= 136 && bench.contents[128] == MI_COMPRESSED)
+            inflateTime = timeStage(inflateStage, &bench, 0, repeats);
+        double colMajorTime = inflateTime < 0 ? -1 : timeStage(loadStage, &bench, 1, repeats);
+        double transposeTime = colMajorTime < 0 ? -1 : 0;
+
+        // Транспонируются только матрицы: числа, векторы и пустые массивы читаются как есть
+        if (colMajorTime >= 0 && (bench.type == DT_MATRIX || bench.type == DT_MATRIX_INT || bench.type == DT_MATRIX_COMPLEX))
+            transposeTime = timeTranspose(&bench, repeats);
+
+        free(bench.contents);
+
+        if (transposeTime < 0)
+        {
+            fprintf(stderr, "%s: benchmark failed\n", argv[f]);
+            return 1;
+        }
+
+        double stageTimes[STAGES_NUMBER] = {readTime, inflateTime, fmax(colMajorTime - readTime - inflateTime, 0), transposeTime};
+        double elemsNumber = bench.elemsNumber > 0 ? (double)bench.elemsNumber : 1;
+
+        for (int s = 0; s < STAGES_NUMBER; s++)
+        {
+            // Стадии transpose нет - в таблицу, базу и среднее она не попадает
+            if (s == 3 && transposeTime == 0)
+                continue;
+
+            double bytes = s == 0 ? (double)bench.contentsSize : (double)bench.dataSize;
+            double nsPerElement = stageTimes[s] * 1e9 / elemsNumber;
+
+            printf("%-36s %-10s ", bench.fileName, stageNames[s]);
+            if (bytes > 0 && stageTimes[s] > 0)
+                printf("%10.1f", bytes / stageTimes[s] / 1e6);
+            else
+                printf("%10s", "-");
+            printf(" %10.3f", nsPerElement);
+
+            double baseline = findBaseline(records, recordsNumber, bench.fileName, s);
+            if (records != NULL && baseline > 0 && nsPerElement > 0)
+            {
+                printf(" %12.3f %7.2fx", baseline, baseline / nsPerElement);
+                logSpeedup[s] += log(baseline / nsPerElement);
+                comparedNumber[s]++;
+            }
+            printf("\n");
+
+            if (output != NULL)
+                fprintf(output, "%s %s %.6f\n", bench.fileName, stageNames[s], nsPerElement);
+        }
+    }
+
+    if (records != NULL)
+    {
+        printf("\nspeedup vs %s (geometric mean):", baselinePath);
+        for (int s = 0; s < STAGES_NUMBER; s++)
+            if (comparedNumber[s] > 0)
+                printf(" %s %.2fx", stageNames[s], exp(logSpeedup[s] / comparedNumber[s]));
+        printf("\n");
+    }
+
+    free(inflateBuffer);
+    free(records);
+    if (output != NULL)
+        fclose(output);
+
+    return 0;
+}
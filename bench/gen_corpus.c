@@ -0,0 +1,315 @@
+/**
+ * Генератор синтетического набора mat файлов (MAT v5) для bench_stages
+ *
+ * Сборка:
+ *  gcc -O2 gen_corpus.c -o gen_corpus -lz -lm
+ *
+ * Запуск:
+ *  ./gen_corpus [-s размер1,размер2,...] [-l уровень1,уровень2,...] каталог
+ *
+ * В каждом файле одна переменная x. Перебираются все классы, которые читает библиотека (double, single,
+ * int8..uint64, complex double), формы (скаляр, строка, столбец, квадратная, высокая, широкая матрицы, пустой массив;
+ * int64 и uint64 - только скаляр и пустой массив),
+ * количества элементов (по умолчанию 1000,100000,1000000) и уровни сжатия (по умолчанию 0,1,6,9; 0 - элемент без сжатия).
+ * Файл называется класс_форма_элементы_lуровень.mat, например int16_tall_100000_l6.mat.
+ * Данные - гладкий сигнал с шумом, поэтому сжимаются примерно как реальные измерения.
+ */
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <zlib.h>
+
+#define MI_INT8 1
+#define MI_INT32 5
+#define MI_UINT32 6
+#define MI_MATRIX 14
+#define MI_COMPRESSED 15
+
+#define ARRAY_FLAG_COMPLEX 0x0800
+
+#define MAX_SIZES 16
+#define MAX_LEVELS 10
+
+/**
+ * Класс массива matlab
+ *
+ * name: char*       - имя в названии файла
+ * matClass: int     - класс (mxDOUBLE_CLASS = 6 и т.д.)
+ * dataType: int     - тип данных элемента (miDOUBLE = 9 и т.д.)
+ * typeSize: int     - размер значения в байтах
+ * isComplex: int    - комплексный массив
+ * isFloat: int      - вещественный тип
+ * isSigned: int     - знаковый целый тип
+ * isScalarOnly: int - библиотека читает только скаляры этого класса (int64, uint64)
+ */
+typedef struct
+{
+    const char *name;
+    int matClass;
+    int dataType;
+    int typeSize;
+    int isComplex;
+    int isFloat;
+    int isSigned;
+    int isScalarOnly;
+} CorpusClass;
+
+static const CorpusClass corpusClasses[] = {
+    {"double", 6, 9, 8, 0, 1, 1, 0},  {"single", 7, 7, 4, 0, 1, 1, 0},  {"int8", 8, 1, 1, 0, 0, 1, 0},   {"uint8", 9, 2, 1, 0, 0, 0, 0},
+    {"int16", 10, 3, 2, 0, 0, 1, 0},  {"uint16", 11, 4, 2, 0, 0, 0, 0}, {"int32", 12, 5, 4, 0, 0, 1, 0}, {"uint32", 13, 6, 4, 0, 0, 0, 0},
+    {"int64", 14, 12, 8, 0, 0, 1, 1}, {"uint64", 15, 13, 8, 0, 0, 0, 1}, {"complex", 6, 9, 8, 1, 1, 1, 0},
+};
+
+// Формы массива: размеры вычисляются по количеству элементов в shapeDims
+static const char *shapeNames[] = {"scalar", "row", "col", "square", "tall", "wide", "empty"};
+
+enum
+{
+    SHAPES_NUMBER = sizeof(shapeNames) / sizeof(shapeNames[0])
+};
+
+/**
+ * Размеры массива формы shape примерно из elemsNumber элементов
+ */
+void shapeDims(int shape, long elemsNumber, long *sizeI, long *sizeJ)
+{
+    long side = (long)sqrt((double)elemsNumber);
+
+    switch (shape)
+    {
+    case 0:
+        *sizeI = *sizeJ = 1;
+        break;
+    case 1:
+        *sizeI = 1;
+        *sizeJ = elemsNumber;
+        break;
+    case 2:
+        *sizeI = elemsNumber;
+        *sizeJ = 1;
+        break;
+    case 3:
+        *sizeI = *sizeJ = side > 0 ? side : 1;
+        break;
+    case 4:
+        *sizeJ = 8;
+        *sizeI = elemsNumber / 8 > 0 ? elemsNumber / 8 : 1;
+        break;
+    case 5:
+        *sizeI = 8;
+        *sizeJ = elemsNumber / 8 > 0 ? elemsNumber / 8 : 1;
+        break;
+    default:
+        *sizeI = *sizeJ = 0;
+        break;
+    }
+}
+
+void writeInt32(unsigned char *data, uint32_t value)
+{
+    memcpy(data, &value, 4);
+}
+
+/**
+ * Значение index-го элемента: синусоида в четверть диапазона класса и небольшой шум
+ */
+void fillValue(const CorpusClass *corpusClass, long index, int isImag, unsigned char *destination)
+{
+    static uint32_t seed = 12345;
+    seed = seed * 1664525u + 1013904223u;
+
+    double noise = (double)(seed >> 24) / 256.0 - 0.5;
+    double wave = sin(index * 0.001 + isImag) * 0.5;
+
+    if (corpusClass->isFloat)
+    {
+        double value = wave * 1000.0 + noise;
+
+        if (corpusClass->typeSize == 8)
+            memcpy(destination, &value, 8);
+        else
+        {
+            float floatValue = (float)value;
+            memcpy(destination, &floatValue, 4);
+        }
+        return;
+    }
+
+    // Амплитуда - четверть диапазона, шум - до 1/64 амплитуды
+    double amplitude = corpusClass->typeSize >= 4 ? 1e6 : ldexp(1.0, corpusClass->typeSize * 8 - 2);
+    double value = wave * amplitude + noise * amplitude / 32.0;
+    if (!corpusClass->isSigned)
+        value += amplitude * 2.0;
+
+    int64_t integer = (int64_t)llround(value);
+    memcpy(destination, &integer, corpusClass->typeSize);
+}
+
+/**
+ * Элемент miMATRIX с переменной x заданного класса и размеров
+ */
+unsigned char *buildMatrix(const CorpusClass *corpusClass, long sizeI, long sizeJ, size_t *elementLength)
+{
+    size_t elemsNumber = (size_t)sizeI * (size_t)sizeJ;
+    size_t dataSize = elemsNumber * corpusClass->typeSize;
+    size_t paddedSize = (dataSize + 7) & ~(size_t)7;
+    size_t length = 8 + 16 + 16 + 8 + (8 + paddedSize) * (corpusClass->isComplex ? 2 : 1);
+
+    unsigned char *element = (unsigned char *)calloc(length, 1);
+    if (element == NULL)
+        return NULL;
+
+    // Тег, флаги массива, размеры и имя в коротком формате
+    writeInt32(&element[0], MI_MATRIX);
+    writeInt32(&element[4], (uint32_t)(length - 8));
+    writeInt32(&element[8], MI_UINT32);
+    writeInt32(&element[12], 8);
+    writeInt32(&element[16], (uint32_t)corpusClass->matClass | (corpusClass->isComplex ? ARRAY_FLAG_COMPLEX : 0));
+    writeInt32(&element[24], MI_INT32);
+    writeInt32(&element[28], 8);
+    writeInt32(&element[32], (uint32_t)sizeI);
+    writeInt32(&element[36], (uint32_t)sizeJ);
+    writeInt32(&element[40], (1u << 16) | MI_INT8);
+    element[44] = 'x';
+
+    size_t position = 48;
+    for (int part = 0; part < (corpusClass->isComplex ? 2 : 1); part++)
+    {
+        writeInt32(&element[position], (uint32_t)corpusClass->dataType);
+        writeInt32(&element[position + 4], (uint32_t)dataSize);
+        position += 8;
+
+        for (size_t k = 0; k < elemsNumber; k++)
+            fillValue(corpusClass, (long)k, part, &element[position + k * corpusClass->typeSize]);
+
+        position += paddedSize;
+    }
+
+    *elementLength = length;
+    return element;
+}
+
+/**
+ * Запись mat файла с одним элементом, level 0 - без сжатия
+ */
+int writeCorpusFile(const char *filePath, const unsigned char *element, size_t elementLength, int level)
+{
+    FILE *file = fopen(filePath, "wb");
+    if (file == NULL)
+        return 0;
+
+    unsigned char header[128];
+    memset(header, ' ', 116);
+    memcpy(header, "MATLAB 5.0 MAT-file, i_mat benchmark corpus", 43);
+    memset(&header[116], 0, 8);
+    header[124] = 0x00;
+    header[125] = 0x01;
+    header[126] = 'I';
+    header[127] = 'M';
+
+    int isWritten = fwrite(header, 128, 1, file) == 1;
+
+    if (level == 0)
+        isWritten = isWritten && fwrite(element, elementLength, 1, file) == 1;
+    else
+    {
+        uLongf compressedLength = compressBound((uLong)elementLength);
+        unsigned char *compressed = (unsigned char *)malloc(8 + compressedLength);
+
+        isWritten = isWritten && compressed != NULL && compress2(&compressed[8], &compressedLength, element, (uLong)elementLength, level) == Z_OK;
+        if (isWritten)
+        {
+            writeInt32(&compressed[0], MI_COMPRESSED);
+            writeInt32(&compressed[4], (uint32_t)compressedLength);
+            isWritten = fwrite(compressed, 8 + compressedLength, 1, file) == 1;
+        }
+
+        free(compressed);
+    }
+
+    return fclose(file) == 0 && isWritten;
+}
+
+/**
+ * Разбор списка чисел через запятую, возвращает количество чисел
+ */
+int parseList(char *text, long *values, int maxValues)
+{
+    int number = 0;
+
+    for (char *item = strtok(text, ","); item != NULL && number < maxValues; item = strtok(NULL, ","))
+        values[number++] = atol(item);
+
+    return number;
+}
+
+int main(int argc, char *argv[])
+{
+    long sizes[MAX_SIZES] = {1000, 100000, 1000000};
+    long levels[MAX_LEVELS] = {0, 1, 6, 9};
+    int sizesNumber = 3, levelsNumber = 4;
+    int arg = 1;
+
+    for (; arg + 1 < argc && argv[arg][0] == '-'; arg += 2)
+    {
+        if (strcmp(argv[arg], "-s") == 0)
+            sizesNumber = parseList(argv[arg + 1], sizes, MAX_SIZES);
+        else if (strcmp(argv[arg], "-l") == 0)
+            levelsNumber = parseList(argv[arg + 1], levels, MAX_LEVELS);
+        else
+            break;
+    }
+
+    if (arg != argc - 1 || sizesNumber == 0 || levelsNumber == 0)
+    {
+        fprintf(stderr, "usage: %s [-s sizes] [-l levels] directory\n", argv[0]);
+        return 1;
+    }
+
+    int filesNumber = 0;
+
+    for (size_t c = 0; c < sizeof(corpusClasses) / sizeof(corpusClasses[0]); c++)
+        for (int shape = 0; shape < SHAPES_NUMBER; shape++)
+            for (int s = 0; s < sizesNumber; s++)
+            {
+                // Скаляр и пустой массив не зависят от размера
+                int isSized = shape != 0 && shape != SHAPES_NUMBER - 1;
+                if ((!isSized && s > 0) || (isSized && corpusClasses[c].isScalarOnly))
+                    continue;
+
+                long sizeI, sizeJ;
+                shapeDims(shape, sizes[s], &sizeI, &sizeJ);
+
+                size_t elementLength;
+                unsigned char *element = buildMatrix(&corpusClasses[c], sizeI, sizeJ, &elementLength);
+                if (element == NULL)
+                {
+                    fprintf(stderr, "out of memory\n");
+                    return 1;
+                }
+
+                for (int l = 0; l < levelsNumber; l++)
+                {
+                    char filePath[4096];
+                    snprintf(filePath, sizeof(filePath), "%s/%s_%s_%ld_l%ld.mat", argv[arg], corpusClasses[c].name, shapeNames[shape],
+                             sizeI * sizeJ, levels[l]);
+
+                    if (!writeCorpusFile(filePath, element, elementLength, (int)levels[l]))
+                    {
+                        fprintf(stderr, "%s: write failed\n", filePath);
+                        free(element);
+                        return 1;
+                    }
+                    filesNumber++;
+                }
+
+                free(element);
+            }
+
+    printf("%d files written to %s\n", filesNumber, argv[arg]);
+
+    return 0;
+}
@@ -1,61 +1,744 @@
 #include <complex.h>
 #include <math.h>
+#include <stdarg.h>
+#include <stdatomic.h>
+#include <stddef.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// Файлы-спутники индексов и кэш декодированных переменных
+#include <sys/stat.h>
+#include <unistd.h>
+#include <utime.h>
+
+// Вытеснение из кэша просматривает каталог через glob (dirent.h объявляет свой DT_UNKNOWN)
+#if defined(__unix__) || defined(__APPLE__)
+#define I_MAT_USE_CACHE_EVICTION
+#include <glob.h>
+#endif
+
+// Потоковый inflate и сжатие при записи: zlib или нативный API zlib-ng (-DI_MAT_USE_ZLIB_NG)
+#ifdef I_MAT_USE_ZLIB_NG
+#include <zlib-ng.h>
+#define z_stream zng_stream
+#define inflateInit zng_inflateInit
+#define inflate zng_inflate
+#define inflateEnd zng_inflateEnd
+#define inflateReset zng_inflateReset
+#define inflateInit2 zng_inflateInit2
+#define inflatePrime zng_inflatePrime
+#define inflateSetDictionary zng_inflateSetDictionary
+#define deflateInit2 zng_deflateInit2
+#define deflate zng_deflate
+#define deflateEnd zng_deflateEnd
+#define deflateBound zng_deflateBound
+#define adler32 zng_adler32
+#define adler32_combine zng_adler32_combine
+#else
 #include <zlib.h>
-
-// #include <libdeflate.h>
+#endif
+
+// Разжатие элемента целиком в буфер известного размера через libdeflate (-DI_MAT_USE_LIBDEFLATE)
+#ifdef I_MAT_USE_LIBDEFLATE
+#include <libdeflate.h>
+#endif
+
+// Отображение файла в память вместо fread, отключается через -DI_MAT_NO_MMAP
+#if !defined(I_MAT_NO_MMAP) && (defined(__unix__) || defined(__APPLE__))
+#define I_MAT_USE_MMAP
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+// Чтение MAT v7.3 (HDF5) файлов, включается через -DI_MAT_USE_HDF5
+#ifdef I_MAT_USE_HDF5
+#include <hdf5.h>
+#endif
+
+// Пул потоков для пакетного чтения, отключается через -DI_MAT_NO_THREADS (задачи выполняются последовательно)
+#ifndef I_MAT_NO_THREADS
+#include <pthread.h>
+#include <unistd.h>
+#endif
+
+// Чтение файлов для openMatAsync через io_uring, включается через -DI_MAT_USE_URING (только Linux)
+#if defined(I_MAT_USE_URING) && !defined(__linux__)
+#undef I_MAT_USE_URING
+#endif
+#ifdef I_MAT_USE_URING
+#include <errno.h>
+#include <fcntl.h>
+#include <liburing.h>
+#endif
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+// Декодеры последовательностей выбираются во время выполнения по возможностям процессора (SSE2/AVX2)
+#if defined(__GNUC__) && defined(__x86_64__) && defined(__SSE2__)
+#define I_MAT_X86_DISPATCH
+#include <immintrin.h>
+#endif
 
 #include <gsl/gsl_matrix.h>
 #include <gsl/gsl_vector.h>
 
-enum EDataTypes
-{
-    DT_INT,
-    DT_INT_64,
-    DT_DOUBLE,
-    DT_COMPLEX,
-    DT_VECTOR,
-    DT_VECTOR_INT,
-    DT_VECTOR_COMPLEX,
-    DT_MATRIX,
-    DT_MATRIX_INT,
-    DT_MATRIX_COMPLEX,
-    DT_EMPTY
-};
+#include "i_mat.h"
+
+// Тип элемента верхнего уровня со сжатыми данными
+#define MI_COMPRESSED 15
+// Тип элемента с матрицей
+#define MI_MATRIX 14
+// Версия в заголовке mat файла: v5 (элементы miMATRIX/miCOMPRESSED) и v7.3 (HDF5 со смещением 512 байт)
+#define MAT_VERSION_5 0x0100
+#define MAT_VERSION_73 0x0200
+// Классы массивов matlab: вложенные массивы (разбираются в дерево) и создаваемые при записи
+#define MX_CELL_CLASS 1
+#define MX_STRUCT_CLASS 2
+#define MX_OBJECT_CLASS 3
+#define MX_SPARSE_CLASS 5
+#define MX_DOUBLE_CLASS 6
+#define MX_INT32_CLASS 12
+#define MX_INT64_CLASS 14
+// Флаги массива во втором байте подэлемента флагов
+#define ARRAY_FLAG_COMPLEX (1 << 3)
+#define ARRAY_FLAG_LOGICAL (1 << 1)
+// Сколько байт разжимать при индексации, чтобы получить флаги, размеры и имя переменной
+#define VAR_HEADER_PREFIX_SIZE 512
+// Наибольшая вложенность struct и cell массивов при разборе дерева
+#define MAX_NODE_DEPTH 128
+
+// Элементы от этого размера (в разжатом виде) разжимаются порциями сразу в результирующий gsl объект
+#ifndef I_MAT_STREAM_THRESHOLD
+#define I_MAT_STREAM_THRESHOLD (16 << 20)
+#endif
+// Размер порции при потоковом разжатии
+#define STREAM_CHUNK_SIZE (256 << 10)
+// Размер одного чтения и количество чтений в очереди io_uring при фоновой загрузке (openMatAsync)
+#define ASYNC_READ_SIZE (4 << 20)
+#define ASYNC_QUEUE_DEPTH 16
+// Наибольшее окно входа и выхода inflate: avail_in и avail_out у zlib 32-битные
+#ifndef I_MAT_INFLATE_WINDOW
+#define I_MAT_INFLATE_WINDOW 0xFFFFFFFFu
+#endif
+
+// Расстояние между контрольными точками индекса сжатого элемента (по разжатым данным)
+#ifndef I_MAT_CHECKPOINT_SPAN
+#define I_MAT_CHECKPOINT_SPAN (16 << 20)
+#endif
+
+// Окно deflate, которое сохраняется в каждой контрольной точке
+#define CHECKPOINT_WINDOW_SIZE 32768
+
+#define SIDECAR_MAGIC "IMATZIX1"
+
+#define CACHE_MAGIC "IMATCAC3"
+#define CACHE_FILE_SUFFIX ".imc"
+
+// Наносекунды времени изменения файла (в macOS поле struct stat называется st_mtimespec)
+#ifdef __APPLE__
+#define STAT_MTIME_NS(fileStat) ((fileStat).st_mtimespec.tv_nsec)
+#else
+#define STAT_MTIME_NS(fileStat) ((fileStat).st_mtim.tv_nsec)
+#endif
+#define CACHE_HASH_BASIS 0xcbf29ce484222325ULL
+
+// Размер блока элемента, который сжимается отдельной задачей пула потоков при записи
+#ifndef I_MAT_DEFLATE_BLOCK_SIZE
+#define I_MAT_DEFLATE_BLOCK_SIZE (1 << 20)
+#endif
+
+// Сторона квадратного блока при транспонировании из порядка matlab (по столбцам) в порядок gsl (по строкам)
+#define TRANSPOSE_BLOCK 32
+// Начиная с этого количества элементов транспонирование распараллеливается через OpenMP (при сборке с -fopenmp)
+#ifndef I_MAT_PARALLEL_TRANSPOSE_MIN
+#define I_MAT_PARALLEL_TRANSPOSE_MIN (1 << 20)
+#endif
+// Распараллеливание цикла по блокам строк транспонирования (sizeI x sizeJ), без -fopenmp - обычный цикл
+#ifdef _OPENMP
+#define TRANSPOSE_PARALLEL_FOR _Pragma("omp parallel for schedule(static) if ((size_t)sizeI * sizeJ >= I_MAT_PARALLEL_TRANSPOSE_MIN)")
+#else
+#define TRANSPOSE_PARALLEL_FOR
+#endif
+
+static const char *dataTypeNames[] = {"INT",          "INT_64",         "DOUBLE",       "COMPLEX",
+                                      "VECTOR",       "VECTOR_INT",     "VECTOR_COMPLEX", "MATRIX",
+                                      "MATRIX_INT",   "MATRIX_COMPLEX", "SPARSE",       "SPARSE_COMPLEX",
+                                      "VECTOR_FLOAT", "VECTOR_COMPLEX_FLOAT", "MATRIX_FLOAT", "MATRIX_COMPLEX_FLOAT",
+                                      "ARRAY",        "STRUCT",         "CELL",         "EMPTY",
+                                      "UNKNOWN"};
+
+// Текущий алгоритм разжатия, по умолчанию - самый быстрый из собранных
+#ifdef I_MAT_USE_LIBDEFLATE
+static enum EInflateBackend inflateBackend = IB_LIBDEFLATE;
+#elif defined(I_MAT_USE_ZLIB_NG)
+static enum EInflateBackend inflateBackend = IB_ZLIB_NG;
+#else
+static enum EInflateBackend inflateBackend = IB_ZLIB;
+#endif
+
+// Сохранять индексы контрольных точек в файлы-спутники рядом с mat файлом
+static int isIndexSidecarEnabled = 0;
+
+// Каталог кэша декодированных переменных (NULL - кэш выключен) и его предельный размер (0 - без ограничения)
+static char *matCacheDir = NULL;
+static size_t matCacheMaxBytes = 0;
+
+// Контекст чтения, привязанный к потоку (setMatReader)
+static _Thread_local IMatReader *threadReader = NULL;
+
+// Обработчик статистики чтений (setMatStatsCallback), NULL - статистика не собирается
+static IMatStatsCallback statsCallback = NULL;
+static void *statsOpaque = NULL;
 
-static const char *dataTypeNames[] = {"INT",    "INT_64",     "DOUBLE",         "COMPLEX", "VECTOR", "VECTOR_INT", "VECTOR_COMPLEX",
-                                      "MATRIX", "MATRIX_INT", "MATRIX_COMPLEX", "EMPTY",   "UNKNOWN"};
+/**
+ * Контрольная точка сжатого потока: с нее можно начать разжатие, не разжимая поток с начала
+ *
+ * in, out - смещения в сжатом и разжатом потоке, bits - сколько бит байта in - 1 еще не прочитано,
+ * window - последние 32 KB разжатых данных перед точкой (словарь deflate)
+ */
+typedef struct
+{
+    uint64_t in;
+    uint64_t out;
+    int bits;
+    unsigned char window[CHECKPOINT_WINDOW_SIZE];
+} InflateCheckpoint;
 
 typedef struct
 {
-    int isErr;
-    char stringErr[264];
-} IMatError;
+    int pointsNumber;
+    InflateCheckpoint *points;
+} CheckpointIndex;
+
+/**
+ * Открытый mat файл с индексом переменных верхнего уровня
+ */
+struct IMatFile
+{
+    FILE *file;
+    char *filePath;
+    // Содержимое файла, уже прочитанное в память (openMatAsync): элементы берутся прямо из него, file не открыт
+    unsigned char *contents;
+    size_t contentsSize;
+    int varsNumber;
+    IMatVarInfo *vars;
+    // Индексы контрольных точек сжатых элементов, строятся при первом чтении области
+    CheckpointIndex **indexes;
+#ifndef I_MAT_NO_THREADS
+    // Защищает положение в file, когда элемент читается через fread (без mmap), и indexes
+    pthread_mutex_t lock;
+#endif
+#ifdef I_MAT_USE_HDF5
+    // Для v7.3 файла вместо file открыт HDF5 файл
+    hid_t h5File;
+#endif
+};
 
 typedef struct
 {
-    char name[40];
+    char name[64];
     enum EDataTypes type;
     int sizeI;
     int sizeJ;
     int64_t *dataInt;
+    int *dataInt32;
     double *dataDouble;
+    float *dataFloat;
     unsigned char *zipData;
+    size_t zipSize;
+    // Тип, который ожидает вызывающая функция, и результат потокового разжатия
+    enum EDataTypes target;
+    void *result;
+    // Матрица возвращается в порядке столбцов matlab (gsl матрица размера sizeJ x sizeI) без транспонирования
+    int columnMajor;
+    // Класс matlab и размеры N-мерного массива (sizeJ - произведение размеров со второго)
+    int matClass;
+    int dimsNumber;
+    int dims[I_MAT_MAX_DIMS];
 } ElmementInfo;
 
+/**
+ * Тип, в который декодируется последовательность из mat файла
+ */
+enum EDecodeTarget
+{
+    DECODE_INT,
+    DECODE_INT_64,
+    DECODE_DOUBLE,
+    DECODE_FLOAT
+};
+
+typedef void (*DecodeKernel)(void *destination, const unsigned char *byteSeq, size_t size);
+
+/**
+ * Набор независимых задач для пула потоков: потоки забирают номера задач из общего счетчика
+ */
+typedef struct
+{
+    void (*task)(void *context, int index);
+    void *context;
+    int tasksNumber;
+    atomic_int nextTask;
+    atomic_int nextWorker;
+} ParallelJob;
+
+// Номер потока пула внутри runParallel (0..threadsNumber-1): по нему задачи выбирают свои ресурсы
+static _Thread_local int parallelWorkerIndex = 0;
+
+/**
+ * Элемент, который сжимается блоками в пуле потоков при записи
+ */
+typedef struct
+{
+    const unsigned char *data;
+    size_t dataSize;
+    size_t blockSize;
+    int blocksNumber;
+    int level;
+    unsigned char **blocks;
+    size_t *blockLengths;
+    uint32_t *checksums;
+    atomic_int failed;
+} DeflateJob;
+
+/**
+ * Доступ к элементу файла: отображение в память или буфер, прочитанный через fread
+ */
+typedef struct
+{
+    void *data;
+    size_t length;
+    int isMapped;
+} ElementMapping;
+
+/**
+ * Буферы контекста чтения
+ */
+enum EScratchSlot
+{
+    // Элемент, прочитанный через fread, и элемент, разжатый целиком
+    SCRATCH_ELEMENT,
+    SCRATCH_INFLATE,
+    // Порция потокового разжатия
+    SCRATCH_CHUNK,
+    // Промежуточные массивы handleMatrixElement
+    SCRATCH_DOUBLE,
+    SCRATCH_INT32,
+    SCRATCH_INT64,
+    SCRATCH_FLOAT,
+    SCRATCH_SLOTS_NUMBER
+};
+
+/**
+ * Контекст чтения: z_stream, который сбрасывается вместо повторной инициализации, и растущие буферы
+ */
+struct IMatReader
+{
+    IMatAllocator allocator;
+    z_stream strm;
+    int isStreamReady;
+    // z_stream уже используется (например, при вложенном разжатии) - следующий запрос получит временный поток
+    int isStreamBusy;
+#ifdef I_MAT_USE_LIBDEFLATE
+    struct libdeflate_decompressor *decompressor;
+#endif
+    void *scratch[SCRATCH_SLOTS_NUMBER];
+    size_t scratchSize[SCRATCH_SLOTS_NUMBER];
+};
+
+/**
+ * Фоновая загрузка переменной: файл читается в contents (через io_uring или в фоновом потоке),
+ * затем переменная декодируется из памяти в фоновом потоке
+ */
+struct IMatAsync
+{
+    IMatBatchItem *item;
+    IMatAsyncCallback callback;
+    void *opaque;
+    // Заголовок файла (128 байт) и следом элемент переменной, который лежит в файле с elementOffset
+    unsigned char *contents;
+    size_t contentsSize;
+    off_t elementOffset;
+#ifdef I_MAT_USE_URING
+    struct io_uring ring;
+    int isRingReady;
+    int fd;
+    // Сколько байт уже поставлено в очередь, сколько прочитано и сколько чтений еще не завершилось
+    size_t submittedSize;
+    size_t readSize;
+    int pendingReads;
+#endif
+#ifndef I_MAT_NO_THREADS
+    pthread_t thread;
+    int isThreadStarted;
+#endif
+    atomic_int isFinished;
+};
+
+// Сколько промежуточных буферов одного чтения отслеживается для peakScratchBytes
+#define STATS_SCRATCH_SLOTS 8
+
+/**
+ * Статистика текущего чтения потока: обработчик, время начала и занятые промежуточные буферы
+ */
+typedef struct
+{
+    IMatStats stats;
+    IMatStatsCallback callback;
+    void *opaque;
+    uint64_t start;
+    void *scratch[STATS_SCRATCH_SLOTS];
+    size_t scratchSize[STATS_SCRATCH_SLOTS];
+    size_t scratchBytes;
+} MatStatsState;
+
+// Статистика чтения, которое сейчас выполняет поток (NULL - не собирается)
+static _Thread_local MatStatsState *threadStats = NULL;
+
+// Замер стадии для setMatStatsCallback: без обработчика - только проверка указателя
+#define STATS_START() (threadStats != NULL ? getNanoseconds() : 0)
+#define STATS_ADD(field, start)                                                                                                   \
+    do                                                                                                                            \
+    {                                                                                                                             \
+        if (threadStats != NULL)                                                                                                  \
+            threadStats->stats.field += getNanoseconds() - (start);                                                               \
+    } while (0)
+#define STATS_COUNT(field, value)                                                                                                 \
+    do                                                                                                                            \
+    {                                                                                                                             \
+        if (threadStats != NULL)                                                                                                  \
+            threadStats->stats.field += (value);                                                                                  \
+    } while (0)
+
+/**
+ * Дерево struct или cell переменной
+ *
+ * Несжатый элемент остается отображенным в память (mapping), сжатый разжимается целиком в data.
+ * Узлы хранят только смещения подэлементов в data
+ */
+struct IMatTree
+{
+    unsigned char *data;
+    size_t length;
+    int isCompressed;
+    ElementMapping mapping;
+    IMatNode root;
+};
+
+/**
+ * Поток столбцов матрицы: элемент читается из файла и разжимается порциями по мере продвижения по столбцам,
+ * в памяти только блок столбцов, порция входных данных и состояние zlib
+ */
+struct IMatColumnStream
+{
+    IMatFile *matFile;
+    // Файл открыт openMatColumnStream и закрывается вместе с потоком
+    int isOwnFile;
+    int sizeI;
+    int sizeJ;
+    int blockColumns;
+    int dataTypeCode;
+    int byteInElem;
+    int isCompressed;
+    z_stream strm;
+    int isStreamReady;
+    // Еще не прочитанная часть элемента в файле и порция сжатых данных
+    long inputOffset;
+    size_t inputLeft;
+    unsigned char *input;
+    // Начало элемента, разжатое (или прочитанное) вместе с заголовком: данные с headerStart отдаются первыми
+    unsigned char header[VAR_HEADER_PREFIX_SIZE];
+    int headerStart;
+    int headerLength;
+    // Блок столбцов в типе файла (не нужен для miDOUBLE) и в double
+    unsigned char *raw;
+    double *block;
+    // Столбцы текущего блока и следующий столбец, который еще не возвращен
+    int blockStart;
+    int blockLength;
+    int column;
+};
+
+/**
+ * Заголовок файла кэша: ключ (до size1), размеры результата, класс и размеры переменной для статистики
+ */
+typedef struct
+{
+    char magic[8];
+    uint64_t keyHash;
+    int64_t fileSize;
+    int64_t fileTime;
+    int64_t fileTimeNs;
+    int64_t fileInode;
+    int32_t target;
+    int32_t columnMajor;
+    uint64_t size1;
+    uint64_t size2;
+    int32_t matClass;
+    int32_t dimsNumber;
+    int32_t dims[I_MAT_MAX_DIMS];
+} MatCacheHeader;
+
+/**
+ * Запись кэша для одного чтения: путь к файлу кэша и ожидаемый заголовок
+ */
+typedef struct
+{
+    int isActive;
+    char path[4096];
+    MatCacheHeader header;
+} MatCacheEntry;
+
+typedef struct
+{
+    char *path;
+    size_t size;
+    int64_t accessTime;
+} CacheFileInfo;
+
+#ifdef I_MAT_USE_HDF5
+/**
+ * Датасет v7.3 файла в терминах miMATRIX элемента
+ */
+typedef struct
+{
+    int matClass;
+    int isLogical;
+    int isEmpty;
+    int isComplex;
+    int dataTypeCode;
+    int typeSize;
+    int sizeI;
+    int sizeJ;
+} H5DatasetInfo;
+
+/**
+ * Сырые чанки области датасета, которые разжимаются в пуле потоков прямо в данные элемента
+ */
+typedef struct
+{
+    int chunksNumber;
+    unsigned char **chunks;
+    hsize_t *chunkSizes;
+    unsigned int *filterMasks;
+    // Смещения чанков (столбец, строка) в HDF5 массиве, по два на чанк
+    hsize_t *offsets;
+    hsize_t chunkDims[2];
+    int isDeflated;
+    int typeSize;
+    int isComplex;
+    int row0;
+    int rows;
+    int col0;
+    int cols;
+    unsigned char *realData;
+    unsigned char *imagData;
+    atomic_int failed;
+#ifdef I_MAT_USE_LIBDEFLATE
+    // По декомпрессору libdeflate на поток пула, создаются при первом чанке потока
+    struct libdeflate_decompressor **decompressors;
+#endif
+} H5ChunkJob;
+
+#ifndef I_MAT_NO_THREADS
+static pthread_mutex_t h5Lock = PTHREAD_MUTEX_INITIALIZER;
+#endif
+#endif
+
 void cleanError(IMatError *error);
 void setError(IMatError *error, const char *format, ...);
 
-void openMatEngine(char *filePath, ElmementInfo *eInfo, IMatError *error);
-
-void handleMatHeader(FILE *file, IMatError *error);
+void openMatEngine(char *filePath, ElmementInfo *eInfo, MatStatsState *stats, IMatError *error);
+void openMatFileEngine(IMatFile *matFile, char *name, ElmementInfo *eInfo, MatStatsState *stats, IMatError *error);
+void readMatEngine(char *filePath, ElmementInfo *eInfo, IMatError *error);
+void readMatFileEngine(IMatFile *matFile, char *name, ElmementInfo *eInfo, IMatError *error);
+void beginMatStats(MatStatsState *state, char *filePath, char *name);
+void finishMatStats(MatStatsState *state, const void *result, IMatError *error);
+void trackScratch(void *data, size_t size, int isAllocated);
+void untrackScratch(void *data);
+void *allocateCountedState(void *opaque, unsigned int items, unsigned int size);
+void releaseCountedState(void *opaque, void *address);
+uint64_t getNanoseconds(void);
+void freeElementInfo(ElmementInfo *eInfo);
+void freeElementResult(ElmementInfo *eInfo);
+int describeCacheEntry(char *filePath, const char *name, ElmementInfo *eInfo, MatCacheEntry *entry);
+int readCachedResult(MatCacheEntry *entry, ElmementInfo *eInfo);
+void writeCachedResult(MatCacheEntry *entry, ElmementInfo *eInfo, IMatError *error);
+void *convertElementToResult(ElmementInfo *eInfo, IMatError *error);
+void *allocateCacheResult(enum EDataTypes target, size_t size1, size_t size2, void **data, size_t *dataLength);
+const void *describeCacheResult(enum EDataTypes target, const void *result, uint64_t *size1, uint64_t *size2, size_t *dataLength);
+void evictCachedResults(void);
+int compareCacheFiles(const void *left, const void *right);
+uint64_t hashCacheKey(uint64_t hash, const void *data, size_t length);
+
+typedef void (*ParallelTask)(void *context, int index);
+void runParallel(ParallelTask task, void *context, int tasksNumber, int threadsNumber);
+void *parallelWorker(void *arg);
+int getProcessorsNumber(void);
+void readBatchItem(void *context, int index);
+void readFileBatchItem(void *context, int index);
+void readBatchItemFrom(IMatFile *matFile, IMatBatchItem *item);
+void *loadMatAsync(void *arg);
+int readAsyncContents(IMatAsync *request);
+int prepareAsyncContents(IMatAsync *request, int fd);
+int locateAsyncElement(int fd, const char *name, unsigned char *header, off_t *elementOffset, size_t *elementLength);
+void decodeAsyncContents(IMatAsync *request);
+#ifdef I_MAT_USE_URING
+int startAsyncReads(IMatAsync *request);
+int submitAsyncReads(IMatAsync *request);
+int finishAsyncReads(IMatAsync *request);
+#endif
+
+IMatFile *allocateMatFile(char *filePath);
+IMatFile *openMatContents(char *filePath, unsigned char *contents, size_t contentsSize, IMatError *error);
+int handleMatHeader(FILE *file, IMatError *error);
+int checkMatHeader(const unsigned char *header, IMatError *error);
+unsigned char *allocateMatrixElement(const char *name, int matClass, int arrayFlags, int sizeI, int sizeJ, int dataTypeCode, int typeSize,
+                                     unsigned char **realData, unsigned char **imagData, size_t *elementLength, IMatError *error);
+int buildMatrixElementHeader(unsigned char *element, const char *name, int matClass, int arrayFlags, int sizeI, int sizeJ, int dataTypeCode,
+                             uint32_t dataByteSize, uint32_t elementSize);
+void saveMatEngine(char *filePath, unsigned char *element, size_t elementLength, int level, IMatError *error);
+int writeMatHeader(FILE *file);
+int writeCompressedElement(FILE *file, const unsigned char *element, size_t elementLength, int level, IMatError *error);
+void deflateBlock(void *context, int index);
+void gatherDouble(double *destination, const double *source, size_t tda, int sizeI, int sizeJ);
+void gatherInt(int *destination, const int *source, size_t tda, int sizeI, int sizeJ);
+void gatherComplex(double *realDestination, double *imagDestination, const double *source, size_t tda, int sizeI, int sizeJ);
 void handleElement(FILE *file, IMatError *error, ElmementInfo *eInfo);
-void handleIntSequence(int64_t *destinationArray, unsigned char *intDataInByteSeq, int byteInInt, int size, int isSigned);
-void handleDoubleSequence(double *destinationArray, unsigned char *doubleDataInByteSeq, int size);
-void uncompressElement(IMatError *error, ElmementInfo *eInfo);
-int decompressData(const unsigned char *compressed_data, int compressed_size, unsigned char **uncompressed_data, int *uncompressed_size);
+void handleElementAt(IMatFile *matFile, const IMatVarInfo *varInfo, IMatError *error, ElmementInfo *eInfo);
+void initElementInfo(ElmementInfo *eInfo);
+const unsigned char *acquireElementData(IMatFile *matFile, const IMatVarInfo *varInfo, int isSequential, ElementMapping *mapping, IMatError *error);
+void releaseElementData(ElementMapping *mapping);
+#ifdef I_MAT_USE_MMAP
+int isFileRangeAvailable(int fd, long offset, size_t length);
+#endif
+void parseMatNode(IMatTree *tree, IMatNode *node, size_t offset, int depth, IMatError *error);
+void *allocateScratch(enum EScratchSlot slot, size_t size);
+void releaseScratch(void *data);
+z_stream *acquireInflateStream(z_stream *localStream);
+void releaseInflateStream(z_stream *strm);
+void *allocateInflateState(void *opaque, unsigned int items, unsigned int size);
+void releaseInflateState(void *opaque, void *address);
+void *allocateDefault(void *opaque, size_t size);
+void releaseDefault(void *opaque, void *data);
+long parseNodeTag(const unsigned char *data, size_t position, size_t length, int *dataTypeCode, size_t *byteSize);
+void freeMatNode(IMatNode *node);
+gsl_matrix *readElementSubMatrix(IMatFile *matFile, int varIndex, int row0, int rows, int col0, int cols, IMatError *error);
+IMatArray *readElementPages(IMatFile *matFile, int varIndex, int page0, int pages, IMatError *error);
+unsigned char *readElementColumns(IMatFile *matFile, int varIndex, enum EDataTypes target, int row0, int rows, int col0, int cols, int *dataTypeCode,
+                                  IMatError *error);
+int inflateColumns(const unsigned char *compressedData, size_t compressedSize, CheckpointIndex *index, size_t start, size_t stride,
+                   size_t columnLength, int cols, unsigned char *block);
+const InflateCheckpoint *findCheckpoint(CheckpointIndex *index, uint64_t offset);
+IMatColumnStream *createColumnStream(IMatFile *matFile, const IMatVarInfo *varInfo, int blockColumns, IMatError *error);
+int fillColumnBlock(IMatColumnStream *stream, IMatError *error);
+int pullColumnStream(IMatColumnStream *stream, unsigned char *destination, size_t size);
+int inflateColumnStream(IMatColumnStream *stream, unsigned char *destination, size_t size, size_t *produced);
+size_t readColumnStreamInput(IMatColumnStream *stream, unsigned char *destination, size_t size);
+int inflateFromCheckpoint(z_stream *strm, const unsigned char *compressedData, size_t compressedSize, const InflateCheckpoint *point);
+CheckpointIndex *getCheckpointIndex(IMatFile *matFile, int varIndex, const unsigned char *compressedData, size_t compressedSize, IMatError *error);
+CheckpointIndex *buildCheckpointIndex(const unsigned char *compressedData, size_t compressedSize, IMatError *error);
+void addCheckpoint(CheckpointIndex *index, int bits, uint64_t in, uint64_t out, const unsigned char *window, int left);
+void freeCheckpointIndex(CheckpointIndex *index);
+CheckpointIndex *loadCheckpointIndex(char *sidecarPath, char *filePath, const IMatVarInfo *varInfo);
+void saveCheckpointIndex(char *sidecarPath, char *filePath, const IMatVarInfo *varInfo, CheckpointIndex *index);
+uint32_t checksumCheckpoints(CheckpointIndex *index);
+void fillSidecarHeader(int64_t *header, char *filePath, const IMatVarInfo *varInfo);
+#ifdef I_MAT_USE_HDF5
+void lockH5(void);
+void unlockH5(void);
+void openMatH5Engine(char *filePath, ElmementInfo *eInfo, IMatError *error);
+void openMatH5File(IMatFile *matFile, char *filePath, IMatError *error);
+void closeMatH5File(IMatFile *matFile);
+int getMatH5VarName(hid_t file, hsize_t linkIndex, char *name);
+void handleH5VarInfo(hid_t file, IMatVarInfo *varInfo);
+void readH5ClassAttribute(hid_t object, H5DatasetInfo *info);
+void describeH5Dataset(hid_t dataset, H5DatasetInfo *info, IMatError *error);
+int selectH5DataCode(hid_t type);
+hid_t selectH5NativeType(int dataTypeCode);
+void readMatH5Variable(hid_t file, char *name, ElmementInfo *eInfo, IMatError *error);
+void readMatH5Region(hid_t file, const char *name, int row0, int rows, int col0, int cols, ElmementInfo *eInfo, IMatError *error);
+unsigned char *readH5Dataset(hid_t dataset, const char *name, int row0, int rows, int col0, int cols, H5ChunkJob *job, size_t *elementLength,
+                             IMatError *error);
+int collectH5Chunks(hid_t dataset, H5ChunkJob *job);
+int getH5ArrayFlags(H5DatasetInfo *info);
+void decodeH5Chunk(void *context, int index);
+int inflateH5Chunk(H5ChunkJob *job, const unsigned char *compressedData, size_t compressedSize, unsigned char *chunk, size_t chunkBytes);
+int readH5Hyperslab(hid_t dataset, H5DatasetInfo *info, int row0, int rows, int col0, int cols, unsigned char *realData, unsigned char *imagData);
+#endif
+void handleMatrixElement(IMatError *error, ElmementInfo *eInfo);
+int handleMatrixHeader(unsigned char *matrixData, size_t length, IMatVarInfo *varInfo, int *isComplex, IMatError *error);
+void handleVarInfo(FILE *file, int elementType, size_t elementSize, IMatVarInfo *varInfo, IMatError *error);
+void handleVarData(int elementType, size_t elementSize, const unsigned char *data, size_t available, IMatVarInfo *varInfo, IMatError *error);
+void handleSequence(void *destination, enum EDecodeTarget target, const unsigned char *byteSeq, int dataTypeCode, size_t size);
+DecodeKernel selectDecodeKernel(int dataTypeCode, enum EDecodeTarget target);
+enum EDecodeTarget selectDecodeTarget(enum EDataTypes target, int isComplex, int dataTypeCode);
+int isNumericDataCode(int dataTypeCode);
+unsigned char *locateSequence(ElmementInfo *eInfo, size_t startIndex, int64_t expectedSize, int *dataTypeCode, size_t *length, IMatError *error);
+void handleElementData(FILE *file, int elementType, size_t elementSize, IMatError *error, ElmementInfo *eInfo);
+void decodeElement(IMatError *error, ElmementInfo *eInfo, const unsigned char *element, size_t elementSize);
+void decodeMatrixElement(IMatError *error, ElmementInfo *eInfo, const unsigned char *element, size_t elementLength);
+void decodeCompressedElement(IMatError *error, ElmementInfo *eInfo, const unsigned char *compressedData, size_t compressedSize);
+void streamElement(IMatError *error, ElmementInfo *eInfo, const unsigned char *compressedData, size_t compressedSize);
+int streamSequence(z_stream *strm, unsigned char *chunk, unsigned char *tagField, void *destination, ElmementInfo *eInfo, int isImagPart);
+void scatterSequence(void *destination, unsigned char *byteSeq, int dataTypeCode, size_t start, size_t count, ElmementInfo *eInfo, int isImagPart);
+void *allocateElementResult(ElmementInfo *eInfo);
+void handleSparseElement(IMatError *error, ElmementInfo *eInfo, int dataStartIndex, int isComplex);
+int streamSparseData(z_stream *strm, unsigned char *chunk, unsigned char *tagField, ElmementInfo *eInfo, int isComplex);
+int streamSparseSequence(z_stream *strm, unsigned char *chunk, unsigned char *tagField, void *destination, enum EDecodeTarget target, int step,
+                         size_t expectedCount);
+void scatterSparseSequence(void *destination, enum EDecodeTarget target, int step, const unsigned char *byteSeq, int dataTypeCode, size_t start,
+                           size_t count);
+size_t getSequenceCount(unsigned char *tagField);
+int allocateSparseResult(ElmementInfo *eInfo, size_t nzmax, int **rowIndices, int **columnPointers, double **values);
+void finishSparseResult(IMatError *error, ElmementInfo *eInfo);
+int inflateExactly(z_stream *strm, unsigned char *destination, size_t size);
+int isTypeCompatible(enum EDataTypes target, enum EDataTypes type);
+int isDenseTarget(enum EDataTypes target);
+int isMatrixTarget(enum EDataTypes target);
+int isFloatTarget(enum EDataTypes target);
+void uncompressElement(IMatError *error, ElmementInfo *eInfo, const unsigned char *compressedData, size_t compressedSize);
+int decompressData(const unsigned char *compressed_data, size_t compressed_size, unsigned char **uncompressed_data, size_t *uncompressed_size,
+                   int isScratch);
+int inflateWindows(z_stream *strm, unsigned char *destination, size_t size, size_t *pendingInput);
+int decompressPrefix(const unsigned char *compressedData, size_t compressedSize, unsigned char *prefix, int prefixSize);
+#ifdef I_MAT_USE_LIBDEFLATE
+int decompressDataLibdeflate(const unsigned char *compressedData, size_t compressedSize, unsigned char **uncompressedData, size_t *uncompressedSize,
+                              int isScratch);
+#endif
+
+int convertElementToInt(ElmementInfo *eInfo, IMatError *error);
+int64_t convertElementToInt64(ElmementInfo *eInfo, IMatError *error);
+double convertElementToDouble(ElmementInfo *eInfo, IMatError *error);
+complex double convertElementToComplex(ElmementInfo *eInfo, IMatError *error);
+gsl_vector *convertElementToVector(ElmementInfo *eInfo, IMatError *error);
+gsl_vector_int *convertElementToVectorInt(ElmementInfo *eInfo, IMatError *error);
+gsl_vector_complex *convertElementToVectorComplex(ElmementInfo *eInfo, IMatError *error);
+gsl_matrix *convertElementToMatrix(ElmementInfo *eInfo, IMatError *error);
+gsl_matrix_int *convertElementToMatrixInt(ElmementInfo *eInfo, IMatError *error);
+gsl_matrix_complex *convertElementToMatrixComplex(ElmementInfo *eInfo, IMatError *error);
+gsl_vector_float *convertElementToVectorFloat(ElmementInfo *eInfo, IMatError *error);
+gsl_vector_complex_float *convertElementToVectorComplexFloat(ElmementInfo *eInfo, IMatError *error);
+gsl_matrix_float *convertElementToMatrixFloat(ElmementInfo *eInfo, IMatError *error);
+gsl_matrix_complex_float *convertElementToMatrixComplexFloat(ElmementInfo *eInfo, IMatError *error);
+gsl_spmatrix *convertElementToSpMatrix(ElmementInfo *eInfo, IMatError *error);
+IMatArray *convertElementToArray(ElmementInfo *eInfo, IMatError *error);
+IMatArray *allocateMatArray(int dimsNumber, const int *dims);
+void transposeArrayPages(IMatArray *array, const double *source);
+gsl_spmatrix_complex *convertElementToSpMatrixComplex(ElmementInfo *eInfo, IMatError *error);
+
+void transposeDouble(double *destination, size_t tda, const double *source, int sizeI, int sizeJ);
+void transposeInt(int *destination, size_t tda, const int *source, int sizeI, int sizeJ);
+void transposeComplex(double *destination, size_t tda, const double *source, int sizeI, int sizeJ);
+void transposeFloat(float *destination, size_t tda, const float *source, int sizeI, int sizeJ);
+void transposeComplexFloat(float *destination, size_t tda, const float *source, int sizeI, int sizeJ);
 
 int64_t readFromByteInt64(unsigned char *byteSeq);
 int readFromByteInt32(unsigned char *byteSeq);
@@ -63,11 +746,10 @@ int readFromByteInt16(unsigned char *byteSeq);
 int readFromByteInt8(unsigned char *byteSeq);
 
 uint64_t readFromByteUInt64(unsigned char *byteSeq);
-int readFromByteUInt32(unsigned char *byteSeq);
+uint32_t readFromByteUInt32(unsigned char *byteSeq);
 int readFromByteUInt16(unsigned char *byteSeq);
 int readFromByteUInt8(unsigned char *byteSeq);
 
-int64_t readFromByteWithOffset(unsigned char *byteSeq, int byteInInt, int isSigned);
 int calculateByteSizeFromMatDataCode(int dataType);
 enum EDataTypes decideType(int sizeI, int sizeJ, int isComplex, int typeCode);
 char *getDataTypeName(enum EDataTypes dataType);
@@ -76,685 +758,7780 @@ int openMatInt(char *filePath, IMatError *error)
 {
     cleanError(error);
 
-    ElmementInfo eInfo;
+    ElmementInfo eInfo = {.target = DT_INT};
+    MatStatsState stats;
 
-    openMatEngine(filePath, &eInfo, error);
-    if (error->isErr)
-        return 0;
-
-    if (eInfo.type != DT_INT)
-    {
-        setError(error, "Got error while reading %s. Expected %s, but readed %s", eInfo.name, getDataTypeName(DT_INT),
-                 getDataTypeName(eInfo.type));
-        return 0;
-    }
+    openMatEngine(filePath, &eInfo, &stats, error);
+    int result = error->isErr ? 0 : convertElementToInt(&eInfo, error);
 
-    return eInfo.dataInt[0];
+    finishMatStats(&stats, NULL, error);
+    return result;
 }
 
 int64_t openMatInt64(char *filePath, IMatError *error)
 {
     cleanError(error);
 
-    ElmementInfo eInfo;
-
-    openMatEngine(filePath, &eInfo, error);
-    if (error->isErr)
-        return 0;
+    ElmementInfo eInfo = {.target = DT_INT_64};
+    MatStatsState stats;
 
-    if (eInfo.type != DT_INT_64)
-    {
-        setError(error, "Got error while reading %s. Expected %s, but readed %s", eInfo.name, getDataTypeName(DT_INT_64),
-                 getDataTypeName(eInfo.type));
-        return 0;
-    }
+    openMatEngine(filePath, &eInfo, &stats, error);
+    int64_t result = error->isErr ? 0 : convertElementToInt64(&eInfo, error);
 
-    return eInfo.dataInt[0];
+    finishMatStats(&stats, NULL, error);
+    return result;
 }
 
 double openMatDouble(char *filePath, IMatError *error)
 {
     cleanError(error);
 
-    ElmementInfo eInfo;
-
-    openMatEngine(filePath, &eInfo, error);
-    if (error->isErr)
-        return 0;
+    ElmementInfo eInfo = {.target = DT_DOUBLE};
+    MatStatsState stats;
 
-    // TODO убрать dtint
-    if (eInfo.type != DT_DOUBLE && eInfo.type != DT_INT)
-    {
-        setError(error, "Got error while reading %s. Expected %s, but readed %s", eInfo.name, getDataTypeName(DT_DOUBLE),
-                 getDataTypeName(eInfo.type));
-        return 0;
-    }
+    openMatEngine(filePath, &eInfo, &stats, error);
+    double result = error->isErr ? 0 : convertElementToDouble(&eInfo, error);
 
-    return eInfo.type == DT_INT ? (double)eInfo.dataInt[0] : eInfo.dataDouble[0];
+    finishMatStats(&stats, NULL, error);
+    return result;
 }
 
 gsl_vector *openMatVector(char *filePath, IMatError *error)
 {
-    gsl_vector *result;
     cleanError(error);
 
-    ElmementInfo eInfo;
+    ElmementInfo eInfo = {.target = DT_VECTOR};
+    MatStatsState stats;
 
-    openMatEngine(filePath, &eInfo, error);
-    if (error->isErr)
-        return result;
+    openMatEngine(filePath, &eInfo, &stats, error);
+    gsl_vector *result = error->isErr ? NULL : convertElementToVector(&eInfo, error);
 
-    int elemsNumber = eInfo.sizeI * eInfo.sizeJ;
+    finishMatStats(&stats, result, error);
+    return result;
+}
 
-    if (eInfo.type != DT_VECTOR && eInfo.type != DT_DOUBLE && eInfo.type != DT_EMPTY)
-    {
-        if (eInfo.type == DT_VECTOR_INT || eInfo.type == DT_INT)
-        {
-            result = gsl_vector_alloc(elemsNumber);
+gsl_vector_int *openMatVectorInt(char *filePath, IMatError *error)
+{
+    cleanError(error);
 
-            for (int i = 0; i < elemsNumber; i++)
-            {
-                gsl_vector_set(result, i, eInfo.dataInt[i]);
-            }
-            free(eInfo.dataInt);
-            return result;
-        }
-        setError(error, "Got error while reading %s. Expected %s, but readed %s", eInfo.name, getDataTypeName(DT_VECTOR),
-                 getDataTypeName(eInfo.type));
-        return result;
-    }
+    ElmementInfo eInfo = {.target = DT_VECTOR_INT};
+    MatStatsState stats;
 
-    result = gsl_vector_alloc(elemsNumber);
+    openMatEngine(filePath, &eInfo, &stats, error);
+    gsl_vector_int *result = error->isErr ? NULL : convertElementToVectorInt(&eInfo, error);
 
-    for (int i = 0; i < elemsNumber; i++)
-    {
-        gsl_vector_set(result, i, eInfo.dataDouble[i]);
-    }
+    finishMatStats(&stats, result, error);
+    return result;
+}
+
+gsl_matrix *openMatMatrix(char *filePath, IMatError *error)
+{
+    cleanError(error);
+
+    ElmementInfo eInfo = {.target = DT_MATRIX};
+    MatStatsState stats;
 
-    if (eInfo.type != DT_EMPTY)
-        free(eInfo.dataDouble);
+    openMatEngine(filePath, &eInfo, &stats, error);
+    gsl_matrix *result = error->isErr ? NULL : convertElementToMatrix(&eInfo, error);
+
+    finishMatStats(&stats, result, error);
     return result;
 }
 
-gsl_vector_int *openMatVectorInt(char *filePath, IMatError *error)
+gsl_matrix_int *openMatMatrixInt(char *filePath, IMatError *error)
 {
-    gsl_vector_int *result;
     cleanError(error);
 
-    ElmementInfo eInfo;
+    ElmementInfo eInfo = {.target = DT_MATRIX_INT};
+    MatStatsState stats;
 
-    openMatEngine(filePath, &eInfo, error);
-    if (error->isErr)
-        return result;
+    openMatEngine(filePath, &eInfo, &stats, error);
+    gsl_matrix_int *result = error->isErr ? NULL : convertElementToMatrixInt(&eInfo, error);
 
-    if (eInfo.type != DT_VECTOR_INT && eInfo.type != DT_INT && eInfo.type != DT_EMPTY)
-    {
-        setError(error, "Got error while reading %s. Expected %s, but readed %s", eInfo.name, getDataTypeName(DT_VECTOR_INT),
-                 getDataTypeName(eInfo.type));
-        return result;
-    }
+    finishMatStats(&stats, result, error);
+    return result;
+}
 
-    int elemsNumber = eInfo.sizeI * eInfo.sizeJ;
+complex double openMatComplex(char *filePath, IMatError *error)
+{
+    cleanError(error);
 
-    result = gsl_vector_int_alloc(elemsNumber);
+    ElmementInfo eInfo = {.target = DT_COMPLEX};
+    MatStatsState stats;
 
-    for (int i = 0; i < elemsNumber; i++)
-    {
-        gsl_vector_int_set(result, i, eInfo.dataInt[i]);
-    }
+    openMatEngine(filePath, &eInfo, &stats, error);
+    complex double result = error->isErr ? 0 : convertElementToComplex(&eInfo, error);
 
-    if (eInfo.type != DT_EMPTY)
-        free(eInfo.dataInt);
+    finishMatStats(&stats, NULL, error);
     return result;
 }
 
-gsl_matrix *openMatMatrix(char *filePath, IMatError *error)
+gsl_vector_complex *openMatVectorComplex(char *filePath, IMatError *error)
 {
-    gsl_matrix *result;
     cleanError(error);
 
-    ElmementInfo eInfo;
+    ElmementInfo eInfo = {.target = DT_VECTOR_COMPLEX};
+    MatStatsState stats;
 
-    openMatEngine(filePath, &eInfo, error);
-    if (error->isErr)
-        return result;
+    openMatEngine(filePath, &eInfo, &stats, error);
+    gsl_vector_complex *result = error->isErr ? NULL : convertElementToVectorComplex(&eInfo, error);
 
-    if (eInfo.type != DT_MATRIX && eInfo.type != DT_VECTOR && eInfo.type != DT_DOUBLE && eInfo.type != DT_EMPTY)
-    {
-        if (eInfo.type == DT_MATRIX_INT || eInfo.type == DT_VECTOR_INT || eInfo.type == DT_INT)
-        {
-            result = gsl_matrix_alloc(eInfo.sizeI, eInfo.sizeJ);
+    finishMatStats(&stats, result, error);
+    return result;
+}
 
-            for (int i = 0; i < eInfo.sizeI; i++)
-            {
-                for (int j = 0; j < eInfo.sizeJ; j++)
-                {
-                    gsl_matrix_set(result, i, j, eInfo.dataInt[i + eInfo.sizeI * j]);
-                }
-            }
+gsl_matrix_complex *openMatMatrixComplex(char *filePath, IMatError *error)
+{
+    cleanError(error);
 
-            free(eInfo.dataInt);
-            return result;
-        }
+    ElmementInfo eInfo = {.target = DT_MATRIX_COMPLEX};
+    MatStatsState stats;
 
-        setError(error, "Got error while reading %s. Expected %s, but readed %s", eInfo.name, getDataTypeName(DT_MATRIX),
-                 getDataTypeName(eInfo.type));
-        return result;
-    }
+    openMatEngine(filePath, &eInfo, &stats, error);
+    gsl_matrix_complex *result = error->isErr ? NULL : convertElementToMatrixComplex(&eInfo, error);
 
-    result = gsl_matrix_alloc(eInfo.sizeI, eInfo.sizeJ);
+    finishMatStats(&stats, result, error);
+    return result;
+}
 
-    for (int i = 0; i < eInfo.sizeI; i++)
-    {
-        for (int j = 0; j < eInfo.sizeJ; j++)
-        {
-            gsl_matrix_set(result, i, j, eInfo.dataDouble[i + eInfo.sizeI * j]);
-        }
-    }
+gsl_matrix *openMatMatrixColMajor(char *filePath, IMatError *error)
+{
+    cleanError(error);
 
-    if (eInfo.type != DT_EMPTY)
-        free(eInfo.dataDouble);
+    ElmementInfo eInfo = {.target = DT_MATRIX, .columnMajor = 1};
+    MatStatsState stats;
+
+    openMatEngine(filePath, &eInfo, &stats, error);
+    gsl_matrix *result = error->isErr ? NULL : convertElementToMatrix(&eInfo, error);
+
+    finishMatStats(&stats, result, error);
     return result;
 }
 
-gsl_matrix_int *openMatMatrixInt(char *filePath, IMatError *error)
+gsl_matrix_int *openMatMatrixIntColMajor(char *filePath, IMatError *error)
 {
-    gsl_matrix_int *result;
     cleanError(error);
 
-    ElmementInfo eInfo;
+    ElmementInfo eInfo = {.target = DT_MATRIX_INT, .columnMajor = 1};
+    MatStatsState stats;
 
-    openMatEngine(filePath, &eInfo, error);
-    if (error->isErr)
-        return result;
+    openMatEngine(filePath, &eInfo, &stats, error);
+    gsl_matrix_int *result = error->isErr ? NULL : convertElementToMatrixInt(&eInfo, error);
 
-    if (eInfo.type != DT_MATRIX_INT && eInfo.type != DT_VECTOR_INT && eInfo.type != DT_INT && eInfo.type != DT_EMPTY)
-    {
-        setError(error, "Got error while reading %s. Expected %s, but readed %s", eInfo.name, getDataTypeName(DT_MATRIX_INT),
-                 getDataTypeName(eInfo.type));
-        return result;
-    }
+    finishMatStats(&stats, result, error);
+    return result;
+}
 
-    result = gsl_matrix_int_alloc(eInfo.sizeI, eInfo.sizeJ);
+gsl_matrix_complex *openMatMatrixComplexColMajor(char *filePath, IMatError *error)
+{
+    cleanError(error);
 
-    for (int i = 0; i < eInfo.sizeI; i++)
-    {
-        for (int j = 0; j < eInfo.sizeJ; j++)
-        {
-            gsl_matrix_int_set(result, i, j, eInfo.dataInt[i + eInfo.sizeI * j]);
-        }
-    }
+    ElmementInfo eInfo = {.target = DT_MATRIX_COMPLEX, .columnMajor = 1};
+    MatStatsState stats;
 
-    if (eInfo.type != DT_EMPTY)
-        free(eInfo.dataInt);
+    openMatEngine(filePath, &eInfo, &stats, error);
+    gsl_matrix_complex *result = error->isErr ? NULL : convertElementToMatrixComplex(&eInfo, error);
+
+    finishMatStats(&stats, result, error);
     return result;
 }
 
-complex double openMatComplex(char *filePath, IMatError *error)
+gsl_vector_float *openMatVectorFloat(char *filePath, IMatError *error)
 {
-    complex double result;
     cleanError(error);
 
-    ElmementInfo eInfo;
+    ElmementInfo eInfo = {.target = DT_VECTOR_FLOAT};
+    MatStatsState stats;
 
-    openMatEngine(filePath, &eInfo, error);
-    if (error->isErr)
-        return result;
+    openMatEngine(filePath, &eInfo, &stats, error);
+    gsl_vector_float *result = error->isErr ? NULL : convertElementToVectorFloat(&eInfo, error);
 
-    if (eInfo.type != DT_COMPLEX)
-    {
-        setError(error, "Got error while reading %s. Expected %s, but readed %s", eInfo.name, getDataTypeName(DT_COMPLEX),
-                 getDataTypeName(eInfo.type));
-        return result;
-    }
+    finishMatStats(&stats, result, error);
+    return result;
+}
+
+gsl_vector_complex_float *openMatVectorComplexFloat(char *filePath, IMatError *error)
+{
+    cleanError(error);
 
-    result = eInfo.dataDouble[0] + I * eInfo.dataDouble[1];
+    ElmementInfo eInfo = {.target = DT_VECTOR_COMPLEX_FLOAT};
+    MatStatsState stats;
 
-    free(eInfo.dataDouble);
+    openMatEngine(filePath, &eInfo, &stats, error);
+    gsl_vector_complex_float *result = error->isErr ? NULL : convertElementToVectorComplexFloat(&eInfo, error);
+
+    finishMatStats(&stats, result, error);
     return result;
 }
 
-gsl_vector_complex *openMatVectorComplex(char *filePath, IMatError *error)
+gsl_matrix_float *openMatMatrixFloat(char *filePath, IMatError *error)
 {
-    gsl_vector_complex *result;
     cleanError(error);
 
-    ElmementInfo eInfo;
+    ElmementInfo eInfo = {.target = DT_MATRIX_FLOAT};
+    MatStatsState stats;
 
-    openMatEngine(filePath, &eInfo, error);
-    if (error->isErr)
-        return result;
+    openMatEngine(filePath, &eInfo, &stats, error);
+    gsl_matrix_float *result = error->isErr ? NULL : convertElementToMatrixFloat(&eInfo, error);
+
+    finishMatStats(&stats, result, error);
+    return result;
+}
+
+gsl_matrix_complex_float *openMatMatrixComplexFloat(char *filePath, IMatError *error)
+{
+    cleanError(error);
+
+    ElmementInfo eInfo = {.target = DT_MATRIX_COMPLEX_FLOAT};
+    MatStatsState stats;
+
+    openMatEngine(filePath, &eInfo, &stats, error);
+    gsl_matrix_complex_float *result = error->isErr ? NULL : convertElementToMatrixComplexFloat(&eInfo, error);
 
-    if (eInfo.type != DT_VECTOR_COMPLEX && eInfo.type != DT_COMPLEX && eInfo.type != DT_EMPTY)
+    finishMatStats(&stats, result, error);
+    return result;
+}
+
+IMatFile *openMatFile(char *filePath, IMatError *error)
+{
+    cleanError(error);
+
+    FILE *file = fopen(filePath, "rb");
+    if (file == NULL)
     {
-        setError(error, "Got error while reading %s. Expected %s, but readed %s", eInfo.name, getDataTypeName(DT_VECTOR_COMPLEX),
-                 getDataTypeName(eInfo.type));
-        return result;
+        setError(error, "Unable to open file: %s", filePath);
+        return NULL;
+    }
+
+    int version = handleMatHeader(file, error);
+    if (error->isErr)
+    {
+        fclose(file);
+        return NULL;
     }
 
-    int elemsNumber = eInfo.sizeI * eInfo.sizeJ;
+    IMatFile *matFile = allocateMatFile(filePath);
+    matFile->file = file;
 
-    result = gsl_vector_complex_alloc(elemsNumber);
+    // Индекс v7.3 файла строится по датасетам HDF5, сам файл через FILE* не читается
+    if (version == MAT_VERSION_73)
+    {
+        fclose(file);
+        matFile->file = NULL;
+
+#ifdef I_MAT_USE_HDF5
+        openMatH5File(matFile, filePath, error);
+#else
+        setError(error, "MAT v7.3 (HDF5) files are supported only when built with -DI_MAT_USE_HDF5");
+#endif
+        if (error->isErr)
+        {
+            closeMatFile(matFile);
+            return NULL;
+        }
+
+        return matFile;
+    }
+
+    int varsCapacity = 0;
+    unsigned char tagField[8];
 
-    for (int i = 0; i < elemsNumber; i++)
+    // Проходим по тегам элементов верхнего уровня, разжимая только начало каждого элемента
+    while (fread(tagField, 8, 1, file) == 1)
     {
-        gsl_vector_complex_set(result, i, eInfo.dataDouble[i] + I * eInfo.dataDouble[i + elemsNumber]);
+        long offset = ftell(file) - 8;
+        int elementType = readFromByteInt32(tagField);
+        size_t elementSize = readFromByteUInt32(&(tagField[4]));
+
+        if (matFile->varsNumber == varsCapacity)
+        {
+            varsCapacity = varsCapacity ? varsCapacity * 2 : 16;
+            matFile->vars = (IMatVarInfo *)realloc(matFile->vars, sizeof(IMatVarInfo) * varsCapacity);
+        }
+
+        IMatVarInfo *varInfo = &(matFile->vars[matFile->varsNumber]);
+        varInfo->offset = offset;
+        varInfo->elementSize = elementSize;
+
+        handleVarInfo(file, elementType, elementSize, varInfo, error);
+        if (error->isErr)
+        {
+            closeMatFile(matFile);
+            return NULL;
+        }
+
+        matFile->varsNumber++;
+
+        if (fseek(file, offset + 8 + (long)elementSize, SEEK_SET) != 0)
+            break;
     }
 
-    if (eInfo.type != DT_EMPTY)
-        free(eInfo.dataDouble);
-    return result;
+    return matFile;
 }
 
-gsl_matrix_complex *openMatMatrixComplex(char *filePath, IMatError *error)
+/**
+ * Открытие mat файла, содержимое которого уже прочитано в память (v5 файлы)
+ *
+ * Индекс строится по contents так же, как openMatFile строит его по файлу, а элементы потом читаются прямо
+ * из contents без обращения к диску. contents передается во владение IMatFile и освобождается closeMatFile
+ */
+IMatFile *openMatContents(char *filePath, unsigned char *contents, size_t contentsSize, IMatError *error)
+{
+    cleanError(error);
+
+    int version = contentsSize < 128 ? 0 : checkMatHeader(contents, error);
+    if (contentsSize < 128)
+        setError(error, "Unexpected end of file");
+    else if (!error->isErr && version == MAT_VERSION_73)
+        setError(error, "MAT v7.3 (HDF5) files can't be read from memory");
+
+    if (error->isErr)
+    {
+        free(contents);
+        return NULL;
+    }
+
+    IMatFile *matFile = allocateMatFile(filePath);
+    matFile->contents = contents;
+    matFile->contentsSize = contentsSize;
+
+    int varsCapacity = 0;
+    size_t offset = 128;
+
+    while (contentsSize - offset >= 8)
+    {
+        int elementType = readFromByteInt32(&(contents[offset]));
+        size_t elementSize = readFromByteUInt32(&(contents[offset + 4]));
+        size_t available = contentsSize - offset - 8;
+
+        if (matFile->varsNumber == varsCapacity)
+        {
+            varsCapacity = varsCapacity ? varsCapacity * 2 : 16;
+            matFile->vars = (IMatVarInfo *)realloc(matFile->vars, sizeof(IMatVarInfo) * varsCapacity);
+        }
+
+        IMatVarInfo *varInfo = &(matFile->vars[matFile->varsNumber]);
+        varInfo->offset = (long)offset;
+        varInfo->elementSize = elementSize;
+
+        handleVarData(elementType, elementSize, &(contents[offset + 8]), elementSize < available ? elementSize : available, varInfo, error);
+        if (error->isErr)
+        {
+            closeMatFile(matFile);
+            return NULL;
+        }
+
+        matFile->varsNumber++;
+
+        if (elementSize > available)
+            break;
+        offset += 8 + elementSize;
+    }
+
+    return matFile;
+}
+
+/**
+ * Выделение IMatFile без открытого файла и переменных
+ */
+IMatFile *allocateMatFile(char *filePath)
+{
+    IMatFile *matFile = (IMatFile *)malloc(sizeof(IMatFile));
+    matFile->file = NULL;
+    matFile->filePath = (char *)malloc(strlen(filePath) + 1);
+    strcpy(matFile->filePath, filePath);
+    matFile->contents = NULL;
+    matFile->contentsSize = 0;
+    matFile->varsNumber = 0;
+    matFile->vars = NULL;
+    matFile->indexes = NULL;
+#ifndef I_MAT_NO_THREADS
+    pthread_mutex_init(&matFile->lock, NULL);
+#endif
+#ifdef I_MAT_USE_HDF5
+    matFile->h5File = H5I_INVALID_HID;
+#endif
+
+    return matFile;
+}
+
+void closeMatFile(IMatFile *matFile)
+{
+    if (matFile == NULL)
+        return;
+
+    if (matFile->file != NULL)
+        fclose(matFile->file);
+#ifdef I_MAT_USE_HDF5
+    if (matFile->h5File != H5I_INVALID_HID)
+        closeMatH5File(matFile);
+#endif
+    if (matFile->indexes != NULL)
+        for (int i = 0; i < matFile->varsNumber; i++)
+            freeCheckpointIndex(matFile->indexes[i]);
+    free(matFile->indexes);
+    free(matFile->vars);
+    free(matFile->filePath);
+    free(matFile->contents);
+#ifndef I_MAT_NO_THREADS
+    pthread_mutex_destroy(&matFile->lock);
+#endif
+    free(matFile);
+}
+
+int getMatFileVarsNumber(IMatFile *matFile)
+{
+    return matFile->varsNumber;
+}
+
+const IMatVarInfo *getMatFileVarInfo(IMatFile *matFile, int index)
+{
+    if (index < 0 || index >= matFile->varsNumber)
+        return NULL;
+
+    return &(matFile->vars[index]);
+}
+
+int readMatFileInt(IMatFile *matFile, char *name, IMatError *error)
+{
+    cleanError(error);
+
+    ElmementInfo eInfo = {.target = DT_INT};
+    MatStatsState stats;
+
+    openMatFileEngine(matFile, name, &eInfo, &stats, error);
+    int result = error->isErr ? 0 : convertElementToInt(&eInfo, error);
+
+    finishMatStats(&stats, NULL, error);
+    return result;
+}
+
+int64_t readMatFileInt64(IMatFile *matFile, char *name, IMatError *error)
+{
+    cleanError(error);
+
+    ElmementInfo eInfo = {.target = DT_INT_64};
+    MatStatsState stats;
+
+    openMatFileEngine(matFile, name, &eInfo, &stats, error);
+    int64_t result = error->isErr ? 0 : convertElementToInt64(&eInfo, error);
+
+    finishMatStats(&stats, NULL, error);
+    return result;
+}
+
+double readMatFileDouble(IMatFile *matFile, char *name, IMatError *error)
+{
+    cleanError(error);
+
+    ElmementInfo eInfo = {.target = DT_DOUBLE};
+    MatStatsState stats;
+
+    openMatFileEngine(matFile, name, &eInfo, &stats, error);
+    double result = error->isErr ? 0 : convertElementToDouble(&eInfo, error);
+
+    finishMatStats(&stats, NULL, error);
+    return result;
+}
+
+complex double readMatFileComplex(IMatFile *matFile, char *name, IMatError *error)
+{
+    cleanError(error);
+
+    ElmementInfo eInfo = {.target = DT_COMPLEX};
+    MatStatsState stats;
+
+    openMatFileEngine(matFile, name, &eInfo, &stats, error);
+    complex double result = error->isErr ? 0 : convertElementToComplex(&eInfo, error);
+
+    finishMatStats(&stats, NULL, error);
+    return result;
+}
+
+gsl_vector *readMatFileVector(IMatFile *matFile, char *name, IMatError *error)
+{
+    cleanError(error);
+
+    ElmementInfo eInfo = {.target = DT_VECTOR};
+    MatStatsState stats;
+
+    openMatFileEngine(matFile, name, &eInfo, &stats, error);
+    gsl_vector *result = error->isErr ? NULL : convertElementToVector(&eInfo, error);
+
+    finishMatStats(&stats, result, error);
+    return result;
+}
+
+gsl_vector_int *readMatFileVectorInt(IMatFile *matFile, char *name, IMatError *error)
+{
+    cleanError(error);
+
+    ElmementInfo eInfo = {.target = DT_VECTOR_INT};
+    MatStatsState stats;
+
+    openMatFileEngine(matFile, name, &eInfo, &stats, error);
+    gsl_vector_int *result = error->isErr ? NULL : convertElementToVectorInt(&eInfo, error);
+
+    finishMatStats(&stats, result, error);
+    return result;
+}
+
+gsl_vector_complex *readMatFileVectorComplex(IMatFile *matFile, char *name, IMatError *error)
+{
+    cleanError(error);
+
+    ElmementInfo eInfo = {.target = DT_VECTOR_COMPLEX};
+    MatStatsState stats;
+
+    openMatFileEngine(matFile, name, &eInfo, &stats, error);
+    gsl_vector_complex *result = error->isErr ? NULL : convertElementToVectorComplex(&eInfo, error);
+
+    finishMatStats(&stats, result, error);
+    return result;
+}
+
+gsl_matrix *readMatFileMatrix(IMatFile *matFile, char *name, IMatError *error)
+{
+    cleanError(error);
+
+    ElmementInfo eInfo = {.target = DT_MATRIX};
+    MatStatsState stats;
+
+    openMatFileEngine(matFile, name, &eInfo, &stats, error);
+    gsl_matrix *result = error->isErr ? NULL : convertElementToMatrix(&eInfo, error);
+
+    finishMatStats(&stats, result, error);
+    return result;
+}
+
+gsl_matrix_int *readMatFileMatrixInt(IMatFile *matFile, char *name, IMatError *error)
+{
+    cleanError(error);
+
+    ElmementInfo eInfo = {.target = DT_MATRIX_INT};
+    MatStatsState stats;
+
+    openMatFileEngine(matFile, name, &eInfo, &stats, error);
+    gsl_matrix_int *result = error->isErr ? NULL : convertElementToMatrixInt(&eInfo, error);
+
+    finishMatStats(&stats, result, error);
+    return result;
+}
+
+gsl_matrix_complex *readMatFileMatrixComplex(IMatFile *matFile, char *name, IMatError *error)
+{
+    cleanError(error);
+
+    ElmementInfo eInfo = {.target = DT_MATRIX_COMPLEX};
+    MatStatsState stats;
+
+    openMatFileEngine(matFile, name, &eInfo, &stats, error);
+    gsl_matrix_complex *result = error->isErr ? NULL : convertElementToMatrixComplex(&eInfo, error);
+
+    finishMatStats(&stats, result, error);
+    return result;
+}
+
+gsl_matrix *readMatFileMatrixColMajor(IMatFile *matFile, char *name, IMatError *error)
+{
+    cleanError(error);
+
+    ElmementInfo eInfo = {.target = DT_MATRIX, .columnMajor = 1};
+    MatStatsState stats;
+
+    openMatFileEngine(matFile, name, &eInfo, &stats, error);
+    gsl_matrix *result = error->isErr ? NULL : convertElementToMatrix(&eInfo, error);
+
+    finishMatStats(&stats, result, error);
+    return result;
+}
+
+gsl_matrix_int *readMatFileMatrixIntColMajor(IMatFile *matFile, char *name, IMatError *error)
+{
+    cleanError(error);
+
+    ElmementInfo eInfo = {.target = DT_MATRIX_INT, .columnMajor = 1};
+    MatStatsState stats;
+
+    openMatFileEngine(matFile, name, &eInfo, &stats, error);
+    gsl_matrix_int *result = error->isErr ? NULL : convertElementToMatrixInt(&eInfo, error);
+
+    finishMatStats(&stats, result, error);
+    return result;
+}
+
+gsl_matrix_complex *readMatFileMatrixComplexColMajor(IMatFile *matFile, char *name, IMatError *error)
+{
+    cleanError(error);
+
+    ElmementInfo eInfo = {.target = DT_MATRIX_COMPLEX, .columnMajor = 1};
+    MatStatsState stats;
+
+    openMatFileEngine(matFile, name, &eInfo, &stats, error);
+    gsl_matrix_complex *result = error->isErr ? NULL : convertElementToMatrixComplex(&eInfo, error);
+
+    finishMatStats(&stats, result, error);
+    return result;
+}
+
+gsl_vector_float *readMatFileVectorFloat(IMatFile *matFile, char *name, IMatError *error)
+{
+    cleanError(error);
+
+    ElmementInfo eInfo = {.target = DT_VECTOR_FLOAT};
+    MatStatsState stats;
+
+    openMatFileEngine(matFile, name, &eInfo, &stats, error);
+    gsl_vector_float *result = error->isErr ? NULL : convertElementToVectorFloat(&eInfo, error);
+
+    finishMatStats(&stats, result, error);
+    return result;
+}
+
+gsl_vector_complex_float *readMatFileVectorComplexFloat(IMatFile *matFile, char *name, IMatError *error)
+{
+    cleanError(error);
+
+    ElmementInfo eInfo = {.target = DT_VECTOR_COMPLEX_FLOAT};
+    MatStatsState stats;
+
+    openMatFileEngine(matFile, name, &eInfo, &stats, error);
+    gsl_vector_complex_float *result = error->isErr ? NULL : convertElementToVectorComplexFloat(&eInfo, error);
+
+    finishMatStats(&stats, result, error);
+    return result;
+}
+
+gsl_matrix_float *readMatFileMatrixFloat(IMatFile *matFile, char *name, IMatError *error)
+{
+    cleanError(error);
+
+    ElmementInfo eInfo = {.target = DT_MATRIX_FLOAT};
+    MatStatsState stats;
+
+    openMatFileEngine(matFile, name, &eInfo, &stats, error);
+    gsl_matrix_float *result = error->isErr ? NULL : convertElementToMatrixFloat(&eInfo, error);
+
+    finishMatStats(&stats, result, error);
+    return result;
+}
+
+gsl_matrix_complex_float *readMatFileMatrixComplexFloat(IMatFile *matFile, char *name, IMatError *error)
+{
+    cleanError(error);
+
+    ElmementInfo eInfo = {.target = DT_MATRIX_COMPLEX_FLOAT};
+    MatStatsState stats;
+
+    openMatFileEngine(matFile, name, &eInfo, &stats, error);
+    gsl_matrix_complex_float *result = error->isErr ? NULL : convertElementToMatrixComplexFloat(&eInfo, error);
+
+    finishMatStats(&stats, result, error);
+    return result;
+}
+
+gsl_spmatrix *openMatSpMatrix(char *filePath, IMatError *error)
+{
+    cleanError(error);
+
+    ElmementInfo eInfo = {.target = DT_SPARSE};
+    MatStatsState stats;
+
+    openMatEngine(filePath, &eInfo, &stats, error);
+    gsl_spmatrix *result = error->isErr ? NULL : convertElementToSpMatrix(&eInfo, error);
+
+    finishMatStats(&stats, result, error);
+    return result;
+}
+
+gsl_spmatrix_complex *openMatSpMatrixComplex(char *filePath, IMatError *error)
+{
+    cleanError(error);
+
+    ElmementInfo eInfo = {.target = DT_SPARSE_COMPLEX};
+    MatStatsState stats;
+
+    openMatEngine(filePath, &eInfo, &stats, error);
+    gsl_spmatrix_complex *result = error->isErr ? NULL : convertElementToSpMatrixComplex(&eInfo, error);
+
+    finishMatStats(&stats, result, error);
+    return result;
+}
+
+gsl_spmatrix *readMatFileSpMatrix(IMatFile *matFile, char *name, IMatError *error)
+{
+    cleanError(error);
+
+    ElmementInfo eInfo = {.target = DT_SPARSE};
+    MatStatsState stats;
+
+    openMatFileEngine(matFile, name, &eInfo, &stats, error);
+    gsl_spmatrix *result = error->isErr ? NULL : convertElementToSpMatrix(&eInfo, error);
+
+    finishMatStats(&stats, result, error);
+    return result;
+}
+
+gsl_spmatrix_complex *readMatFileSpMatrixComplex(IMatFile *matFile, char *name, IMatError *error)
+{
+    cleanError(error);
+
+    ElmementInfo eInfo = {.target = DT_SPARSE_COMPLEX};
+    MatStatsState stats;
+
+    openMatFileEngine(matFile, name, &eInfo, &stats, error);
+    gsl_spmatrix_complex *result = error->isErr ? NULL : convertElementToSpMatrixComplex(&eInfo, error);
+
+    finishMatStats(&stats, result, error);
+    return result;
+}
+
+IMatArray *openMatArray(char *filePath, IMatError *error)
+{
+    cleanError(error);
+
+    ElmementInfo eInfo = {.target = DT_ARRAY};
+    MatStatsState stats;
+
+    openMatEngine(filePath, &eInfo, &stats, error);
+    IMatArray *result = error->isErr ? NULL : convertElementToArray(&eInfo, error);
+
+    finishMatStats(&stats, result, error);
+    return result;
+}
+
+IMatArray *readMatFileArray(IMatFile *matFile, char *name, IMatError *error)
+{
+    cleanError(error);
+
+    ElmementInfo eInfo = {.target = DT_ARRAY};
+    MatStatsState stats;
+
+    openMatFileEngine(matFile, name, &eInfo, &stats, error);
+    IMatArray *result = error->isErr ? NULL : convertElementToArray(&eInfo, error);
+
+    finishMatStats(&stats, result, error);
+    return result;
+}
+
+gsl_matrix *openMatSubMatrix(char *filePath, char *name, int row0, int rows, int col0, int cols, IMatError *error)
+{
+    IMatFile *matFile = openMatFile(filePath, error);
+    if (error->isErr)
+        return NULL;
+
+    gsl_matrix *result = readMatFileSubMatrix(matFile, name, row0, rows, col0, cols, error);
+
+    closeMatFile(matFile);
+    return result;
+}
+
+gsl_matrix *readMatFileSubMatrix(IMatFile *matFile, char *name, int row0, int rows, int col0, int cols, IMatError *error)
+{
+    cleanError(error);
+
+    if (name == NULL)
+    {
+        if (matFile->varsNumber == 0)
+        {
+            setError(error, "No variables in file");
+            return NULL;
+        }
+
+        name = matFile->vars[0].name;
+    }
+
+    if (row0 < 0 || col0 < 0 || rows <= 0 || cols <= 0)
+    {
+        setError(error, "Sub-matrix is out of range");
+        return NULL;
+    }
+
+#ifdef I_MAT_USE_HDF5
+    // В v7.3 файле читаются и разжимаются только чанки, которые пересекают область
+    if (matFile->h5File != H5I_INVALID_HID)
+    {
+        ElmementInfo eInfo = {.target = DT_MATRIX};
+
+        initElementInfo(&eInfo);
+        readMatH5Region(matFile->h5File, name, row0, rows, col0, cols, &eInfo, error);
+        if (error->isErr)
+            return NULL;
+
+        return convertElementToMatrix(&eInfo, error);
+    }
+#endif
+
+    for (int i = 0; i < matFile->varsNumber; i++)
+        if (strcmp(matFile->vars[i].name, name) == 0)
+            return readElementSubMatrix(matFile, i, row0, rows, col0, cols, error);
+
+    setError(error, "Variable %s not found", name);
+    return NULL;
+}
+
+IMatColumnStream *openMatColumnStream(char *filePath, char *name, int blockColumns, IMatError *error)
+{
+    IMatFile *matFile = openMatFile(filePath, error);
+    if (error->isErr)
+        return NULL;
+
+    IMatColumnStream *stream = readMatFileColumnStream(matFile, name, blockColumns, error);
+    if (stream == NULL)
+    {
+        closeMatFile(matFile);
+        return NULL;
+    }
+
+    stream->isOwnFile = 1;
+    return stream;
+}
+
+IMatColumnStream *readMatFileColumnStream(IMatFile *matFile, char *name, int blockColumns, IMatError *error)
+{
+    cleanError(error);
+
+    if (name == NULL)
+    {
+        if (matFile->varsNumber == 0)
+        {
+            setError(error, "No variables in file");
+            return NULL;
+        }
+
+        name = matFile->vars[0].name;
+    }
+
+#ifdef I_MAT_USE_HDF5
+    if (matFile->h5File != H5I_INVALID_HID)
+    {
+        setError(error, "Column streams are not supported for v7.3 files");
+        return NULL;
+    }
+#endif
+
+    for (int i = 0; i < matFile->varsNumber; i++)
+        if (strcmp(matFile->vars[i].name, name) == 0)
+            return createColumnStream(matFile, &(matFile->vars[i]), blockColumns, error);
+
+    setError(error, "Variable %s not found", name);
+    return NULL;
+}
+
+int nextMatColumn(IMatColumnStream *stream, gsl_vector_view *column, IMatError *error)
+{
+    cleanError(error);
+
+    if (stream->column >= stream->sizeJ)
+        return 0;
+
+    if (stream->column == stream->blockStart + stream->blockLength && !fillColumnBlock(stream, error))
+        return 0;
+
+    *column = gsl_vector_view_array(&(stream->block[(size_t)(stream->column - stream->blockStart) * stream->sizeI]), stream->sizeI);
+    stream->column++;
+
+    return 1;
+}
+
+int nextMatColumns(IMatColumnStream *stream, gsl_matrix_view *block, IMatError *error)
+{
+    cleanError(error);
+
+    if (stream->column >= stream->sizeJ)
+        return 0;
+
+    // Сначала отдаются столбцы текущего блока, еще не возвращенные nextMatColumn
+    if (stream->column == stream->blockStart + stream->blockLength && !fillColumnBlock(stream, error))
+        return 0;
+
+    int columnsNumber = stream->blockStart + stream->blockLength - stream->column;
+
+    *block = gsl_matrix_view_array(&(stream->block[(size_t)(stream->column - stream->blockStart) * stream->sizeI]), columnsNumber, stream->sizeI);
+    stream->column += columnsNumber;
+
+    return columnsNumber;
+}
+
+void getMatColumnStreamSize(const IMatColumnStream *stream, int *sizeI, int *sizeJ)
+{
+    *sizeI = stream->sizeI;
+    *sizeJ = stream->sizeJ;
+}
+
+void closeMatColumnStream(IMatColumnStream *stream)
+{
+    if (stream == NULL)
+        return;
+
+    if (stream->isStreamReady)
+        inflateEnd(&stream->strm);
+
+    free(stream->input);
+    free(stream->raw);
+    free(stream->block);
+
+    if (stream->isOwnFile)
+        closeMatFile(stream->matFile);
+
+    free(stream);
+}
+
+IMatArray *openMatArrayPages(char *filePath, char *name, int page0, int pages, IMatError *error)
+{
+    IMatFile *matFile = openMatFile(filePath, error);
+    if (error->isErr)
+        return NULL;
+
+    IMatArray *result = readMatFileArrayPages(matFile, name, page0, pages, error);
+
+    closeMatFile(matFile);
+    return result;
+}
+
+IMatArray *readMatFileArrayPages(IMatFile *matFile, char *name, int page0, int pages, IMatError *error)
+{
+    cleanError(error);
+
+    if (name == NULL)
+    {
+        if (matFile->varsNumber == 0)
+        {
+            setError(error, "No variables in file");
+            return NULL;
+        }
+
+        name = matFile->vars[0].name;
+    }
+
+    if (page0 < 0 || pages <= 0)
+    {
+        setError(error, "Pages are out of range");
+        return NULL;
+    }
+
+#ifdef I_MAT_USE_HDF5
+    if (matFile->h5File != H5I_INVALID_HID)
+    {
+        setError(error, "Reading pages is not supported for v7.3 files");
+        return NULL;
+    }
+#endif
+
+    for (int i = 0; i < matFile->varsNumber; i++)
+        if (strcmp(matFile->vars[i].name, name) == 0)
+            return readElementPages(matFile, i, page0, pages, error);
+
+    setError(error, "Variable %s not found", name);
+    return NULL;
+}
+
+void freeMatArray(IMatArray *array)
+{
+    if (array == NULL)
+        return;
+
+    free(array->data);
+    free(array);
+}
+
+size_t getMatArrayPagesNumber(const IMatArray *array)
+{
+    size_t pagesNumber = 1;
+
+    for (int k = 2; k < array->dimsNumber; k++)
+        pagesNumber *= array->dims[k];
+
+    return pagesNumber;
+}
+
+gsl_matrix_view getMatArrayPage(IMatArray *array, size_t page)
+{
+    return gsl_matrix_view_array(&(array->data[page * array->dims[0] * array->dims[1]]), array->dims[0], array->dims[1]);
+}
+
+IMatTree *openMatTree(char *filePath, IMatError *error)
+{
+    IMatFile *matFile = openMatFile(filePath, error);
+    if (error->isErr)
+        return NULL;
+
+    // Отображение в память и разжатые данные не зависят от открытого файла
+    IMatTree *tree = readMatFileTree(matFile, NULL, error);
+
+    closeMatFile(matFile);
+    return tree;
+}
+
+IMatTree *readMatFileTree(IMatFile *matFile, char *name, IMatError *error)
+{
+    cleanError(error);
+
+    if (name == NULL)
+    {
+        if (matFile->varsNumber == 0)
+        {
+            setError(error, "No variables in file");
+            return NULL;
+        }
+
+        name = matFile->vars[0].name;
+    }
+
+#ifdef I_MAT_USE_HDF5
+    if (matFile->h5File != H5I_INVALID_HID)
+    {
+        setError(error, "Struct and cell variables of v7.3 files are not supported");
+        return NULL;
+    }
+#endif
+
+    const IMatVarInfo *varInfo = NULL;
+
+    for (int i = 0; i < matFile->varsNumber && varInfo == NULL; i++)
+        if (strcmp(matFile->vars[i].name, name) == 0)
+            varInfo = &(matFile->vars[i]);
+
+    if (varInfo == NULL)
+    {
+        setError(error, "Variable %s not found", name);
+        return NULL;
+    }
+
+    if (varInfo->type != DT_STRUCT && varInfo->type != DT_CELL)
+    {
+        setError(error, "Got error while reading %s. Expected %s or %s, but readed %s", varInfo->name, getDataTypeName(DT_STRUCT),
+                 getDataTypeName(DT_CELL), getDataTypeName(varInfo->type));
+        return NULL;
+    }
+
+    IMatTree *tree = (IMatTree *)calloc(1, sizeof(IMatTree));
+    const unsigned char *element = acquireElementData(matFile, varInfo, 1, &tree->mapping, error);
+
+    if (element == NULL)
+    {
+        free(tree);
+        return NULL;
+    }
+
+    tree->isCompressed = readFromByteInt32((unsigned char *)element) == MI_COMPRESSED;
+
+    if (tree->isCompressed)
+    {
+        size_t length;
+        int ret = decompressData(&element[8], varInfo->elementSize, &tree->data, &length, 0);
+
+        releaseElementData(&tree->mapping);
+        tree->length = length;
+
+        if (ret != Z_OK)
+            setError(error, "Failed to uncompress element, err: %d", ret);
+    }
+    else
+    {
+        tree->data = (unsigned char *)element;
+        tree->length = 8 + (size_t)varInfo->elementSize;
+    }
+
+    if (!error->isErr)
+        parseMatNode(tree, &tree->root, 0, 0, error);
+
+    if (error->isErr)
+    {
+        freeMatTree(tree);
+        return NULL;
+    }
+
+    return tree;
+}
+
+void freeMatTree(IMatTree *tree)
+{
+    if (tree == NULL)
+        return;
+
+    freeMatNode(&tree->root);
+
+    if (tree->isCompressed)
+        free(tree->data);
+    else
+        releaseElementData(&tree->mapping);
+
+    free(tree);
+}
+
+const IMatNode *getMatTreeRoot(const IMatTree *tree)
+{
+    return &tree->root;
+}
+
+const IMatNode *getMatNodeField(const IMatNode *node, int index, const char *field)
+{
+    if (node == NULL || node->type != DT_STRUCT || node->fieldsNumber == 0 || index < 0 || index >= node->childrenNumber / node->fieldsNumber)
+        return NULL;
+
+    for (int f = 0; f < node->fieldsNumber; f++)
+        if (strcmp(node->fieldNames[f], field) == 0)
+            return &(node->children[index * node->fieldsNumber + f]);
+
+    return NULL;
+}
+
+const IMatNode *getMatNodeCell(const IMatNode *node, int index)
+{
+    if (node == NULL || node->type != DT_CELL || index < 0 || index >= node->childrenNumber)
+        return NULL;
+
+    return &(node->children[index]);
+}
+
+const IMatNode *findMatNode(const IMatTree *tree, const char *path)
+{
+    const IMatNode *node = &tree->root;
+    // Индекс элемента struct массива для следующего поля
+    int index = 0;
+
+    while (node != NULL && *path != '\0')
+    {
+        if (*path == '(' || *path == '{')
+        {
+            char *end;
+            long k = strtol(path + 1, &end, 10);
+
+            if (k < 1 || k > 2147483647 || *end != (*path == '(' ? ')' : '}') || (*path == '{' && node->type != DT_CELL) || index != 0)
+                return NULL;
+
+            // Для cell массива A(k) и A{k} - один и тот же элемент
+            if (node->type == DT_CELL)
+                node = getMatNodeCell(node, (int)(k - 1));
+            else if (node->type == DT_STRUCT)
+                index = (int)(k - 1);
+            else
+                return NULL;
+
+            path = end + 1;
+            continue;
+        }
+
+        if (*path == '.')
+            path++;
+
+        char field[64];
+        size_t fieldLength = strcspn(path, ".({");
+
+        if (fieldLength == 0 || fieldLength >= sizeof(field))
+            return NULL;
+
+        memcpy(field, path, fieldLength);
+        field[fieldLength] = '\0';
+
+        node = getMatNodeField(node, index, field);
+        index = 0;
+        path += fieldLength;
+    }
+
+    // Отдельный элемент struct массива без поля узлом не является
+    return index == 0 ? node : NULL;
+}
+
+#define CONVERT_NODE(resultType, suffix) *(resultType *)destination = convertElementTo##suffix(&eInfo, error)
+
+void readMatNode(IMatTree *tree, const IMatNode *node, enum EDataTypes type, void *destination, IMatError *error)
+{
+    cleanError(error);
+
+    if (destination == NULL)
+    {
+        setError(error, "Destination for %s is not set", node->name);
+        return;
+    }
+
+    ElmementInfo eInfo = {.target = type};
+
+    // Пустой массив (например, [] в cell массиве) может быть записан одним тегом
+    if (node->length == 8)
+        eInfo.type = DT_EMPTY;
+    else
+        decodeMatrixElement(error, &eInfo, &(tree->data[node->offset]), node->length);
+
+    if (error->isErr)
+    {
+        freeElementResult(&eInfo);
+        freeElementInfo(&eInfo);
+        return;
+    }
+
+    // Вложенные массивы записаны без имени, в сообщениях об ошибках - имя поля
+    snprintf(eInfo.name, sizeof(eInfo.name), "%s", node->name);
+
+    switch (type)
+    {
+    case DT_INT:
+        CONVERT_NODE(int, Int);
+        break;
+    case DT_INT_64:
+        CONVERT_NODE(int64_t, Int64);
+        break;
+    case DT_DOUBLE:
+        CONVERT_NODE(double, Double);
+        break;
+    case DT_COMPLEX:
+        CONVERT_NODE(complex double, Complex);
+        break;
+    case DT_VECTOR:
+        CONVERT_NODE(gsl_vector *, Vector);
+        break;
+    case DT_VECTOR_INT:
+        CONVERT_NODE(gsl_vector_int *, VectorInt);
+        break;
+    case DT_VECTOR_COMPLEX:
+        CONVERT_NODE(gsl_vector_complex *, VectorComplex);
+        break;
+    case DT_MATRIX:
+        CONVERT_NODE(gsl_matrix *, Matrix);
+        break;
+    case DT_MATRIX_INT:
+        CONVERT_NODE(gsl_matrix_int *, MatrixInt);
+        break;
+    case DT_MATRIX_COMPLEX:
+        CONVERT_NODE(gsl_matrix_complex *, MatrixComplex);
+        break;
+    case DT_SPARSE:
+        CONVERT_NODE(gsl_spmatrix *, SpMatrix);
+        break;
+    case DT_SPARSE_COMPLEX:
+        CONVERT_NODE(gsl_spmatrix_complex *, SpMatrixComplex);
+        break;
+    case DT_VECTOR_FLOAT:
+        CONVERT_NODE(gsl_vector_float *, VectorFloat);
+        break;
+    case DT_VECTOR_COMPLEX_FLOAT:
+        CONVERT_NODE(gsl_vector_complex_float *, VectorComplexFloat);
+        break;
+    case DT_MATRIX_FLOAT:
+        CONVERT_NODE(gsl_matrix_float *, MatrixFloat);
+        break;
+    case DT_MATRIX_COMPLEX_FLOAT:
+        CONVERT_NODE(gsl_matrix_complex_float *, MatrixComplexFloat);
+        break;
+    case DT_ARRAY:
+        CONVERT_NODE(IMatArray *, Array);
+        break;
+    default:
+        setError(error, "Unsupported type of node request: %s", getDataTypeName(type));
+        freeElementResult(&eInfo);
+        freeElementInfo(&eInfo);
+        break;
+    }
+}
+
+/**
+ * Разбор miMATRIX подэлемента, начинающегося с offset в данных дерева, и (рекурсивно) вложенных в него массивов
+ *
+ * У struct массива после имени идут длина имени поля, имена полей (каждое дополнено нулями до этой длины)
+ * и затем miMATRIX подэлементы полей: все поля первого элемента, все поля второго и т.д.
+ * У объекта перед длиной имени поля записано имя класса. У cell массива сразу идут подэлементы элементов.
+ * Данные листьев не декодируются, запоминается только их положение
+ */
+void parseMatNode(IMatTree *tree, IMatNode *node, size_t offset, int depth, IMatError *error)
+{
+    if (depth > MAX_NODE_DEPTH)
+    {
+        setError(error, "Struct and cell arrays are nested too deep");
+        return;
+    }
+
+    unsigned char *element = &(tree->data[offset]);
+
+    if (offset + 8 > tree->length || readFromByteInt32(element) != MI_MATRIX)
+    {
+        setError(error, "Unexpected format of ungzipted data");
+        return;
+    }
+
+    size_t size = readFromByteUInt32(&element[4]);
+
+    if (offset + 8 + size > tree->length)
+    {
+        setError(error, "Unexpected end of element data");
+        return;
+    }
+
+    node->offset = offset;
+    node->length = 8 + size;
+    node->dimsNumber = 2;
+
+    // Пустой массив может быть записан одним тегом
+    if (size == 0)
+    {
+        node->type = DT_EMPTY;
+        return;
+    }
+
+    IMatVarInfo varInfo;
+    int isComplex;
+
+    varInfo.type = DT_UNKNOWN;
+    int dataStartIndex = handleMatrixHeader(element, node->length, &varInfo, &isComplex, error);
+    if (error->isErr)
+        return;
+
+    memcpy(node->name, varInfo.name, sizeof(node->name));
+    node->type = varInfo.type;
+    node->matClass = varInfo.matClass;
+    node->dimsNumber = varInfo.dimsNumber;
+    memcpy(node->dims, varInfo.dims, sizeof(node->dims));
+
+    if (node->type != DT_STRUCT && node->type != DT_CELL)
+        return;
+
+    long long elementsNumber = (long long)varInfo.sizeI * varInfo.sizeJ;
+    size_t position = offset + dataStartIndex;
+    int dataTypeCode;
+    size_t byteSize;
+
+    // Имя класса объекта
+    if (node->matClass == MX_OBJECT_CLASS)
+    {
+        long tagLength = parseNodeTag(tree->data, position, offset + node->length, &dataTypeCode, &byteSize);
+        position += tagLength;
+
+        if (tagLength < 0)
+        {
+            setError(error, "Unexpected end of element data");
+            return;
+        }
+    }
+
+    if (node->type == DT_STRUCT)
+    {
+        // Длина имени поля (int32) и имена полей
+        long tagLength = parseNodeTag(tree->data, position, offset + node->length, &dataTypeCode, &byteSize);
+        int isSmallData = tagLength == 8 && (tree->data[position + 2] || tree->data[position + 3]);
+        int fieldNameLength = tagLength < 0 ? 0 : readFromByteInt32(&(tree->data[position + (isSmallData ? 4 : 8)]));
+
+        if (tagLength < 0 || byteSize != 4 || fieldNameLength <= 0)
+        {
+            setError(error, "Unexpected length of field names in %s", node->name);
+            return;
+        }
+
+        position += tagLength;
+        tagLength = parseNodeTag(tree->data, position, offset + node->length, &dataTypeCode, &byteSize);
+
+        if (tagLength < 0)
+        {
+            setError(error, "Unexpected end of element data");
+            return;
+        }
+
+        isSmallData = tree->data[position + 2] || tree->data[position + 3];
+        const unsigned char *names = &(tree->data[position + (isSmallData ? 4 : 8)]);
+
+        node->fieldsNumber = (int)(byteSize / fieldNameLength);
+        node->fieldNames = (char **)malloc(node->fieldsNumber * (sizeof(char *) + fieldNameLength + 1) + 1);
+
+        // Строки имен лежат в том же блоке после массива указателей
+        char *namesBlock = (char *)&(node->fieldNames[node->fieldsNumber]);
+
+        for (int f = 0; f < node->fieldsNumber; f++)
+        {
+            node->fieldNames[f] = &namesBlock[f * (fieldNameLength + 1)];
+            memcpy(node->fieldNames[f], &names[f * fieldNameLength], fieldNameLength);
+            node->fieldNames[f][fieldNameLength] = '\0';
+        }
+
+        position += tagLength;
+    }
+
+    long long childrenNumber = node->type == DT_STRUCT ? (long long)elementsNumber * node->fieldsNumber : elementsNumber;
+
+    // Каждый вложенный массив занимает хотя бы тег
+    if (childrenNumber * 8 > (long long)(offset + node->length - position))
+    {
+        setError(error, "Unexpected end of element data");
+        return;
+    }
+
+    node->childrenNumber = (int)childrenNumber;
+    node->children = (IMatNode *)calloc(childrenNumber ? childrenNumber : 1, sizeof(IMatNode));
+
+    for (int k = 0; k < node->childrenNumber; k++)
+    {
+        IMatNode *child = &(node->children[k]);
+
+        if (position + 8 > offset + node->length)
+        {
+            setError(error, "Unexpected end of element data");
+            return;
+        }
+
+        parseMatNode(tree, child, position, depth + 1, error);
+        if (error->isErr)
+            return;
+
+        // Вложенные массивы записаны без имени: у поля struct - имя поля, у элемента cell - пустое
+        if (node->type == DT_STRUCT)
+            snprintf(child->name, sizeof(child->name), "%s", node->fieldNames[k % node->fieldsNumber]);
+        else
+            child->name[0] = '\0';
+
+        position += child->length;
+    }
+}
+
+/**
+ * Разбор тега подэлемента, который начинается с position: small data (данные в самом теге) или обычного
+ *
+ * Возвращаемое значение:
+ * tagLength: long - длина подэлемента вместе с тегом и выравниванием до 8 байт (-1, если он выходит за length)
+ */
+long parseNodeTag(const unsigned char *data, size_t position, size_t length, int *dataTypeCode, size_t *byteSize)
+{
+    if (position + 8 > length)
+        return -1;
+
+    unsigned char *tagField = (unsigned char *)&data[position];
+    int isSmallData = tagField[2] || tagField[3];
+
+    *dataTypeCode = isSmallData ? readFromByteInt16(tagField) : readFromByteInt32(tagField);
+    *byteSize = isSmallData ? (size_t)readFromByteUInt16(&tagField[2]) : readFromByteUInt32(&tagField[4]);
+
+    long tagLength = isSmallData ? 8 : 8 + (long)((*byteSize + 7) / 8 * 8);
+
+    if ((isSmallData && *byteSize > 4) || position + tagLength > length)
+        return -1;
+
+    return tagLength;
+}
+
+/**
+ * Освобождение вложенных узлов (сам узел принадлежит родителю или дереву)
+ */
+void freeMatNode(IMatNode *node)
+{
+    for (int k = 0; k < node->childrenNumber; k++)
+        freeMatNode(&(node->children[k]));
+
+    free(node->children);
+    free(node->fieldNames);
+}
+
+int openMatBatch(IMatBatchItem *items, int itemsNumber, int threadsNumber)
+{
+    for (int i = 0; i < itemsNumber; i++)
+        cleanError(&items[i].error);
+
+    runParallel(readBatchItem, items, itemsNumber, threadsNumber);
+
+    int errorsNumber = 0;
+    for (int i = 0; i < itemsNumber; i++)
+        errorsNumber += items[i].error.isErr;
+
+    return errorsNumber;
+}
+
+int readMatFileBatch(IMatFile *matFile, IMatBatchItem *items, int itemsNumber, int threadsNumber)
+{
+    for (int i = 0; i < itemsNumber; i++)
+        cleanError(&items[i].error);
+
+    // Общий для задач контекст: файл и запросы
+    void *context[2] = {matFile, items};
+
+    runParallel(readFileBatchItem, context, itemsNumber, threadsNumber);
+
+    int errorsNumber = 0;
+    for (int i = 0; i < itemsNumber; i++)
+        errorsNumber += items[i].error.isErr;
+
+    return errorsNumber;
+}
+
+IMatAsync *openMatAsync(IMatBatchItem *item, IMatAsyncCallback callback, void *opaque)
+{
+    cleanError(&item->error);
+
+    IMatAsync *request = (IMatAsync *)calloc(1, sizeof(IMatAsync));
+    if (request == NULL)
+        return NULL;
+
+    request->item = item;
+    request->callback = callback;
+    request->opaque = opaque;
+    atomic_init(&request->isFinished, 0);
+
+#ifdef I_MAT_USE_URING
+    // Чтения ставятся в очередь сразу, фоновый поток только дожидается их и декодирует
+    request->fd = -1;
+    startAsyncReads(request);
+#endif
+
+#ifndef I_MAT_NO_THREADS
+    request->isThreadStarted = pthread_create(&request->thread, NULL, loadMatAsync, request) == 0;
+
+    // Если поток не создался, загружаем в вызывающем потоке
+    if (!request->isThreadStarted)
+        loadMatAsync(request);
+#else
+    loadMatAsync(request);
+#endif
+
+    return request;
+}
+
+int pollMatAsync(IMatAsync *request)
+{
+    return atomic_load(&request->isFinished);
+}
+
+int waitMatAsync(IMatAsync *request)
+{
+#ifndef I_MAT_NO_THREADS
+    if (request->isThreadStarted)
+        pthread_join(request->thread, NULL);
+#endif
+
+    int isErr = request->item->error.isErr;
+    free(request);
+
+    return isErr;
+}
+
+void saveMatInt(char *filePath, char *name, int value, int level, IMatError *error)
+{
+    cleanError(error);
+
+    unsigned char *realData, *imagData;
+    size_t elementLength;
+
+    unsigned char *element = allocateMatrixElement(name, MX_INT32_CLASS, 0, 1, 1, 5, sizeof(int), &realData, &imagData, &elementLength, error);
+    if (error->isErr)
+        return;
+
+    memcpy(realData, &value, sizeof(int));
+
+    saveMatEngine(filePath, element, elementLength, level, error);
+}
+
+void saveMatInt64(char *filePath, char *name, int64_t value, int level, IMatError *error)
+{
+    cleanError(error);
+
+    unsigned char *realData, *imagData;
+    size_t elementLength;
+
+    unsigned char *element = allocateMatrixElement(name, MX_INT64_CLASS, 0, 1, 1, 12, sizeof(int64_t), &realData, &imagData, &elementLength, error);
+    if (error->isErr)
+        return;
+
+    memcpy(realData, &value, sizeof(int64_t));
+
+    saveMatEngine(filePath, element, elementLength, level, error);
+}
+
+void saveMatDouble(char *filePath, char *name, double value, int level, IMatError *error)
+{
+    cleanError(error);
+
+    unsigned char *realData, *imagData;
+    size_t elementLength;
+
+    unsigned char *element = allocateMatrixElement(name, MX_DOUBLE_CLASS, 0, 1, 1, 9, sizeof(double), &realData, &imagData, &elementLength, error);
+    if (error->isErr)
+        return;
+
+    memcpy(realData, &value, sizeof(double));
+
+    saveMatEngine(filePath, element, elementLength, level, error);
+}
+
+void saveMatComplex(char *filePath, char *name, complex double value, int level, IMatError *error)
+{
+    cleanError(error);
+
+    unsigned char *realData, *imagData;
+    size_t elementLength;
+
+    unsigned char *element =
+        allocateMatrixElement(name, MX_DOUBLE_CLASS, ARRAY_FLAG_COMPLEX, 1, 1, 9, sizeof(double), &realData, &imagData, &elementLength, error);
+    if (error->isErr)
+        return;
+
+    ((double *)realData)[0] = creal(value);
+    ((double *)imagData)[0] = cimag(value);
+
+    saveMatEngine(filePath, element, elementLength, level, error);
+}
+
+void saveMatVector(char *filePath, char *name, const gsl_vector *vector, int level, IMatError *error)
+{
+    cleanError(error);
+
+    unsigned char *realData, *imagData;
+    size_t elementLength;
+
+    // gsl вектор записывается как столбец
+    unsigned char *element =
+        allocateMatrixElement(name, MX_DOUBLE_CLASS, 0, vector->size, 1, 9, sizeof(double), &realData, &imagData, &elementLength, error);
+    if (error->isErr)
+        return;
+
+    for (size_t k = 0; k < vector->size; k++)
+        ((double *)realData)[k] = vector->data[k * vector->stride];
+
+    saveMatEngine(filePath, element, elementLength, level, error);
+}
+
+void saveMatVectorInt(char *filePath, char *name, const gsl_vector_int *vector, int level, IMatError *error)
+{
+    cleanError(error);
+
+    unsigned char *realData, *imagData;
+    size_t elementLength;
+
+    unsigned char *element =
+        allocateMatrixElement(name, MX_INT32_CLASS, 0, vector->size, 1, 5, sizeof(int), &realData, &imagData, &elementLength, error);
+    if (error->isErr)
+        return;
+
+    for (size_t k = 0; k < vector->size; k++)
+        ((int *)realData)[k] = vector->data[k * vector->stride];
+
+    saveMatEngine(filePath, element, elementLength, level, error);
+}
+
+void saveMatVectorComplex(char *filePath, char *name, const gsl_vector_complex *vector, int level, IMatError *error)
+{
+    cleanError(error);
+
+    unsigned char *realData, *imagData;
+    size_t elementLength;
+
+    unsigned char *element = allocateMatrixElement(name, MX_DOUBLE_CLASS, ARRAY_FLAG_COMPLEX, vector->size, 1, 9, sizeof(double), &realData,
+                                                   &imagData, &elementLength, error);
+    if (error->isErr)
+        return;
+
+    for (size_t k = 0; k < vector->size; k++)
+    {
+        ((double *)realData)[k] = vector->data[2 * k * vector->stride];
+        ((double *)imagData)[k] = vector->data[2 * k * vector->stride + 1];
+    }
+
+    saveMatEngine(filePath, element, elementLength, level, error);
+}
+
+void saveMatMatrix(char *filePath, char *name, const gsl_matrix *matrix, int level, IMatError *error)
+{
+    cleanError(error);
+
+    unsigned char *realData, *imagData;
+    size_t elementLength;
+
+    unsigned char *element = allocateMatrixElement(name, MX_DOUBLE_CLASS, 0, matrix->size1, matrix->size2, 9, sizeof(double), &realData, &imagData,
+                                                   &elementLength, error);
+    if (error->isErr)
+        return;
+
+    gatherDouble((double *)realData, matrix->data, matrix->tda, matrix->size1, matrix->size2);
+
+    saveMatEngine(filePath, element, elementLength, level, error);
+}
+
+void saveMatMatrixInt(char *filePath, char *name, const gsl_matrix_int *matrix, int level, IMatError *error)
+{
+    cleanError(error);
+
+    unsigned char *realData, *imagData;
+    size_t elementLength;
+
+    unsigned char *element = allocateMatrixElement(name, MX_INT32_CLASS, 0, matrix->size1, matrix->size2, 5, sizeof(int), &realData, &imagData,
+                                                   &elementLength, error);
+    if (error->isErr)
+        return;
+
+    gatherInt((int *)realData, matrix->data, matrix->tda, matrix->size1, matrix->size2);
+
+    saveMatEngine(filePath, element, elementLength, level, error);
+}
+
+void saveMatMatrixComplex(char *filePath, char *name, const gsl_matrix_complex *matrix, int level, IMatError *error)
+{
+    cleanError(error);
+
+    unsigned char *realData, *imagData;
+    size_t elementLength;
+
+    unsigned char *element = allocateMatrixElement(name, MX_DOUBLE_CLASS, ARRAY_FLAG_COMPLEX, matrix->size1, matrix->size2, 9, sizeof(double),
+                                                   &realData, &imagData, &elementLength, error);
+    if (error->isErr)
+        return;
+
+    gatherComplex((double *)realData, (double *)imagData, matrix->data, matrix->tda, matrix->size1, matrix->size2);
+
+    saveMatEngine(filePath, element, elementLength, level, error);
+}
+
+int convertElementToInt(ElmementInfo *eInfo, IMatError *error)
+{
+    int result = 0;
+
+    if (eInfo->type != DT_INT)
+    {
+        setError(error, "Got error while reading %s. Expected %s, but readed %s", eInfo->name, getDataTypeName(DT_INT),
+                 getDataTypeName(eInfo->type));
+    }
+    else
+    {
+        result = eInfo->dataInt32[0];
+    }
+
+    freeElementInfo(eInfo);
+    return result;
+}
+
+int64_t convertElementToInt64(ElmementInfo *eInfo, IMatError *error)
+{
+    int64_t result = 0;
+
+    if (eInfo->type != DT_INT_64)
+    {
+        setError(error, "Got error while reading %s. Expected %s, but readed %s", eInfo->name, getDataTypeName(DT_INT_64),
+                 getDataTypeName(eInfo->type));
+    }
+    else
+    {
+        result = eInfo->dataInt[0];
+    }
+
+    freeElementInfo(eInfo);
+    return result;
+}
+
+double convertElementToDouble(ElmementInfo *eInfo, IMatError *error)
+{
+    double result = 0;
+
+    // TODO убрать dtint
+    if (eInfo->type != DT_DOUBLE && eInfo->type != DT_INT)
+    {
+        setError(error, "Got error while reading %s. Expected %s, but readed %s", eInfo->name, getDataTypeName(DT_DOUBLE),
+                 getDataTypeName(eInfo->type));
+    }
+    else
+    {
+        result = eInfo->dataDouble[0];
+    }
+
+    freeElementInfo(eInfo);
+    return result;
+}
+
+complex double convertElementToComplex(ElmementInfo *eInfo, IMatError *error)
+{
+    complex double result = 0;
+
+    if (eInfo->type != DT_COMPLEX)
+    {
+        setError(error, "Got error while reading %s. Expected %s, but readed %s", eInfo->name, getDataTypeName(DT_COMPLEX),
+                 getDataTypeName(eInfo->type));
+    }
+    else
+    {
+        result = eInfo->dataDouble[0] + I * eInfo->dataDouble[1];
+    }
+
+    freeElementInfo(eInfo);
+    return result;
+}
+
+gsl_vector *convertElementToVector(ElmementInfo *eInfo, IMatError *error)
+{
+    // Результат уже собран при потоковом разжатии
+    if (eInfo->result != NULL)
+        return (gsl_vector *)eInfo->result;
+
+    gsl_vector *result = NULL;
+
+    size_t elemsNumber = (size_t)eInfo->sizeI * eInfo->sizeJ;
+
+    // Целые данные уже декодированы в double
+    if (!isTypeCompatible(DT_VECTOR, eInfo->type))
+    {
+        setError(error, "Got error while reading %s. Expected %s, but readed %s", eInfo->name, getDataTypeName(DT_VECTOR),
+                 getDataTypeName(eInfo->type));
+        freeElementInfo(eInfo);
+        return result;
+    }
+
+    result = gsl_vector_alloc(elemsNumber);
+
+    if (elemsNumber)
+        memcpy(result->data, eInfo->dataDouble, sizeof(double) * elemsNumber);
+
+    freeElementInfo(eInfo);
+    return result;
+}
+
+gsl_vector_int *convertElementToVectorInt(ElmementInfo *eInfo, IMatError *error)
+{
+    // Результат уже собран при потоковом разжатии
+    if (eInfo->result != NULL)
+        return (gsl_vector_int *)eInfo->result;
+
+    gsl_vector_int *result = NULL;
+
+    if (eInfo->type != DT_VECTOR_INT && eInfo->type != DT_INT && eInfo->type != DT_EMPTY)
+    {
+        setError(error, "Got error while reading %s. Expected %s, but readed %s", eInfo->name, getDataTypeName(DT_VECTOR_INT),
+                 getDataTypeName(eInfo->type));
+        freeElementInfo(eInfo);
+        return result;
+    }
+
+    size_t elemsNumber = (size_t)eInfo->sizeI * eInfo->sizeJ;
+
+    result = gsl_vector_int_alloc(elemsNumber);
+
+    if (elemsNumber)
+        memcpy(result->data, eInfo->dataInt32, sizeof(int) * elemsNumber);
+
+    freeElementInfo(eInfo);
+    return result;
+}
+
+gsl_vector_complex *convertElementToVectorComplex(ElmementInfo *eInfo, IMatError *error)
+{
+    // Результат уже собран при потоковом разжатии
+    if (eInfo->result != NULL)
+        return (gsl_vector_complex *)eInfo->result;
+
+    gsl_vector_complex *result = NULL;
+
+    if (eInfo->type != DT_VECTOR_COMPLEX && eInfo->type != DT_COMPLEX && eInfo->type != DT_EMPTY)
+    {
+        setError(error, "Got error while reading %s. Expected %s, but readed %s", eInfo->name, getDataTypeName(DT_VECTOR_COMPLEX),
+                 getDataTypeName(eInfo->type));
+        freeElementInfo(eInfo);
+        return result;
+    }
+
+    size_t elemsNumber = (size_t)eInfo->sizeI * eInfo->sizeJ;
+
+    result = gsl_vector_complex_alloc(elemsNumber);
+
+    for (size_t i = 0; i < elemsNumber; i++)
+    {
+        gsl_vector_complex_set(result, i, eInfo->dataDouble[i] + I * eInfo->dataDouble[i + elemsNumber]);
+    }
+
+    freeElementInfo(eInfo);
+    return result;
+}
+
+gsl_matrix *convertElementToMatrix(ElmementInfo *eInfo, IMatError *error)
+{
+    // Результат уже собран при потоковом разжатии
+    if (eInfo->result != NULL)
+        return (gsl_matrix *)eInfo->result;
+
+    gsl_matrix *result = NULL;
+
+    // Целые данные уже декодированы в double
+    if (!isTypeCompatible(DT_MATRIX, eInfo->type))
+    {
+        setError(error, "Got error while reading %s. Expected %s, but readed %s", eInfo->name, getDataTypeName(DT_MATRIX),
+                 getDataTypeName(eInfo->type));
+        freeElementInfo(eInfo);
+        return result;
+    }
+
+    result = gsl_matrix_alloc(eInfo->sizeI, eInfo->sizeJ);
+
+    transposeDouble(result->data, result->tda, eInfo->dataDouble, eInfo->sizeI, eInfo->sizeJ);
+
+    freeElementInfo(eInfo);
+    return result;
+}
+
+gsl_matrix_int *convertElementToMatrixInt(ElmementInfo *eInfo, IMatError *error)
+{
+    // Результат уже собран при потоковом разжатии
+    if (eInfo->result != NULL)
+        return (gsl_matrix_int *)eInfo->result;
+
+    gsl_matrix_int *result = NULL;
+
+    if (eInfo->type != DT_MATRIX_INT && eInfo->type != DT_VECTOR_INT && eInfo->type != DT_INT && eInfo->type != DT_EMPTY)
+    {
+        setError(error, "Got error while reading %s. Expected %s, but readed %s", eInfo->name, getDataTypeName(DT_MATRIX_INT),
+                 getDataTypeName(eInfo->type));
+        freeElementInfo(eInfo);
+        return result;
+    }
+
+    result = gsl_matrix_int_alloc(eInfo->sizeI, eInfo->sizeJ);
+
+    transposeInt(result->data, result->tda, eInfo->dataInt32, eInfo->sizeI, eInfo->sizeJ);
+
+    freeElementInfo(eInfo);
+    return result;
+}
+
+gsl_matrix_complex *convertElementToMatrixComplex(ElmementInfo *eInfo, IMatError *error)
+{
+    // Результат уже собран при потоковом разжатии
+    if (eInfo->result != NULL)
+        return (gsl_matrix_complex *)eInfo->result;
+
+    gsl_matrix_complex *result = NULL;
+
+    if (eInfo->type != DT_MATRIX_COMPLEX && eInfo->type != DT_VECTOR_COMPLEX && eInfo->type != DT_COMPLEX && eInfo->type != DT_EMPTY)
+    {
+        setError(error, "Got error while reading %s. Expected %s, but readed %s", eInfo->name, getDataTypeName(DT_MATRIX_COMPLEX),
+                 getDataTypeName(eInfo->type));
+        freeElementInfo(eInfo);
+        return result;
+    }
+
+    result = gsl_matrix_complex_alloc(eInfo->sizeI, eInfo->sizeJ);
+
+    transposeComplex(result->data, result->tda, eInfo->dataDouble, eInfo->sizeI, eInfo->sizeJ);
+
+    freeElementInfo(eInfo);
+    return result;
+}
+
+gsl_vector_float *convertElementToVectorFloat(ElmementInfo *eInfo, IMatError *error)
+{
+    // Непустые векторы декодируются сразу в результат, здесь остается только пустой элемент
+    if (eInfo->result != NULL)
+        return (gsl_vector_float *)eInfo->result;
+
+    gsl_vector_float *result = NULL;
+
+    if (!isTypeCompatible(DT_VECTOR_FLOAT, eInfo->type))
+    {
+        setError(error, "Got error while reading %s. Expected %s, but readed %s", eInfo->name, getDataTypeName(DT_VECTOR_FLOAT),
+                 getDataTypeName(eInfo->type));
+        freeElementInfo(eInfo);
+        return result;
+    }
+
+    result = gsl_vector_float_alloc((size_t)eInfo->sizeI * eInfo->sizeJ);
+
+    freeElementInfo(eInfo);
+    return result;
+}
+
+gsl_vector_complex_float *convertElementToVectorComplexFloat(ElmementInfo *eInfo, IMatError *error)
+{
+    if (eInfo->result != NULL)
+        return (gsl_vector_complex_float *)eInfo->result;
+
+    gsl_vector_complex_float *result = NULL;
+
+    if (!isTypeCompatible(DT_VECTOR_COMPLEX_FLOAT, eInfo->type))
+    {
+        setError(error, "Got error while reading %s. Expected %s, but readed %s", eInfo->name, getDataTypeName(DT_VECTOR_COMPLEX_FLOAT),
+                 getDataTypeName(eInfo->type));
+        freeElementInfo(eInfo);
+        return result;
+    }
+
+    result = gsl_vector_complex_float_alloc((size_t)eInfo->sizeI * eInfo->sizeJ);
+
+    freeElementInfo(eInfo);
+    return result;
+}
+
+gsl_matrix_float *convertElementToMatrixFloat(ElmementInfo *eInfo, IMatError *error)
+{
+    // Результат уже собран при потоковом разжатии
+    if (eInfo->result != NULL)
+        return (gsl_matrix_float *)eInfo->result;
+
+    gsl_matrix_float *result = NULL;
+
+    // double и целые данные уже декодированы в float
+    if (!isTypeCompatible(DT_MATRIX_FLOAT, eInfo->type))
+    {
+        setError(error, "Got error while reading %s. Expected %s, but readed %s", eInfo->name, getDataTypeName(DT_MATRIX_FLOAT),
+                 getDataTypeName(eInfo->type));
+        freeElementInfo(eInfo);
+        return result;
+    }
+
+    result = gsl_matrix_float_alloc(eInfo->sizeI, eInfo->sizeJ);
+
+    transposeFloat(result->data, result->tda, eInfo->dataFloat, eInfo->sizeI, eInfo->sizeJ);
+
+    freeElementInfo(eInfo);
+    return result;
+}
+
+gsl_matrix_complex_float *convertElementToMatrixComplexFloat(ElmementInfo *eInfo, IMatError *error)
+{
+    // Результат уже собран при потоковом разжатии
+    if (eInfo->result != NULL)
+        return (gsl_matrix_complex_float *)eInfo->result;
+
+    gsl_matrix_complex_float *result = NULL;
+
+    if (!isTypeCompatible(DT_MATRIX_COMPLEX_FLOAT, eInfo->type))
+    {
+        setError(error, "Got error while reading %s. Expected %s, but readed %s", eInfo->name, getDataTypeName(DT_MATRIX_COMPLEX_FLOAT),
+                 getDataTypeName(eInfo->type));
+        freeElementInfo(eInfo);
+        return result;
+    }
+
+    result = gsl_matrix_complex_float_alloc(eInfo->sizeI, eInfo->sizeJ);
+
+    transposeComplexFloat(result->data, result->tda, eInfo->dataFloat, eInfo->sizeI, eInfo->sizeJ);
+
+    freeElementInfo(eInfo);
+    return result;
+}
+
+IMatArray *convertElementToArray(ElmementInfo *eInfo, IMatError *error)
+{
+    // Результат уже собран при потоковом разжатии или транспонирован прямо из данных элемента
+    if (eInfo->result != NULL)
+        return (IMatArray *)eInfo->result;
+
+    IMatArray *result = NULL;
+
+    if (!isTypeCompatible(DT_ARRAY, eInfo->type))
+    {
+        setError(error, "Got error while reading %s. Expected %s, but readed %s", eInfo->name, getDataTypeName(DT_ARRAY),
+                 getDataTypeName(eInfo->type));
+        freeElementInfo(eInfo);
+        return result;
+    }
+
+    result = allocateMatArray(eInfo->dimsNumber, eInfo->dims);
+
+    if (eInfo->dataDouble != NULL)
+        transposeArrayPages(result, eInfo->dataDouble);
+
+    freeElementInfo(eInfo);
+    return result;
+}
+
+/**
+ * Выделение N-мерного массива: страницы dims[0] x dims[1] по строкам, страницы подряд
+ */
+IMatArray *allocateMatArray(int dimsNumber, const int *dims)
+{
+    IMatArray *array = (IMatArray *)calloc(1, sizeof(IMatArray));
+    size_t pageStride = (size_t)dims[0] * dims[1];
+
+    array->dimsNumber = dimsNumber;
+    array->dims[0] = dims[0];
+    array->dims[1] = dims[1];
+    array->strides[0] = dims[1];
+    array->strides[1] = 1;
+
+    for (int k = 2; k < dimsNumber; k++)
+    {
+        array->dims[k] = dims[k];
+        array->strides[k] = pageStride;
+        pageStride *= dims[k];
+    }
+
+    array->data = (double *)malloc(sizeof(double) * (pageStride ? pageStride : 1));
+    return array;
+}
+
+/**
+ * Транспонирование страниц из порядка matlab (все данные по столбцам) в страницы по строкам
+ */
+void transposeArrayPages(IMatArray *array, const double *source)
+{
+    size_t pageSize = (size_t)array->dims[0] * array->dims[1];
+    size_t pagesNumber = getMatArrayPagesNumber(array);
+
+    for (size_t page = 0; page < pagesNumber; page++)
+        transposeDouble(&(array->data[page * pageSize]), array->dims[1], &source[page * pageSize], array->dims[0], array->dims[1]);
+}
+
+gsl_spmatrix *convertElementToSpMatrix(ElmementInfo *eInfo, IMatError *error)
+{
+    // CSC матрица собирается прямо при разборе элемента
+    if (eInfo->result != NULL)
+        return (gsl_spmatrix *)eInfo->result;
+
+    setError(error, "Got error while reading %s. Expected %s, but readed %s", eInfo->name, getDataTypeName(DT_SPARSE), getDataTypeName(eInfo->type));
+    freeElementInfo(eInfo);
+    return NULL;
+}
+
+gsl_spmatrix_complex *convertElementToSpMatrixComplex(ElmementInfo *eInfo, IMatError *error)
+{
+    if (eInfo->result != NULL)
+        return (gsl_spmatrix_complex *)eInfo->result;
+
+    setError(error, "Got error while reading %s. Expected %s, but readed %s", eInfo->name, getDataTypeName(DT_SPARSE_COMPLEX),
+             getDataTypeName(eInfo->type));
+    freeElementInfo(eInfo);
+    return NULL;
+}
+
+/**
+ * Чтение единственной переменной mat файла
+ *
+ * Замер статистики только начинается: вызывающая функция завершает его через finishMatStats
+ * после convertElementTo*, чтобы обработчик видел итоговую ошибку и время сборки результата
+ */
+void openMatEngine(char *filePath, ElmementInfo *eInfo, MatStatsState *stats, IMatError *error)
+{
+    // Без обработчика статистики (и во вложенном чтении) ничего не замеряется
+    stats->callback = NULL;
+    if (statsCallback != NULL && threadStats == NULL)
+        beginMatStats(stats, filePath, NULL);
+
+    readMatEngine(filePath, eInfo, error);
+}
+
+/**
+ * Чтение единственной переменной mat файла (openMatEngine без статистики)
+ */
+void readMatEngine(char *filePath, ElmementInfo *eInfo, IMatError *error)
+{
+    MatCacheEntry cacheEntry;
+
+    // Переменная из кэша (setMatCacheDir) не разжимается и не транспонируется
+    if (describeCacheEntry(filePath, NULL, eInfo, &cacheEntry) && readCachedResult(&cacheEntry, eInfo))
+    {
+        if (threadStats != NULL)
+            threadStats->stats.isCached = 1;
+        return;
+    }
+
+    uint64_t readStart = STATS_START();
+
+    FILE *file = fopen(filePath, "rb");
+    if (file == NULL)
+    {
+        setError(error, "Unable to open file: %s", filePath);
+        return;
+    }
+
+    int version = handleMatHeader(file, error);
+    if (error->isErr)
+    {
+        fclose(file);
+        return;
+    }
+
+    STATS_ADD(readNs, readStart);
+
+    if (version == MAT_VERSION_73)
+    {
+        fclose(file);
+#ifdef I_MAT_USE_HDF5
+        openMatH5Engine(filePath, eInfo, error);
+#else
+        setError(error, "MAT v7.3 (HDF5) files are supported only when built with -DI_MAT_USE_HDF5");
+#endif
+    }
+    else
+    {
+        handleElement(file, error, eInfo);
+        fclose(file);
+    }
+
+    if (cacheEntry.isActive && !error->isErr)
+        writeCachedResult(&cacheEntry, eInfo, error);
+}
+
+/**
+ * Чтение переменной по имени из открытого mat файла (статистика - как в openMatEngine)
+ */
+void openMatFileEngine(IMatFile *matFile, char *name, ElmementInfo *eInfo, MatStatsState *stats, IMatError *error)
+{
+    stats->callback = NULL;
+    if (statsCallback != NULL && threadStats == NULL)
+        beginMatStats(stats, matFile->filePath, name);
+
+    readMatFileEngine(matFile, name, eInfo, error);
+}
+
+/**
+ * Чтение переменной по имени из открытого mat файла (openMatFileEngine без статистики)
+ */
+void readMatFileEngine(IMatFile *matFile, char *name, ElmementInfo *eInfo, IMatError *error)
+{
+    MatCacheEntry cacheEntry;
+
+    if (describeCacheEntry(matFile->filePath, name, eInfo, &cacheEntry) && readCachedResult(&cacheEntry, eInfo))
+    {
+        if (threadStats != NULL)
+            threadStats->stats.isCached = 1;
+        return;
+    }
+
+#ifdef I_MAT_USE_HDF5
+    if (matFile->h5File != H5I_INVALID_HID)
+        readMatH5Variable(matFile->h5File, name, eInfo, error);
+    else
+#endif
+    {
+        int varIndex = 0;
+
+        while (varIndex < matFile->varsNumber && strcmp(matFile->vars[varIndex].name, name) != 0)
+            varIndex++;
+
+        if (varIndex == matFile->varsNumber)
+        {
+            setError(error, "Variable %s not found", name);
+            return;
+        }
+
+        handleElementAt(matFile, &(matFile->vars[varIndex]), error, eInfo);
+    }
+
+    if (cacheEntry.isActive && !error->isErr)
+        writeCachedResult(&cacheEntry, eInfo, error);
+}
+
+/**
+ * Освобождает данные, прочитанные из элемента
+ */
+void freeElementInfo(ElmementInfo *eInfo)
+{
+    releaseScratch(eInfo->dataInt);
+    releaseScratch(eInfo->dataInt32);
+    releaseScratch(eInfo->dataDouble);
+    releaseScratch(eInfo->dataFloat);
+    releaseScratch(eInfo->zipData);
+
+    eInfo->dataInt = NULL;
+    eInfo->dataInt32 = NULL;
+    eInfo->dataDouble = NULL;
+    eInfo->dataFloat = NULL;
+    eInfo->zipData = NULL;
+}
+
+/**
+ * Освобождает результат потокового разжатия (например, при ошибке посреди данных)
+ */
+void freeElementResult(ElmementInfo *eInfo)
+{
+    switch (eInfo->target)
+    {
+    case DT_VECTOR:
+        gsl_vector_free((gsl_vector *)eInfo->result);
+        break;
+    case DT_VECTOR_INT:
+        gsl_vector_int_free((gsl_vector_int *)eInfo->result);
+        break;
+    case DT_VECTOR_COMPLEX:
+        gsl_vector_complex_free((gsl_vector_complex *)eInfo->result);
+        break;
+    case DT_MATRIX:
+        gsl_matrix_free((gsl_matrix *)eInfo->result);
+        break;
+    case DT_MATRIX_INT:
+        gsl_matrix_int_free((gsl_matrix_int *)eInfo->result);
+        break;
+    case DT_MATRIX_COMPLEX:
+        gsl_matrix_complex_free((gsl_matrix_complex *)eInfo->result);
+        break;
+    case DT_SPARSE:
+        gsl_spmatrix_free((gsl_spmatrix *)eInfo->result);
+        break;
+    case DT_SPARSE_COMPLEX:
+        gsl_spmatrix_complex_free((gsl_spmatrix_complex *)eInfo->result);
+        break;
+    case DT_VECTOR_FLOAT:
+        gsl_vector_float_free((gsl_vector_float *)eInfo->result);
+        break;
+    case DT_VECTOR_COMPLEX_FLOAT:
+        gsl_vector_complex_float_free((gsl_vector_complex_float *)eInfo->result);
+        break;
+    case DT_MATRIX_FLOAT:
+        gsl_matrix_float_free((gsl_matrix_float *)eInfo->result);
+        break;
+    case DT_MATRIX_COMPLEX_FLOAT:
+        gsl_matrix_complex_float_free((gsl_matrix_complex_float *)eInfo->result);
+        break;
+    case DT_ARRAY:
+        freeMatArray((IMatArray *)eInfo->result);
+        break;
+    default:
+        break;
+    }
+
+    eInfo->result = NULL;
+}
+
+/**
+ * Запись кэша декодированной переменной для файла и имени переменной
+ *
+ * Файл кэша называется по хэшу пути, имени и типа результата. Заголовок хранит второй хэш пути
+ * и имени, а также размер, время изменения (с наносекундами) и inode mat файла на момент чтения: если mat файл
+ * изменился, запись просто не совпадет и будет перезаписана
+ *
+ * Возвращаемый параметр: 1, если кэш включен и для результата такого типа его можно использовать
+ */
+int describeCacheEntry(char *filePath, const char *name, ElmementInfo *eInfo, MatCacheEntry *entry)
+{
+    entry->isActive = 0;
+
+    if (matCacheDir == NULL || !isDenseTarget(eInfo->target))
+        return 0;
+
+    struct stat fileStat;
+    if (stat(filePath, &fileStat) != 0)
+        return 0;
+
+    if (name == NULL)
+        name = "";
+
+    int32_t key[2] = {eInfo->target, eInfo->columnMajor};
+    uint64_t fileHash = hashCacheKey(CACHE_HASH_BASIS, filePath, strlen(filePath) + 1);
+    fileHash = hashCacheKey(fileHash, name, strlen(name) + 1);
+
+    memset(&entry->header, 0, sizeof(MatCacheHeader));
+    memcpy(entry->header.magic, CACHE_MAGIC, 8);
+    entry->header.keyHash = hashCacheKey(~fileHash, filePath, strlen(filePath) + 1);
+    entry->header.fileSize = fileStat.st_size;
+    entry->header.fileTime = fileStat.st_mtime;
+    entry->header.fileTimeNs = STAT_MTIME_NS(fileStat);
+    entry->header.fileInode = fileStat.st_ino;
+    entry->header.target = key[0];
+    entry->header.columnMajor = key[1];
+
+    fileHash = hashCacheKey(fileHash, key, sizeof(key));
+
+    int length = snprintf(entry->path, sizeof(entry->path), "%s/%016llx%s", matCacheDir, (unsigned long long)fileHash, CACHE_FILE_SUFFIX);
+    if (length < 0 || length >= (int)sizeof(entry->path) - 16)
+        return 0;
+
+    entry->isActive = 1;
+    return 1;
+}
+
+/**
+ * Чтение результата из кэша в новую gsl структуру (eInfo->result)
+ *
+ * Данные лежат в файле кэша в том же порядке, что и в блоке gsl, поэтому читаются одним fread
+ * прямо в блок результата
+ *
+ * Возвращаемый параметр: 1, если результат найден
+ */
+int readCachedResult(MatCacheEntry *entry, ElmementInfo *eInfo)
+{
+    FILE *file = fopen(entry->path, "rb");
+    if (file == NULL)
+        return 0;
+
+    MatCacheHeader header;
+    eInfo->result = NULL;
+
+    int isValid = fread(&header, sizeof(MatCacheHeader), 1, file) == 1 &&
+                  memcmp(&header, &entry->header, offsetof(MatCacheHeader, size1)) == 0 && header.size1 > 0 && header.size2 > 0;
+
+    if (isValid)
+    {
+        size_t dataLength;
+        void *data;
+
+        eInfo->result = allocateCacheResult(eInfo->target, header.size1, header.size2, &data, &dataLength);
+
+        if (fread(data, 1, dataLength, file) != dataLength)
+            freeElementResult(eInfo);
+    }
+
+    fclose(file);
+
+    // Класс и размеры переменной для статистики - как при чтении из mat файла
+    if (eInfo->result != NULL && threadStats != NULL)
+    {
+        threadStats->stats.matClass = header.matClass;
+        threadStats->stats.dimsNumber = header.dimsNumber > 0 && header.dimsNumber <= I_MAT_MAX_DIMS ? header.dimsNumber : 0;
+        memcpy(threadStats->stats.dims, header.dims, sizeof(threadStats->stats.dims));
+    }
+
+    // Время изменения файла кэша - время последнего обращения для вытеснения
+    if (eInfo->result != NULL)
+        utime(entry->path, NULL);
+
+    return eInfo->result != NULL;
+}
+
+/**
+ * Сборка результата и запись его в кэш
+ *
+ * Результат собирается здесь же (convertElementToResult), поэтому convertElementTo* вызывающей
+ * функции вернет уже готовый eInfo->result. Ошибки записи кэша не считаются ошибками чтения
+ */
+void writeCachedResult(MatCacheEntry *entry, ElmementInfo *eInfo, IMatError *error)
+{
+    eInfo->result = convertElementToResult(eInfo, error);
+    if (error->isErr || eInfo->result == NULL)
+        return;
+
+    size_t dataLength;
+    const void *data = describeCacheResult(eInfo->target, eInfo->result, &entry->header.size1, &entry->header.size2, &dataLength);
+    if (data == NULL)
+        return;
+
+    entry->header.matClass = eInfo->matClass;
+    entry->header.dimsNumber = eInfo->dimsNumber;
+    memcpy(entry->header.dims, eInfo->dims, sizeof(entry->header.dims));
+
+    // Одну и ту же запись могут писать сразу несколько потоков (openMatBatch) и процессов
+    char temporaryPath[sizeof(entry->path) + 16];
+    snprintf(temporaryPath, sizeof(temporaryPath), "%s.XXXXXX", entry->path);
+
+    int fd = mkstemp(temporaryPath);
+    if (fd < 0)
+        return;
+
+    FILE *file = fdopen(fd, "wb");
+    if (file == NULL)
+    {
+        close(fd);
+        remove(temporaryPath);
+        return;
+    }
+
+    int isWritten = fwrite(&entry->header, sizeof(MatCacheHeader), 1, file) == 1 && fwrite(data, 1, dataLength, file) == dataLength;
+
+    if (fclose(file) == 0 && isWritten && rename(temporaryPath, entry->path) == 0)
+        evictCachedResults();
+    else
+        remove(temporaryPath);
+}
+
+/**
+ * Сборка gsl структуры типа eInfo->target из прочитанного элемента
+ */
+void *convertElementToResult(ElmementInfo *eInfo, IMatError *error)
+{
+    switch (eInfo->target)
+    {
+    case DT_VECTOR:
+        return convertElementToVector(eInfo, error);
+    case DT_VECTOR_INT:
+        return convertElementToVectorInt(eInfo, error);
+    case DT_VECTOR_COMPLEX:
+        return convertElementToVectorComplex(eInfo, error);
+    case DT_MATRIX:
+        return convertElementToMatrix(eInfo, error);
+    case DT_MATRIX_INT:
+        return convertElementToMatrixInt(eInfo, error);
+    case DT_MATRIX_COMPLEX:
+        return convertElementToMatrixComplex(eInfo, error);
+    case DT_VECTOR_FLOAT:
+        return convertElementToVectorFloat(eInfo, error);
+    case DT_VECTOR_COMPLEX_FLOAT:
+        return convertElementToVectorComplexFloat(eInfo, error);
+    case DT_MATRIX_FLOAT:
+        return convertElementToMatrixFloat(eInfo, error);
+    case DT_MATRIX_COMPLEX_FLOAT:
+        return convertElementToMatrixComplexFloat(eInfo, error);
+    case DT_ARRAY:
+        return convertElementToArray(eInfo, error);
+    default:
+        return NULL;
+    }
+}
+
+/**
+ * Выделение gsl структуры типа target размера size1 x size2 (вектор - size1 x 1)
+ *
+ * Возвращаемый параметр: структура, data и dataLength - ее блок данных и его размер в байтах
+ */
+void *allocateCacheResult(enum EDataTypes target, size_t size1, size_t size2, void **data, size_t *dataLength)
+{
+    void *result = NULL;
+
+    switch (target)
+    {
+    case DT_VECTOR:
+        result = gsl_vector_alloc(size1);
+        *data = ((gsl_vector *)result)->data;
+        *dataLength = size1 * sizeof(double);
+        break;
+    case DT_VECTOR_INT:
+        result = gsl_vector_int_alloc(size1);
+        *data = ((gsl_vector_int *)result)->data;
+        *dataLength = size1 * sizeof(int);
+        break;
+    case DT_VECTOR_COMPLEX:
+        result = gsl_vector_complex_alloc(size1);
+        *data = ((gsl_vector_complex *)result)->data;
+        *dataLength = size1 * 2 * sizeof(double);
+        break;
+    case DT_MATRIX:
+        result = gsl_matrix_alloc(size1, size2);
+        *data = ((gsl_matrix *)result)->data;
+        *dataLength = size1 * size2 * sizeof(double);
+        break;
+    case DT_MATRIX_INT:
+        result = gsl_matrix_int_alloc(size1, size2);
+        *data = ((gsl_matrix_int *)result)->data;
+        *dataLength = size1 * size2 * sizeof(int);
+        break;
+    case DT_MATRIX_COMPLEX:
+        result = gsl_matrix_complex_alloc(size1, size2);
+        *data = ((gsl_matrix_complex *)result)->data;
+        *dataLength = size1 * size2 * 2 * sizeof(double);
+        break;
+    case DT_VECTOR_FLOAT:
+        result = gsl_vector_float_alloc(size1);
+        *data = ((gsl_vector_float *)result)->data;
+        *dataLength = size1 * sizeof(float);
+        break;
+    case DT_VECTOR_COMPLEX_FLOAT:
+        result = gsl_vector_complex_float_alloc(size1);
+        *data = ((gsl_vector_complex_float *)result)->data;
+        *dataLength = size1 * 2 * sizeof(float);
+        break;
+    case DT_MATRIX_FLOAT:
+        result = gsl_matrix_float_alloc(size1, size2);
+        *data = ((gsl_matrix_float *)result)->data;
+        *dataLength = size1 * size2 * sizeof(float);
+        break;
+    case DT_MATRIX_COMPLEX_FLOAT:
+        result = gsl_matrix_complex_float_alloc(size1, size2);
+        *data = ((gsl_matrix_complex_float *)result)->data;
+        *dataLength = size1 * size2 * 2 * sizeof(float);
+        break;
+    default:
+        break;
+    }
+
+    return result;
+}
+
+/**
+ * Размеры и данные gsl структуры типа target для записи в кэш
+ *
+ * Возвращаемый параметр: начало данных или NULL, если данные лежат не подряд (stride, tda) или пусты
+ */
+const void *describeCacheResult(enum EDataTypes target, const void *result, uint64_t *size1, uint64_t *size2, size_t *dataLength)
+{
+    const void *data = NULL;
+    size_t step = 0;
+    size_t elementSize = 0;
+
+    switch (target)
+    {
+    case DT_VECTOR:
+    case DT_VECTOR_INT:
+    case DT_VECTOR_COMPLEX:
+    case DT_VECTOR_FLOAT:
+    case DT_VECTOR_COMPLEX_FLOAT:
+        // Векторы gsl разных типов имеют одинаковое начало: size, stride, data
+        *size1 = ((const gsl_vector *)result)->size;
+        *size2 = 1;
+        // Подряд лежит только вектор с stride == 1 == size2
+        step = ((const gsl_vector *)result)->stride;
+        data = ((const gsl_vector *)result)->data;
+        break;
+    case DT_MATRIX:
+    case DT_MATRIX_INT:
+    case DT_MATRIX_COMPLEX:
+    case DT_MATRIX_FLOAT:
+    case DT_MATRIX_COMPLEX_FLOAT:
+        // Так же у матриц: size1, size2, tda, data
+        *size1 = ((const gsl_matrix *)result)->size1;
+        *size2 = ((const gsl_matrix *)result)->size2;
+        step = ((const gsl_matrix *)result)->tda;
+        data = ((const gsl_matrix *)result)->data;
+        break;
+    default:
+        return NULL;
+    }
+
+    switch (target)
+    {
+    case DT_VECTOR_INT:
+    case DT_MATRIX_INT:
+        elementSize = sizeof(int);
+        break;
+    case DT_VECTOR_COMPLEX:
+    case DT_MATRIX_COMPLEX:
+        elementSize = 2 * sizeof(double);
+        break;
+    case DT_VECTOR_FLOAT:
+    case DT_MATRIX_FLOAT:
+        elementSize = sizeof(float);
+        break;
+    case DT_VECTOR_COMPLEX_FLOAT:
+    case DT_MATRIX_COMPLEX_FLOAT:
+        elementSize = 2 * sizeof(float);
+        break;
+    default:
+        elementSize = sizeof(double);
+        break;
+    }
+
+    if (*size1 == 0 || *size2 == 0 || step != *size2)
+        return NULL;
+
+    *dataLength = *size1 * *size2 * elementSize;
+    return data;
+}
+
+/**
+ * Вытеснение давно не использованных записей, пока кэш больше matCacheMaxBytes
+ */
+void evictCachedResults(void)
+{
+#ifdef I_MAT_USE_CACHE_EVICTION
+    if (matCacheMaxBytes == 0)
+        return;
+
+    char *pattern = (char *)malloc(strlen(matCacheDir) + strlen(CACHE_FILE_SUFFIX) + 3);
+    glob_t found;
+
+    sprintf(pattern, "%s/*%s", matCacheDir, CACHE_FILE_SUFFIX);
+    int ret = glob(pattern, 0, NULL, &found);
+    free(pattern);
+
+    if (ret != 0)
+        return;
+
+    CacheFileInfo *files = (CacheFileInfo *)malloc(sizeof(CacheFileInfo) * (found.gl_pathc + 1));
+    int filesNumber = 0;
+    size_t totalSize = 0;
+
+    for (size_t i = 0; i < found.gl_pathc; i++)
+    {
+        struct stat fileStat;
+        if (stat(found.gl_pathv[i], &fileStat) != 0)
+            continue;
+
+        files[filesNumber].path = found.gl_pathv[i];
+        files[filesNumber].size = fileStat.st_size;
+        files[filesNumber].accessTime = fileStat.st_mtime;
+        totalSize += fileStat.st_size;
+        filesNumber++;
+    }
+
+    if (totalSize > matCacheMaxBytes)
+    {
+        qsort(files, filesNumber, sizeof(CacheFileInfo), compareCacheFiles);
+
+        for (int i = 0; i < filesNumber && totalSize > matCacheMaxBytes; i++)
+            if (remove(files[i].path) == 0)
+                totalSize -= files[i].size;
+    }
+
+    free(files);
+    globfree(&found);
+#endif
+}
+
+int compareCacheFiles(const void *left, const void *right)
+{
+    int64_t leftTime = ((const CacheFileInfo *)left)->accessTime;
+    int64_t rightTime = ((const CacheFileInfo *)right)->accessTime;
+
+    return (leftTime > rightTime) - (leftTime < rightTime);
+}
+
+/**
+ * FNV-1a хэш, продолжающий hash
+ */
+uint64_t hashCacheKey(uint64_t hash, const void *data, size_t length)
+{
+    const unsigned char *bytes = (const unsigned char *)data;
+
+    for (size_t i = 0; i < length; i++)
+    {
+        hash ^= bytes[i];
+        hash *= 0x100000001b3ULL;
+    }
+
+    return hash;
+}
+
+/**
+ * Очищает ошибку
+ */
+void cleanError(IMatError *error)
+{
+    error->isErr = 0;
+    sprintf(error->stringErr, "");
+}
+
+/**
+ * Задает ошибке переданную строку
+ *
+ * @param error ошибка, которую нужно установить
+ * @param format форматированная строка с описанием ошибки
+ * @param ... список аргументов для форматированной строки
+ */
+void setError(IMatError *error, const char *format, ...)
+{
+    va_list args;
+
+    // Имя переменной и путь приходят от вызывающего и могут быть длиннее stringErr - сообщение обрезается
+    va_start(args, format);
+    vsnprintf(error->stringErr, sizeof(error->stringErr), format, args);
+    va_end(args);
+
+    error->isErr = 1;
+}
+
+int setMatInflateBackend(enum EInflateBackend backend)
+{
+    switch (backend)
+    {
+#ifdef I_MAT_USE_ZLIB_NG
+    case IB_ZLIB_NG:
+#else
+    case IB_ZLIB:
+#endif
+#ifdef I_MAT_USE_LIBDEFLATE
+    case IB_LIBDEFLATE:
+#endif
+        inflateBackend = backend;
+        return 1;
+    default:
+        return 0;
+    }
+}
+
+enum EInflateBackend getMatInflateBackend(void)
+{
+    return inflateBackend;
+}
+
+void setMatIndexSidecar(int isEnabled)
+{
+    isIndexSidecarEnabled = isEnabled;
+}
+
+IMatReader *createMatReader(const IMatAllocator *allocator)
+{
+    IMatAllocator defaultAllocator = {allocateDefault, releaseDefault, NULL};
+
+    if (allocator == NULL)
+        allocator = &defaultAllocator;
+
+    IMatReader *reader = (IMatReader *)allocator->allocate(allocator->opaque, sizeof(IMatReader));
+    if (reader == NULL)
+        return NULL;
+
+    memset(reader, 0, sizeof(IMatReader));
+    reader->allocator = *allocator;
+
+    return reader;
+}
+
+void freeMatReader(IMatReader *reader)
+{
+    if (reader == NULL)
+        return;
+
+    if (threadReader == reader)
+        threadReader = NULL;
+
+    if (reader->isStreamReady)
+        inflateEnd(&reader->strm);
+
+#ifdef I_MAT_USE_LIBDEFLATE
+    if (reader->decompressor != NULL)
+        libdeflate_free_decompressor(reader->decompressor);
+#endif
+
+    for (int slot = 0; slot < SCRATCH_SLOTS_NUMBER; slot++)
+        if (reader->scratch[slot] != NULL)
+            reader->allocator.release(reader->allocator.opaque, reader->scratch[slot]);
+
+    reader->allocator.release(reader->allocator.opaque, reader);
+}
+
+void setMatReader(IMatReader *reader)
+{
+    threadReader = reader;
+}
+
+void setMatStatsCallback(IMatStatsCallback callback, void *opaque)
+{
+    statsOpaque = opaque;
+    statsCallback = callback;
+}
+
+/**
+ * Начало замера чтения: статистика привязывается к потоку до finishMatStats
+ */
+void beginMatStats(MatStatsState *state, char *filePath, char *name)
+{
+    memset(state, 0, sizeof(MatStatsState));
+
+    state->callback = statsCallback;
+    state->opaque = statsOpaque;
+    state->stats.filePath = filePath;
+    state->stats.name = name;
+    state->start = getNanoseconds();
+
+    threadStats = state;
+}
+
+/**
+ * Окончание замера после convertElementTo*: подсчет decodeNs как остатка общего времени и вызов обработчика
+ *
+ * result - возвращаемая gsl структура (NULL для чисел), state без обработчика - чтение не замерялось
+ */
+void finishMatStats(MatStatsState *state, const void *result, IMatError *error)
+{
+    IMatStats *stats = &state->stats;
+
+    if (state->callback == NULL)
+        return;
+
+    if (result != NULL)
+        stats->allocationsNumber++;
+
+    stats->isErr = error->isErr;
+    stats->totalNs = getNanoseconds() - state->start;
+
+    uint64_t stagesNs = stats->readNs + stats->inflateNs + stats->transposeNs;
+    stats->decodeNs = stats->totalNs > stagesNs ? stats->totalNs - stagesNs : 0;
+
+    threadStats = NULL;
+
+    state->callback(stats, state->opaque);
+}
+
+/**
+ * Учет промежуточного буфера в статистике чтения: isAllocated - буфер выделен заново, а не взят из контекста
+ */
+void trackScratch(void *data, size_t size, int isAllocated)
+{
+    MatStatsState *state = threadStats;
+
+    state->stats.allocationsNumber += isAllocated;
+
+    for (int k = 0; k < STATS_SCRATCH_SLOTS; k++)
+    {
+        if (state->scratch[k] == NULL)
+        {
+            state->scratch[k] = data;
+            state->scratchSize[k] = size;
+            state->scratchBytes += size;
+
+            if (state->scratchBytes > state->stats.peakScratchBytes)
+                state->stats.peakScratchBytes = state->scratchBytes;
+            return;
+        }
+    }
+}
+
+void untrackScratch(void *data)
+{
+    MatStatsState *state = threadStats;
+
+    for (int k = 0; k < STATS_SCRATCH_SLOTS; k++)
+    {
+        if (state->scratch[k] == data)
+        {
+            state->scratchBytes -= state->scratchSize[k];
+            state->scratch[k] = NULL;
+            return;
+        }
+    }
+}
+
+/**
+ * Монотонное время в наносекундах
+ */
+uint64_t getNanoseconds(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+/**
+ * Буфер для промежуточных данных чтения
+ *
+ * Если к потоку привязан контекст чтения, возвращается его буфер slot (увеличенный при необходимости),
+ * иначе - новый блок malloc. В обоих случаях буфер возвращается через releaseScratch
+ */
+void *allocateScratch(enum EScratchSlot slot, size_t size)
+{
+    IMatReader *reader = threadReader;
+
+    if (reader == NULL)
+    {
+        void *data = malloc(size);
+        if (threadStats != NULL && data != NULL)
+            trackScratch(data, size, 1);
+
+        return data;
+    }
+
+    int isAllocated = reader->scratch[slot] == NULL || size > reader->scratchSize[slot];
+
+    if (isAllocated)
+    {
+        if (reader->scratch[slot] != NULL)
+            reader->allocator.release(reader->allocator.opaque, reader->scratch[slot]);
+
+        // Старое содержимое не нужно, поэтому буфер выделяется заново без копирования
+        reader->scratch[slot] = reader->allocator.allocate(reader->allocator.opaque, size ? size : 1);
+        reader->scratchSize[slot] = reader->scratch[slot] != NULL ? size : 0;
+    }
+
+    if (threadStats != NULL && reader->scratch[slot] != NULL)
+        trackScratch(reader->scratch[slot], size, isAllocated);
+
+    return reader->scratch[slot];
+}
+
+/**
+ * Возврат буфера allocateScratch: буфер контекста остается в контексте, остальные освобождаются
+ */
+void releaseScratch(void *data)
+{
+    IMatReader *reader = threadReader;
+
+    if (threadStats != NULL && data != NULL)
+        untrackScratch(data);
+
+    if (reader != NULL && data != NULL)
+        for (int slot = 0; slot < SCRATCH_SLOTS_NUMBER; slot++)
+            if (reader->scratch[slot] == data)
+                return;
+
+    free(data);
+}
+
+/**
+ * Поток inflate для разжатия zlib данных: z_stream контекста чтения после inflateReset или
+ * localStream после inflateInit. Возвращается через releaseInflateStream
+ *
+ * Возвращаемый параметр: готовый поток или NULL при ошибке инициализации
+ */
+z_stream *acquireInflateStream(z_stream *localStream)
+{
+    IMatReader *reader = threadReader;
+    z_stream *strm = localStream;
+
+    if (reader != NULL && !reader->isStreamBusy)
+    {
+        strm = &reader->strm;
+
+        if (reader->isStreamReady)
+        {
+            if (inflateReset(strm) != Z_OK)
+                return NULL;
+
+            reader->isStreamBusy = 1;
+            return strm;
+        }
+
+        // Внутреннее состояние zlib выделяется функциями контекста
+        strm->zalloc = allocateInflateState;
+        strm->zfree = releaseInflateState;
+        strm->opaque = reader;
+    }
+    else if (threadStats != NULL)
+    {
+        // Выделения zlib учитываются в статистике чтения
+        strm->zalloc = allocateCountedState;
+        strm->zfree = releaseCountedState;
+        strm->opaque = Z_NULL;
+    }
+    else
+    {
+        strm->zalloc = Z_NULL;
+        strm->zfree = Z_NULL;
+        strm->opaque = Z_NULL;
+    }
+
+    strm->avail_in = 0;
+    strm->next_in = Z_NULL;
+
+    if (inflateInit(strm) != Z_OK)
+        return NULL;
+
+    if (strm != localStream)
+    {
+        reader->isStreamReady = 1;
+        reader->isStreamBusy = 1;
+    }
+
+    return strm;
+}
+
+void releaseInflateStream(z_stream *strm)
+{
+    IMatReader *reader = threadReader;
+
+    if (reader != NULL && strm == &reader->strm)
+        reader->isStreamBusy = 0;
+    else
+        inflateEnd(strm);
+}
+
+void *allocateInflateState(void *opaque, unsigned int items, unsigned int size)
+{
+    IMatReader *reader = (IMatReader *)opaque;
+
+    STATS_COUNT(allocationsNumber, 1);
+    return reader->allocator.allocate(reader->allocator.opaque, (size_t)items * size);
+}
+
+void releaseInflateState(void *opaque, void *address)
+{
+    IMatReader *reader = (IMatReader *)opaque;
+    reader->allocator.release(reader->allocator.opaque, address);
+}
+
+void *allocateCountedState(void *opaque, unsigned int items, unsigned int size)
+{
+    (void)opaque;
+
+    STATS_COUNT(allocationsNumber, 1);
+    return malloc((size_t)items * size);
+}
+
+void releaseCountedState(void *opaque, void *address)
+{
+    (void)opaque;
+    free(address);
+}
+
+void *allocateDefault(void *opaque, size_t size)
+{
+    (void)opaque;
+    return malloc(size);
+}
+
+void releaseDefault(void *opaque, void *data)
+{
+    (void)opaque;
+    free(data);
+}
+
+void setMatCacheDir(const char *dirPath, size_t maxBytes)
+{
+    free(matCacheDir);
+    matCacheDir = NULL;
+
+    if (dirPath != NULL)
+    {
+        matCacheDir = (char *)malloc(strlen(dirPath) + 1);
+        strcpy(matCacheDir, dirPath);
+    }
+
+    matCacheMaxBytes = maxBytes;
+}
+
+// Чтение одной переменной запроса: из файла по имени или единственной переменной файла
+#define READ_BATCH_ITEM(resultType, suffix)                                                                                       \
+    *(resultType *)item->destination = matFile != NULL ? readMatFile##suffix(matFile, item->name, &item->error)                 \
+                                                       : openMat##suffix(item->filePath, &item->error)
+
+/**
+ * Выполнение одного запроса openMatBatch (задача пула потоков)
+ */
+void readBatchItem(void *context, int index)
+{
+    IMatBatchItem *item = &((IMatBatchItem *)context)[index];
+    IMatFile *matFile = NULL;
+
+    if (item->name != NULL)
+    {
+        matFile = openMatFile(item->filePath, &item->error);
+        if (item->error.isErr)
+            return;
+    }
+
+    readBatchItemFrom(matFile, item);
+
+    if (matFile != NULL)
+        closeMatFile(matFile);
+}
+
+/**
+ * Выполнение одного запроса readMatFileBatch: переменная читается из общего открытого файла
+ */
+void readFileBatchItem(void *context, int index)
+{
+    IMatFile *matFile = (IMatFile *)((void **)context)[0];
+    IMatBatchItem *item = &((IMatBatchItem *)((void **)context)[1])[index];
+
+    if (item->name == NULL)
+    {
+        setError(&item->error, "Variable name is not set");
+        return;
+    }
+
+    readBatchItemFrom(matFile, item);
+}
+
+/**
+ * Чтение переменной запроса в destination: из открытого файла по имени
+ * или (если matFile == NULL) единственной переменной файла item->filePath
+ */
+void readBatchItemFrom(IMatFile *matFile, IMatBatchItem *item)
+{
+    if (item->destination == NULL)
+    {
+        setError(&item->error, "Destination for %s is not set", item->name != NULL ? item->name : item->filePath);
+        return;
+    }
+
+    switch (item->type)
+    {
+    case DT_INT:
+        READ_BATCH_ITEM(int, Int);
+        break;
+    case DT_INT_64:
+        READ_BATCH_ITEM(int64_t, Int64);
+        break;
+    case DT_DOUBLE:
+        READ_BATCH_ITEM(double, Double);
+        break;
+    case DT_COMPLEX:
+        READ_BATCH_ITEM(complex double, Complex);
+        break;
+    case DT_VECTOR:
+        READ_BATCH_ITEM(gsl_vector *, Vector);
+        break;
+    case DT_VECTOR_INT:
+        READ_BATCH_ITEM(gsl_vector_int *, VectorInt);
+        break;
+    case DT_VECTOR_COMPLEX:
+        READ_BATCH_ITEM(gsl_vector_complex *, VectorComplex);
+        break;
+    case DT_MATRIX:
+        READ_BATCH_ITEM(gsl_matrix *, Matrix);
+        break;
+    case DT_MATRIX_INT:
+        READ_BATCH_ITEM(gsl_matrix_int *, MatrixInt);
+        break;
+    case DT_MATRIX_COMPLEX:
+        READ_BATCH_ITEM(gsl_matrix_complex *, MatrixComplex);
+        break;
+    case DT_SPARSE:
+        READ_BATCH_ITEM(gsl_spmatrix *, SpMatrix);
+        break;
+    case DT_SPARSE_COMPLEX:
+        READ_BATCH_ITEM(gsl_spmatrix_complex *, SpMatrixComplex);
+        break;
+    case DT_VECTOR_FLOAT:
+        READ_BATCH_ITEM(gsl_vector_float *, VectorFloat);
+        break;
+    case DT_VECTOR_COMPLEX_FLOAT:
+        READ_BATCH_ITEM(gsl_vector_complex_float *, VectorComplexFloat);
+        break;
+    case DT_MATRIX_FLOAT:
+        READ_BATCH_ITEM(gsl_matrix_float *, MatrixFloat);
+        break;
+    case DT_MATRIX_COMPLEX_FLOAT:
+        READ_BATCH_ITEM(gsl_matrix_complex_float *, MatrixComplexFloat);
+        break;
+    case DT_ARRAY:
+        READ_BATCH_ITEM(IMatArray *, Array);
+        break;
+    default:
+        setError(&item->error, "Unsupported type of batch request: %s", getDataTypeName(item->type));
+        break;
+    }
+}
+
+/**
+ * Фоновый поток openMatAsync: дочитывает элемент переменной в память и декодирует ее из него
+ */
+void *loadMatAsync(void *arg)
+{
+    IMatAsync *request = (IMatAsync *)arg;
+    int isLoaded;
+
+#ifdef I_MAT_USE_URING
+    isLoaded = request->isRingReady ? finishAsyncReads(request) : readAsyncContents(request);
+#else
+    isLoaded = readAsyncContents(request);
+#endif
+
+    // v7.3 файлы, переменные, которые не нашлись по тегам, и обрезанные файлы читаются обычным путем (там же формируется ошибка)
+    if (isLoaded && request->contentsSize >= 128 && readFromByteUInt16(&(request->contents[124])) != MAT_VERSION_73)
+        decodeAsyncContents(request);
+    else
+    {
+        free(request->contents);
+        request->contents = NULL;
+        readBatchItem(request->item, 0);
+    }
+
+    if (request->callback != NULL)
+        request->callback(request->item, request->opaque);
+
+    atomic_store(&request->isFinished, 1);
+
+    return NULL;
+}
+
+/**
+ * Чтение заголовка файла и элемента запрашиваемой переменной в память через pread (без io_uring)
+ *
+ * Возвращаемый параметр: 1 - элемент прочитан в request->contents
+ */
+int readAsyncContents(IMatAsync *request)
+{
+    FILE *file = fopen(request->item->filePath, "rb");
+    if (file == NULL)
+        return 0;
+
+    int isRead = prepareAsyncContents(request, fileno(file));
+
+    for (size_t done = 128; isRead && done < request->contentsSize;)
+    {
+        ssize_t count = pread(fileno(file), &(request->contents[done]), request->contentsSize - done, request->elementOffset + (off_t)(done - 128));
+
+        isRead = count > 0;
+        done += isRead ? (size_t)count : 0;
+    }
+
+    fclose(file);
+
+    return isRead;
+}
+
+/**
+ * Поиск элемента запроса и выделение request->contents под заголовок файла и этот элемент
+ *
+ * Заголовок сразу копируется в начало contents, элемент дочитывает вызывающая функция с request->elementOffset
+ *
+ * Возвращаемый параметр: 1 - элемент найден и память выделена
+ */
+int prepareAsyncContents(IMatAsync *request, int fd)
+{
+    unsigned char header[128];
+    size_t elementLength;
+
+    if (!locateAsyncElement(fd, request->item->name, header, &request->elementOffset, &elementLength))
+        return 0;
+
+    request->contents = (unsigned char *)malloc(128 + elementLength);
+    if (request->contents == NULL)
+        return 0;
+
+    memcpy(request->contents, header, 128);
+    request->contentsSize = 128 + elementLength;
+
+    return 1;
+}
+
+/**
+ * Поиск элемента переменной в v5 файле по тегам верхнего уровня
+ *
+ * Читаются только заголовок файла, теги и начала элементов (для имени, как в handleVarInfo) - данные других
+ * переменных не читаются. name NULL - первая переменная файла, как в openMat*
+ *
+ * Выходные параметры: header - первые 128 байт файла, elementOffset и elementLength - положение элемента вместе с тегом
+ *
+ * Возвращаемый параметр: 1 - элемент найден, 0 - нет (в том числе для v7.3 файла)
+ */
+int locateAsyncElement(int fd, const char *name, unsigned char *header, off_t *elementOffset, size_t *elementLength)
+{
+    if (pread(fd, header, 128, 0) != 128 || readFromByteUInt16(&header[124]) == MAT_VERSION_73)
+        return 0;
+
+    unsigned char data[8 + 2 * VAR_HEADER_PREFIX_SIZE];
+    off_t offset = 128;
+    ssize_t length;
+
+    while ((length = pread(fd, data, sizeof(data), offset)) >= 8)
+    {
+        int elementType = readFromByteInt32(data);
+        size_t elementSize = readFromByteUInt32(&data[4]);
+        size_t available = (size_t)length - 8;
+        int isFound = name == NULL;
+
+        if (!isFound)
+        {
+            IMatVarInfo varInfo;
+            IMatError error;
+
+            cleanError(&error);
+            handleVarData(elementType, elementSize, &data[8], elementSize < available ? elementSize : available, &varInfo, &error);
+            isFound = !error.isErr && strcmp(varInfo.name, name) == 0;
+        }
+
+        if (isFound)
+        {
+            *elementOffset = offset;
+            *elementLength = 8 + elementSize;
+            return 1;
+        }
+
+        offset += 8 + (off_t)elementSize;
+    }
+
+    return 0;
+}
+
+/**
+ * Декодирование переменной запроса из прочитанных в память заголовка и элемента v5 файла
+ */
+void decodeAsyncContents(IMatAsync *request)
+{
+    IMatBatchItem *item = request->item;
+
+    // contents переходит во владение IMatFile
+    IMatFile *matFile = openMatContents(item->filePath, request->contents, request->contentsSize, &item->error);
+    request->contents = NULL;
+    if (item->error.isErr)
+        return;
+
+    if (item->name != NULL)
+        readBatchItemFrom(matFile, item);
+    else if (matFile->varsNumber == 0)
+        setError(&item->error, "Unexpected end of file");
+    else
+    {
+        // Единственная (первая) переменная файла, как в openMat*
+        IMatBatchItem firstItem = *item;
+        firstItem.name = matFile->vars[0].name;
+
+        readBatchItemFrom(matFile, &firstItem);
+        item->error = firstItem.error;
+    }
+
+    closeMatFile(matFile);
+}
+
+#ifdef I_MAT_USE_URING
+/**
+ * Открытие файла запроса, поиск элемента переменной и постановка первых чтений элемента в очередь io_uring
+ * (вызывается в openMatAsync)
+ *
+ * Возвращаемый параметр: 1 - чтения поставлены, 0 - io_uring недоступен или элемент не найден (файл прочитает
+ * фоновый поток)
+ */
+int startAsyncReads(IMatAsync *request)
+{
+    request->fd = open(request->item->filePath, O_RDONLY);
+    if (request->fd < 0)
+        return 0;
+
+    // Заголовок уже в contents, в очередь ставится только элемент
+    request->submittedSize = 128;
+
+    if (prepareAsyncContents(request, request->fd) && io_uring_queue_init(ASYNC_QUEUE_DEPTH, &request->ring, 0) == 0)
+    {
+        request->isRingReady = 1;
+        if (submitAsyncReads(request))
+            return 1;
+
+        io_uring_queue_exit(&request->ring);
+        request->isRingReady = 0;
+    }
+
+    free(request->contents);
+    request->contents = NULL;
+    request->contentsSize = 0;
+    close(request->fd);
+    request->fd = -1;
+
+    return 0;
+}
+
+/**
+ * Постановка в очередь чтений следующих порций элемента, пока в очереди есть место
+ *
+ * Возвращаемый параметр: 1 - успешно
+ */
+int submitAsyncReads(IMatAsync *request)
+{
+    while (request->pendingReads < ASYNC_QUEUE_DEPTH && request->submittedSize < request->contentsSize)
+    {
+        struct io_uring_sqe *sqe = io_uring_get_sqe(&request->ring);
+        if (sqe == NULL)
+            break;
+
+        size_t left = request->contentsSize - request->submittedSize;
+        unsigned length = left < ASYNC_READ_SIZE ? (unsigned)left : ASYNC_READ_SIZE;
+
+        // По адресу порции в user_data восстанавливается ее смещение
+        io_uring_prep_read(sqe, request->fd, &(request->contents[request->submittedSize]), length,
+                           request->elementOffset + (off_t)(request->submittedSize - 128));
+        io_uring_sqe_set_data(sqe, &(request->contents[request->submittedSize]));
+
+        request->submittedSize += length;
+        request->pendingReads++;
+    }
+
+    return io_uring_submit(&request->ring) >= 0;
+}
+
+/**
+ * Ожидание чтений io_uring в фоновом потоке: завершенные порции заменяются следующими, короткие чтения
+ * дочитываются через pread. Кольцо и файл закрываются
+ *
+ * Возвращаемый параметр: 1 - элемент прочитан в request->contents
+ */
+int finishAsyncReads(IMatAsync *request)
+{
+    int isRead = 1;
+
+    while (request->pendingReads > 0)
+    {
+        struct io_uring_cqe *cqe;
+
+        int status = io_uring_wait_cqe(&request->ring, &cqe);
+        if (status == -EINTR)
+            continue;
+        if (status < 0)
+        {
+            isRead = 0;
+            break;
+        }
+
+        unsigned char *data = (unsigned char *)io_uring_cqe_get_data(cqe);
+        long result = cqe->res;
+        io_uring_cqe_seen(&request->ring, cqe);
+        request->pendingReads--;
+
+        size_t offset = (size_t)(data - request->contents);
+        size_t left = request->contentsSize - offset;
+        size_t length = left < ASYNC_READ_SIZE ? left : ASYNC_READ_SIZE;
+
+        while (result >= 0 && (size_t)result < length)
+        {
+            off_t fileOffset = request->elementOffset + (off_t)(offset - 128 + (size_t)result);
+            ssize_t readLength = pread(request->fd, data + result, length - (size_t)result, fileOffset);
+            result = readLength > 0 ? result + readLength : -1;
+        }
+
+        if (result < 0)
+            isRead = 0;
+
+        // После ошибки новые чтения не ставятся, только дожидаемся уже поставленных
+        if (isRead && !submitAsyncReads(request))
+            isRead = 0;
+    }
+
+    io_uring_queue_exit(&request->ring);
+    request->isRingReady = 0;
+    close(request->fd);
+    request->fd = -1;
+
+    return isRead;
+}
+#endif
+
+/**
+ * Выполнение задач 0..tasksNumber-1 на threadsNumber потоках (вызывающий поток тоже работает)
+ *
+ * Входные параметры:
+ *  task: ParallelTask  - задача, получает context и номер задачи
+ *  context: void*      - общие данные задач
+ *  tasksNumber: int    - количество задач
+ *  threadsNumber: int  - количество потоков, 0 и меньше - по числу процессоров
+ */
+void runParallel(ParallelTask task, void *context, int tasksNumber, int threadsNumber)
+{
+    ParallelJob job;
+
+    job.task = task;
+    job.context = context;
+    job.tasksNumber = tasksNumber;
+    atomic_init(&job.nextTask, 0);
+    atomic_init(&job.nextWorker, 0);
+
+    if (threadsNumber <= 0)
+        threadsNumber = getProcessorsNumber();
+    if (threadsNumber > tasksNumber)
+        threadsNumber = tasksNumber;
+
+#ifndef I_MAT_NO_THREADS
+    pthread_t *threads = threadsNumber > 1 ? (pthread_t *)malloc(sizeof(pthread_t) * (threadsNumber - 1)) : NULL;
+    int startedNumber = 0;
+
+    // Если поток не создался, его задачи разберут остальные
+    while (threads != NULL && startedNumber < threadsNumber - 1 &&
+           pthread_create(&threads[startedNumber], NULL, parallelWorker, &job) == 0)
+        startedNumber++;
+
+    parallelWorker(&job);
+
+    for (int i = 0; i < startedNumber; i++)
+        pthread_join(threads[i], NULL);
+
+    free(threads);
+#else
+    parallelWorker(&job);
+#endif
+}
+
+/**
+ * Поток пула: выполняет задачи, пока они не закончатся
+ */
+void *parallelWorker(void *arg)
+{
+    ParallelJob *job = (ParallelJob *)arg;
+    // Вызывающий поток сам может быть потоком внешнего пула
+    int outerIndex = parallelWorkerIndex;
+
+    parallelWorkerIndex = atomic_fetch_add(&job->nextWorker, 1);
+
+    for (;;)
+    {
+        int index = atomic_fetch_add(&job->nextTask, 1);
+        if (index >= job->tasksNumber)
+            break;
+
+        job->task(job->context, index);
+    }
+
+    parallelWorkerIndex = outerIndex;
+    return NULL;
+}
+
+/**
+ * Количество доступных процессоров
+ */
+int getProcessorsNumber(void)
+{
+#if !defined(I_MAT_NO_THREADS) && defined(_SC_NPROCESSORS_ONLN)
+    long processorsNumber = sysconf(_SC_NPROCESSORS_ONLN);
+
+    return processorsNumber > 0 ? (int)processorsNumber : 1;
+#else
+    return 1;
+#endif
+}
+
+/**
+ * Проверяем header mat-файла
+ */
+int handleMatHeader(FILE *file, IMatError *error)
+{
+    unsigned char header[128];
+
+    if (fread(header, 128, 1, file) != 1)
+    {
+        setError(error, "Unexpected end of file");
+        return 0;
+    }
+
+    return checkMatHeader(header, error);
+}
+
+/**
+ * Проверка 128-байтового заголовка mat файла
+ *
+ * Возвращаемый параметр: версия (MAT_VERSION_5 или MAT_VERSION_73)
+ */
+int checkMatHeader(const unsigned char *header, IMatError *error)
+{
+    char description[117];
+    strncpy(description, (char *)header, 116);
+    description[116] = '\0';
+
+    if (header[126] != 'I')
+    {
+        setError(error, "Unexpected Byte Order");
+        return 0;
+    }
+
+    return readFromByteUInt16((unsigned char *)&(header[124]));
+}
+
+/**
+ * Обработка заголовочного тега элемента
+ */
+void handleElement(FILE *file, IMatError *error, ElmementInfo *eInfo)
+{
+    initElementInfo(eInfo);
+
+    // Читаем тег элемента верхнего уровня
+    unsigned char tagField[8];
+    if (fread(tagField, 8, 1, file) != 1)
+    {
+        setError(error, "Unexpected end of file");
+        return;
+    }
+
+    int elementType = readFromByteInt32(tagField);
+    size_t elementSize = readFromByteUInt32(&(tagField[4]));
+
+    if (elementType != MI_COMPRESSED && elementType != MI_MATRIX)
+    {
+        setError(error, "Unexpected element type: %d", elementType);
+        return;
+    }
+
+    handleElementData(file, elementType, elementSize, error, eInfo);
+}
+
+/**
+ * Чтение данных элемента верхнего уровня, тег которого только что прочитан из file
+ *
+ * Элемент вместе с тегом отображается в память (или читается в буфер через fread), сжатый элемент
+ * разжимается прямо из отображения, несжатый miMATRIX декодируется из него без копирования
+ */
+void handleElementData(FILE *file, int elementType, size_t elementSize, IMatError *error, ElmementInfo *eInfo)
+{
+    size_t length = 8 + elementSize;
+    uint64_t readStart = STATS_START();
+
+#ifdef I_MAT_USE_MMAP
+    long offset = ftell(file) - 8;
+
+    // Обращение к отображению за концом файла - SIGBUS, поэтому обрезанный файл отсекается до mmap
+    if (!isFileRangeAvailable(fileno(file), offset, length))
+    {
+        setError(error, "Unexpected end of file");
+        return;
+    }
+
+    long pageSize = sysconf(_SC_PAGESIZE);
+    long mapStart = offset - offset % pageSize;
+    size_t mapLength = (size_t)(offset - mapStart) + length;
+
+    void *mapData = mmap(NULL, mapLength, PROT_READ, MAP_PRIVATE, fileno(file), mapStart);
+    if (mapData != MAP_FAILED)
+    {
+        madvise(mapData, mapLength, MADV_SEQUENTIAL);
+        STATS_ADD(readNs, readStart);
+
+        decodeElement(error, eInfo, (unsigned char *)mapData + (offset - mapStart), elementSize);
+
+        munmap(mapData, mapLength);
+        fseek(file, offset + (long)length, SEEK_SET);
+        return;
+    }
+#endif
+
+    unsigned char *element = (unsigned char *)allocateScratch(SCRATCH_ELEMENT, length);
+    uint32_t tagSize = (uint32_t)elementSize;
+
+    // Тег уже прочитан, восстанавливаем его в начале буфера
+    memcpy(element, &elementType, 4);
+    memcpy(&element[4], &tagSize, 4);
+
+    if (elementSize > 0 && fread(&element[8], elementSize, 1, file) != 1)
+    {
+        setError(error, "Unexpected end of file");
+        releaseScratch(element);
+        return;
+    }
+
+    STATS_ADD(readNs, readStart);
+
+    decodeElement(error, eInfo, element, elementSize);
+    releaseScratch(element);
+}
+
+/**
+ * Декодирование элемента верхнего уровня (element указывает на его тег) по его типу
+ */
+void decodeElement(IMatError *error, ElmementInfo *eInfo, const unsigned char *element, size_t elementSize)
+{
+    int elementType = readFromByteInt32((unsigned char *)element);
+
+    STATS_COUNT(compressedBytes, 8 + elementSize);
+    if (elementType == MI_MATRIX)
+        STATS_COUNT(uncompressedBytes, 8 + elementSize);
+
+    if (elementType == MI_COMPRESSED)
+        decodeCompressedElement(error, eInfo, &(element[8]), elementSize);
+    else if (elementType == MI_MATRIX)
+        decodeMatrixElement(error, eInfo, element, 8 + elementSize);
+    else
+        setError(error, "Unexpected element type: %d", elementType);
+}
+
+/**
+ * Декодирование несжатого miMATRIX элемента прямо из отображенного в память файла (или буфера чтения)
+ *
+ * Данные не копируются: handleMatrixElement читает их на месте, указатель не освобождается
+ */
+void decodeMatrixElement(IMatError *error, ElmementInfo *eInfo, const unsigned char *element, size_t elementLength)
+{
+    eInfo->zipData = (unsigned char *)element;
+    eInfo->zipSize = elementLength;
+
+    handleMatrixElement(error, eInfo);
+
+    eInfo->zipData = NULL;
+}
+
+/**
+ * Чтение элемента открытого mat файла по его записи в индексе
+ *
+ * Не использует текущее положение в файле (элемент отображается в память по смещению, а при чтении
+ * через fread положение защищено мьютексом), поэтому несколько элементов одного файла можно
+ * разжимать в разных потоках одновременно
+ */
+void handleElementAt(IMatFile *matFile, const IMatVarInfo *varInfo, IMatError *error, ElmementInfo *eInfo)
+{
+    initElementInfo(eInfo);
+
+    ElementMapping mapping;
+    uint64_t readStart = STATS_START();
+
+    const unsigned char *element = acquireElementData(matFile, varInfo, 1, &mapping, error);
+    if (element == NULL)
+        return;
+
+    STATS_ADD(readNs, readStart);
+
+    decodeElement(error, eInfo, element, varInfo->elementSize);
+
+    releaseElementData(&mapping);
+}
+
+/**
+ * Доступ к элементу открытого mat файла (вместе с тегом) без изменения положения в файле
+ *
+ * Элемент отображается в память, а если это невозможно - читается в буфер под мьютексом файла.
+ * isSequential - подсказка ядру, будет ли элемент прочитан подряд или по частям
+ *
+ * Возвращаемый параметр: начало элемента (NULL при ошибке), освобождается releaseElementData
+ */
+const unsigned char *acquireElementData(IMatFile *matFile, const IMatVarInfo *varInfo, int isSequential, ElementMapping *mapping, IMatError *error)
+{
+    long offset = varInfo->offset;
+    size_t length = 8 + varInfo->elementSize;
+
+    mapping->isMapped = 0;
+
+    // Файл уже прочитан в память (openMatAsync)
+    if (matFile->contents != NULL)
+    {
+        mapping->data = NULL;
+
+        if (offset < 0 || (size_t)offset > matFile->contentsSize || length > matFile->contentsSize - offset)
+        {
+            setError(error, "Unexpected end of file");
+            return NULL;
+        }
+
+        return &(matFile->contents[offset]);
+    }
+
+#ifdef I_MAT_USE_MMAP
+    // Как и в handleElementData: элемент обрезанного файла не отображается
+    if (!isFileRangeAvailable(fileno(matFile->file), offset, length))
+    {
+        setError(error, "Unexpected end of file");
+        return NULL;
+    }
+
+    long pageSize = sysconf(_SC_PAGESIZE);
+    long mapStart = offset - offset % pageSize;
+
+    mapping->length = (size_t)(offset - mapStart) + length;
+    mapping->data = mmap(NULL, mapping->length, PROT_READ, MAP_PRIVATE, fileno(matFile->file), mapStart);
+    if (mapping->data != MAP_FAILED)
+    {
+        madvise(mapping->data, mapping->length, isSequential ? MADV_SEQUENTIAL : MADV_NORMAL);
+        mapping->isMapped = 1;
+
+        return (unsigned char *)mapping->data + (offset - mapStart);
+    }
+#else
+    (void)isSequential;
+#endif
+
+    mapping->data = malloc(length);
+    mapping->length = length;
+
+    int isRead;
+
+#ifndef I_MAT_NO_THREADS
+    pthread_mutex_lock(&matFile->lock);
+#endif
+    isRead = mapping->data != NULL && fseek(matFile->file, offset, SEEK_SET) == 0 && fread(mapping->data, length, 1, matFile->file) == 1;
+#ifndef I_MAT_NO_THREADS
+    pthread_mutex_unlock(&matFile->lock);
+#endif
+
+    if (!isRead)
+    {
+        setError(error, "Unexpected end of file");
+        free(mapping->data);
+        mapping->data = NULL;
+        return NULL;
+    }
+
+    return (unsigned char *)mapping->data;
+}
+
+void releaseElementData(ElementMapping *mapping)
+{
+#ifdef I_MAT_USE_MMAP
+    if (mapping->isMapped)
+    {
+        munmap(mapping->data, mapping->length);
+        return;
+    }
+#endif
+
+    free(mapping->data);
+}
+
+#ifdef I_MAT_USE_MMAP
+/**
+ * Проверка, что байты offset..offset+length есть в файле fd (размер берется через fstat)
+ */
+int isFileRangeAvailable(int fd, long offset, size_t length)
+{
+    struct stat fileStat;
+
+    if (offset < 0 || fstat(fd, &fileStat) != 0 || (uint64_t)offset > (uint64_t)fileStat.st_size)
+        return 0;
+
+    return length <= (uint64_t)fileStat.st_size - (uint64_t)offset;
+}
+#endif
+
+/**
+ * Сброс указателей на данные элемента перед чтением
+ */
+void initElementInfo(ElmementInfo *eInfo)
+{
+    eInfo->dataInt = NULL;
+    eInfo->dataInt32 = NULL;
+    eInfo->dataDouble = NULL;
+    eInfo->dataFloat = NULL;
+    eInfo->zipData = NULL;
+    eInfo->result = NULL;
+    eInfo->name[0] = '\0';
+}
+
+#ifdef I_MAT_USE_HDF5
+/**
+ * Блокировка вызовов HDF5: библиотека собирается без поддержки потоков, поэтому все обращения
+ * к ней идут под одним мьютексом, а разжатие чанков выполняется уже без него
+ */
+void lockH5(void)
+{
+#ifndef I_MAT_NO_THREADS
+    pthread_mutex_lock(&h5Lock);
+#endif
+}
+
+void unlockH5(void)
+{
+#ifndef I_MAT_NO_THREADS
+    pthread_mutex_unlock(&h5Lock);
+#endif
+}
+
+/**
+ * Чтение единственной (первой) переменной v7.3 файла для openMat* функций
+ */
+void openMatH5Engine(char *filePath, ElmementInfo *eInfo, IMatError *error)
+{
+    char name[64] = "";
+    hid_t file;
+
+    lockH5();
+    H5E_BEGIN_TRY
+    {
+        file = H5Fopen(filePath, H5F_ACC_RDONLY, H5P_DEFAULT);
+
+        H5G_info_t groupInfo;
+        if (file >= 0 && H5Gget_info(file, &groupInfo) >= 0)
+            for (hsize_t i = 0; i < groupInfo.nlinks && name[0] == '\0'; i++)
+                getMatH5VarName(file, i, name);
+    }
+    H5E_END_TRY;
+    unlockH5();
+
+    if (file < 0)
+    {
+        setError(error, "Unable to open HDF5 file: %s", filePath);
+        return;
+    }
+
+    if (name[0] == '\0')
+        setError(error, "No variables in file: %s", filePath);
+    else
+        readMatH5Region(file, name, 0, -1, 0, -1, eInfo, error);
+
+    lockH5();
+    H5Fclose(file);
+    unlockH5();
+}
+
+/**
+ * Открытие v7.3 файла и построение индекса переменных по ссылкам корневой группы
+ *
+ * Служебные группы MATLAB (#refs#, #subsystem#) пропускаются. Переменные, которые не являются
+ * двумерными числовыми датасетами (struct, cell, sparse, многомерные массивы), попадают в индекс с типом DT_UNKNOWN
+ */
+void openMatH5File(IMatFile *matFile, char *filePath, IMatError *error)
+{
+    lockH5();
+    H5E_BEGIN_TRY
+    {
+        matFile->h5File = H5Fopen(filePath, H5F_ACC_RDONLY, H5P_DEFAULT);
+
+        H5G_info_t groupInfo;
+        if (matFile->h5File >= 0 && H5Gget_info(matFile->h5File, &groupInfo) >= 0)
+        {
+            matFile->vars = (IMatVarInfo *)malloc(sizeof(IMatVarInfo) * (groupInfo.nlinks ? groupInfo.nlinks : 1));
+
+            for (hsize_t i = 0; i < groupInfo.nlinks; i++)
+            {
+                IMatVarInfo *varInfo = &(matFile->vars[matFile->varsNumber]);
+
+                if (getMatH5VarName(matFile->h5File, i, varInfo->name))
+                {
+                    handleH5VarInfo(matFile->h5File, varInfo);
+                    matFile->varsNumber++;
+                }
+            }
+        }
+    }
+    H5E_END_TRY;
+    unlockH5();
+
+    if (matFile->h5File < 0)
+        setError(error, "Unable to open HDF5 file: %s", filePath);
+}
+
+void closeMatH5File(IMatFile *matFile)
+{
+    lockH5();
+    H5Fclose(matFile->h5File);
+    unlockH5();
+
+    matFile->h5File = H5I_INVALID_HID;
+}
+
+/**
+ * Имя ссылки корневой группы с номером linkIndex (в порядке имен)
+ *
+ * Возвращаемый параметр: 1, если ссылка - переменная MATLAB (не служебная группа и имя помещается в name[64])
+ */
+int getMatH5VarName(hid_t file, hsize_t linkIndex, char *name)
+{
+    ssize_t nameLength = H5Lget_name_by_idx(file, ".", H5_INDEX_NAME, H5_ITER_INC, linkIndex, NULL, 0, H5P_DEFAULT);
+    if (nameLength <= 0 || nameLength >= 64)
+        return 0;
+
+    H5Lget_name_by_idx(file, ".", H5_INDEX_NAME, H5_ITER_INC, linkIndex, name, 64, H5P_DEFAULT);
+
+    if (name[0] == '#')
+    {
+        name[0] = '\0';
+        return 0;
+    }
+
+    return 1;
+}
+
+/**
+ * Заполнение записи индекса для переменной v7.3 файла без чтения данных
+ *
+ * Из описания датасета собирается заголовок miMATRIX элемента, который разбирается так же, как в v5 файле
+ */
+void handleH5VarInfo(hid_t file, IMatVarInfo *varInfo)
+{
+    // Для v7.3 файлов положение элемента в файле не используется
+    varInfo->offset = -1;
+    varInfo->elementSize = 0;
+    varInfo->type = DT_UNKNOWN;
+    varInfo->matClass = 0;
+    varInfo->sizeI = 0;
+    varInfo->sizeJ = 0;
+    varInfo->dimsNumber = 0;
+
+    hid_t object = H5Oopen(file, varInfo->name, H5P_DEFAULT);
+    if (object < 0)
+        return;
+
+    H5DatasetInfo info;
+    IMatError error;
+    cleanError(&error);
+
+    if (H5Iget_type(object) == H5I_DATASET)
+        describeH5Dataset(object, &info, &error);
+    else
+        readH5ClassAttribute(object, &info);
+
+    varInfo->matClass = info.matClass;
+
+    if (H5Iget_type(object) == H5I_DATASET && !error.isErr)
+    {
+        unsigned char header[128];
+        int headerLength = buildMatrixElementHeader(header, varInfo->name, info.matClass, getH5ArrayFlags(&info), info.sizeI, info.sizeJ,
+                                                    info.dataTypeCode, 0, 0);
+        int isComplex;
+
+        handleMatrixHeader(header, headerLength, varInfo, &isComplex, &error);
+    }
+
+    H5Oclose(object);
+}
+
+/**
+ * Чтение атрибутов MATLAB_class (класс массива) и MATLAB_empty объекта v7.3 файла
+ */
+void readH5ClassAttribute(hid_t object, H5DatasetInfo *info)
+{
+    static const char *classNames[] = {"", "cell", "struct", "object", "char", "sparse", "double", "single",
+                                       "int8", "uint8", "int16", "uint16", "int32", "uint32", "int64", "uint64"};
+
+    info->matClass = 0;
+    info->isLogical = 0;
+    info->isEmpty = 0;
+
+    if (H5Aexists(object, "MATLAB_class") > 0)
+    {
+        char className[32] = "";
+        hid_t attr = H5Aopen(object, "MATLAB_class", H5P_DEFAULT);
+        hid_t attrType = H5Aget_type(attr);
+        hid_t memType = H5Tcopy(H5T_C_S1);
+
+        if (H5Tis_variable_str(attrType) > 0)
+        {
+            char *value = NULL;
+
+            H5Tset_size(memType, H5T_VARIABLE);
+            if (H5Aread(attr, memType, &value) >= 0 && value != NULL)
+            {
+                strncpy(className, value, sizeof(className) - 1);
+                H5free_memory(value);
+            }
+        }
+        else if (H5Tget_size(attrType) < sizeof(className))
+        {
+            H5Tset_size(memType, H5Tget_size(attrType));
+            H5Aread(attr, memType, className);
+        }
+
+        H5Tclose(memType);
+        H5Tclose(attrType);
+        H5Aclose(attr);
+
+        for (int i = 1; i < (int)(sizeof(classNames) / sizeof(classNames[0])); i++)
+            if (strcmp(className, classNames[i]) == 0)
+                info->matClass = i;
+
+        // logical хранится как uint8 с флагом logical
+        if (strcmp(className, "logical") == 0)
+        {
+            info->matClass = 9;
+            info->isLogical = 1;
+        }
+    }
+
+    if (H5Aexists(object, "MATLAB_empty") > 0)
+    {
+        unsigned int isEmpty = 0;
+        hid_t attr = H5Aopen(object, "MATLAB_empty", H5P_DEFAULT);
+
+        H5Aread(attr, H5T_NATIVE_UINT, &isEmpty);
+        H5Aclose(attr);
+
+        info->isEmpty = isEmpty != 0;
+    }
+}
+
+/**
+ * Описание датасета v7.3 файла в терминах miMATRIX элемента
+ *
+ * Размеры датасета записаны в обратном порядке: матрица AxB хранится как HDF5 массив [B][A],
+ * то есть в том же порядке столбцов, что и данные v5 элемента. Комплексные данные - составной тип
+ * из полей real и imag. Пустой массив хранит свои размеры как данные (атрибут MATLAB_empty)
+ */
+void describeH5Dataset(hid_t dataset, H5DatasetInfo *info, IMatError *error)
+{
+    readH5ClassAttribute(dataset, info);
+
+    info->isComplex = 0;
+    info->dataTypeCode = 0;
+    info->typeSize = 0;
+    info->sizeI = 0;
+    info->sizeJ = 0;
+
+    hid_t space = H5Dget_space(dataset);
+    int rank = H5Sget_simple_extent_ndims(space);
+    hsize_t dims[H5S_MAX_RANK];
+    H5Sget_simple_extent_dims(space, dims, NULL);
+    H5Sclose(space);
+
+    if (info->isEmpty)
+    {
+        uint64_t emptyDims[2] = {0, 0};
+
+        if (rank == 1 && dims[0] == 2)
+            H5Dread(dataset, H5T_NATIVE_UINT64, H5S_ALL, H5S_ALL, H5P_DEFAULT, emptyDims);
+
+        info->sizeI = (int)emptyDims[0];
+        info->sizeJ = (int)emptyDims[1];
+        info->dataTypeCode = 9;
+        info->typeSize = 8;
+        return;
+    }
+
+    if (rank != 2)
+    {
+        setError(error, "Multidimensional data");
+        return;
+    }
+
+    // Общий размер ограничивает allocateMatrixElement: данные собираются в miMATRIX элемент с 32-битными длинами
+    if (dims[0] > 2147483647 || dims[1] > 2147483647)
+    {
+        setError(error, "Dataset is too large: %llux%llu", (unsigned long long)dims[1], (unsigned long long)dims[0]);
+        return;
+    }
+
+    info->sizeI = (int)dims[1];
+    info->sizeJ = (int)dims[0];
+
+    hid_t type = H5Dget_type(dataset);
+    hid_t valueType = type;
+
+    if (H5Tget_class(type) == H5T_COMPOUND && H5Tget_nmembers(type) == 2)
+    {
+        info->isComplex = 1;
+        valueType = H5Tget_member_type(type, 0);
+    }
+
+    info->dataTypeCode = selectH5DataCode(valueType);
+    info->typeSize = (int)H5Tget_size(valueType);
+
+    if (valueType != type)
+        H5Tclose(valueType);
+    H5Tclose(type);
+
+    if (info->dataTypeCode == 0)
+        setError(error, "Unsupported data type of dataset");
+
+    if (info->matClass == 0)
+        info->matClass = 6;
+}
+
+/**
+ * Код типа данных matlab для числового типа HDF5 (0, если тип не поддерживается)
+ */
+int selectH5DataCode(hid_t type)
+{
+    size_t size = H5Tget_size(type);
+
+    if (H5Tget_class(type) == H5T_FLOAT)
+        return size == 8 ? 9 : (size == 4 ? 7 : 0);
+
+    if (H5Tget_class(type) != H5T_INTEGER)
+        return 0;
+
+    int isUnsigned = H5Tget_sign(type) == H5T_SGN_NONE;
+
+    switch (size)
+    {
+    case 1:
+        return isUnsigned ? 2 : 1;
+    case 2:
+        return isUnsigned ? 4 : 3;
+    case 4:
+        return isUnsigned ? 6 : 5;
+    case 8:
+        return isUnsigned ? 13 : 12;
+    default:
+        return 0;
+    }
+}
+
+/**
+ * Тип HDF5 в памяти для кода типа данных matlab
+ */
+hid_t selectH5NativeType(int dataTypeCode)
+{
+    switch (dataTypeCode)
+    {
+    case 1:
+        return H5T_NATIVE_INT8;
+    case 2:
+        return H5T_NATIVE_UINT8;
+    case 3:
+        return H5T_NATIVE_INT16;
+    case 4:
+        return H5T_NATIVE_UINT16;
+    case 5:
+        return H5T_NATIVE_INT32;
+    case 6:
+        return H5T_NATIVE_UINT32;
+    case 7:
+        return H5T_NATIVE_FLOAT;
+    case 12:
+        return H5T_NATIVE_INT64;
+    case 13:
+        return H5T_NATIVE_UINT64;
+    default:
+        return H5T_NATIVE_DOUBLE;
+    }
+}
+
+/**
+ * Чтение переменной v7.3 файла по имени
+ */
+void readMatH5Variable(hid_t file, char *name, ElmementInfo *eInfo, IMatError *error)
+{
+    initElementInfo(eInfo);
+
+    readMatH5Region(file, name, 0, -1, 0, -1, eInfo, error);
+}
+
+/**
+ * Чтение прямоугольной области (гиперслэба) переменной v7.3 файла
+ *
+ * Данные датасета собираются в miMATRIX элемент в памяти, который затем декодируется handleMatrixElement,
+ * поэтому все типы результатов, преобразования типов и транспонирование работают так же, как для v5 файлов.
+ * Сжатые deflate чанки читаются под h5Lock без разжатия и разжимаются параллельно в пуле потоков,
+ * остальные датасеты читаются через H5Dread
+ *
+ * Входные данные:
+ *  file: hid_t              - открытый v7.3 файл
+ *  name: const char*        - имя переменной
+ *  row0, rows: int          - первая строка и количество строк (rows < 0 - все строки)
+ *  col0, cols: int          - первый столбец и количество столбцов (cols < 0 - все столбцы)
+ */
+void readMatH5Region(hid_t file, const char *name, int row0, int rows, int col0, int cols, ElmementInfo *eInfo, IMatError *error)
+{
+    H5ChunkJob job;
+    unsigned char *element = NULL;
+    size_t elementLength = 0;
+
+    memset(&job, 0, sizeof(job));
+
+    lockH5();
+    H5E_BEGIN_TRY
+    {
+        hid_t dataset = H5Dopen2(file, name, H5P_DEFAULT);
+
+        if (dataset < 0)
+            setError(error, "Variable %s not found or is not a numeric array", name);
+        else
+        {
+            element = readH5Dataset(dataset, name, row0, rows, col0, cols, &job, &elementLength, error);
+            H5Dclose(dataset);
+        }
+    }
+    H5E_END_TRY;
+    unlockH5();
+
+    if (job.chunksNumber > 0)
+    {
+        int threadsNumber = getProcessorsNumber();
+
+        atomic_init(&job.failed, 0);
+#ifdef I_MAT_USE_LIBDEFLATE
+        job.decompressors = (struct libdeflate_decompressor **)calloc(threadsNumber, sizeof(struct libdeflate_decompressor *));
+#endif
+        runParallel(decodeH5Chunk, &job, job.chunksNumber, threadsNumber);
+
+        if (atomic_load(&job.failed))
+            setError(error, "Failed to uncompress dataset chunk of %s", name);
+
+#ifdef I_MAT_USE_LIBDEFLATE
+        for (int i = 0; job.decompressors != NULL && i < threadsNumber; i++)
+            if (job.decompressors[i] != NULL)
+                libdeflate_free_decompressor(job.decompressors[i]);
+        free(job.decompressors);
+#endif
+
+        for (int i = 0; i < job.chunksNumber; i++)
+            free(job.chunks[i]);
+        free(job.chunks);
+        free(job.chunkSizes);
+        free(job.filterMasks);
+        free(job.offsets);
+    }
+
+    if (!error->isErr)
+        decodeMatrixElement(error, eInfo, element, elementLength);
+
+    free(element);
+}
+
+/**
+ * Сборка miMATRIX элемента из области датасета (вызывается под h5Lock)
+ *
+ * Если датасет подходит для параллельного разжатия, в элемент записывается только заголовок, а сырые чанки
+ * сохраняются в job для decodeH5Chunk
+ *
+ * Возвращаемый параметр: элемент (NULL при ошибке) и его длина с тегом в elementLength
+ */
+unsigned char *readH5Dataset(hid_t dataset, const char *name, int row0, int rows, int col0, int cols, H5ChunkJob *job, size_t *elementLength,
+                             IMatError *error)
+{
+    H5DatasetInfo info;
+
+    describeH5Dataset(dataset, &info, error);
+    if (error->isErr)
+        return NULL;
+
+    if (rows < 0)
+        rows = info.isEmpty ? info.sizeI : info.sizeI - row0;
+    if (cols < 0)
+        cols = info.isEmpty ? info.sizeJ : info.sizeJ - col0;
+
+    if (row0 < 0 || col0 < 0 || rows < 0 || cols < 0 || (!info.isEmpty && (row0 + rows > info.sizeI || col0 + cols > info.sizeJ)))
+    {
+        setError(error, "Sub-matrix is out of range");
+        return NULL;
+    }
+
+    unsigned char *realData, *imagData;
+    int sizeI = info.isEmpty ? info.sizeI : rows;
+    int sizeJ = info.isEmpty ? info.sizeJ : cols;
+
+    unsigned char *element = allocateMatrixElement(name, info.matClass, getH5ArrayFlags(&info), sizeI, sizeJ, info.dataTypeCode, info.typeSize,
+                                                   &realData, &imagData, elementLength, error);
+    if (element == NULL || (size_t)sizeI * sizeJ == 0)
+        return element;
+
+    job->row0 = row0;
+    job->rows = rows;
+    job->col0 = col0;
+    job->cols = cols;
+    job->typeSize = info.typeSize;
+    job->isComplex = info.isComplex;
+    job->realData = realData;
+    job->imagData = imagData;
+
+    if (collectH5Chunks(dataset, job))
+        return element;
+
+    if (readH5Hyperslab(dataset, &info, row0, rows, col0, cols, realData, imagData) < 0)
+    {
+        setError(error, "Failed to read dataset %s", name);
+        free(element);
+        return NULL;
+    }
+
+    return element;
+}
+
+/**
+ * Флаги массива miMATRIX элемента (complex, logical) для датасета
+ */
+int getH5ArrayFlags(H5DatasetInfo *info)
+{
+    return (info->isComplex ? ARRAY_FLAG_COMPLEX : 0) | (info->isLogical ? ARRAY_FLAG_LOGICAL : 0);
+}
+
+/**
+ * Чтение сырых (сжатых) чанков, пересекающих область job, для параллельного разжатия
+ *
+ * Подходят двумерные датасеты с чанками, сжатые только deflate (или без фильтров), с данными в little-endian,
+ * все чанки которых записаны в файл. Комплексные поля real/imag должны идти подряд
+ *
+ * Возвращаемый параметр: 1, если чанки прочитаны в job, 0 - датасет нужно читать через H5Dread
+ */
+int collectH5Chunks(hid_t dataset, H5ChunkJob *job)
+{
+    hid_t plist = H5Dget_create_plist(dataset);
+    int isSuitable = H5Pget_layout(plist) == H5D_CHUNKED && H5Pget_chunk(plist, 2, job->chunkDims) == 2;
+
+    int filtersNumber = isSuitable ? H5Pget_nfilters(plist) : 0;
+    for (int i = 0; i < filtersNumber; i++)
+    {
+        unsigned int flags;
+        size_t valuesNumber = 0;
+
+        if (H5Pget_filter2(plist, i, &flags, &valuesNumber, NULL, 0, NULL, NULL) != H5Z_FILTER_DEFLATE || filtersNumber > 1)
+            isSuitable = 0;
+    }
+    job->isDeflated = filtersNumber == 1;
+    H5Pclose(plist);
+
+    hid_t type = H5Dget_type(dataset);
+    if (job->isComplex)
+    {
+        hid_t realType = H5Tget_member_type(type, 0);
+        hid_t imagType = H5Tget_member_type(type, 1);
+
+        isSuitable = isSuitable && H5Tget_order(realType) == H5T_ORDER_LE && H5Tequal(realType, imagType) > 0 &&
+                     H5Tget_member_offset(type, 0) == 0 && H5Tget_member_offset(type, 1) == (size_t)job->typeSize &&
+                     H5Tget_size(type) == (size_t)job->typeSize * 2;
+
+        H5Tclose(realType);
+        H5Tclose(imagType);
+    }
+    else
+        isSuitable = isSuitable && (job->typeSize == 1 || H5Tget_order(type) == H5T_ORDER_LE);
+    H5Tclose(type);
+
+    if (!isSuitable)
+        return 0;
+
+    // Номера чанков, пересекающих область (по столбцам HDF5 массива [столбец][строка])
+    hsize_t firstJ = job->col0 / job->chunkDims[0], lastJ = (job->col0 + job->cols - 1) / job->chunkDims[0];
+    hsize_t firstI = job->row0 / job->chunkDims[1], lastI = (job->row0 + job->rows - 1) / job->chunkDims[1];
+    int chunksNumber = (int)((lastJ - firstJ + 1) * (lastI - firstI + 1));
+
+    job->chunks = (unsigned char **)calloc(chunksNumber, sizeof(unsigned char *));
+    job->chunkSizes = (hsize_t *)malloc(sizeof(hsize_t) * chunksNumber);
+    job->filterMasks = (unsigned int *)malloc(sizeof(unsigned int) * chunksNumber);
+    job->offsets = (hsize_t *)malloc(sizeof(hsize_t) * 2 * chunksNumber);
+
+    int readNumber = 0;
+
+    for (hsize_t j = firstJ; j <= lastJ && readNumber >= 0; j++)
+    {
+        for (hsize_t i = firstI; i <= lastI && readNumber >= 0; i++)
+        {
+            hsize_t *offset = &(job->offsets[2 * readNumber]);
+            haddr_t address;
+
+            offset[0] = j * job->chunkDims[0];
+            offset[1] = i * job->chunkDims[1];
+
+            // Незаписанный чанк заполнен значением по умолчанию - его разворачивает только H5Dread
+            if (H5Dget_chunk_info_by_coord(dataset, offset, &(job->filterMasks[readNumber]), &address, &(job->chunkSizes[readNumber])) < 0 ||
+                address == HADDR_UNDEF)
+            {
+                readNumber = -1;
+                break;
+            }
+
+            uint32_t filterMask;
+            job->chunks[readNumber] = (unsigned char *)malloc(job->chunkSizes[readNumber]);
+
+            if (job->chunks[readNumber] == NULL || H5Dread_chunk(dataset, H5P_DEFAULT, offset, &filterMask, job->chunks[readNumber]) < 0)
+            {
+                free(job->chunks[readNumber]);
+                readNumber = -1;
+                break;
+            }
+
+            readNumber++;
+        }
+    }
+
+    if (readNumber < 0)
+    {
+        for (int k = 0; k < chunksNumber; k++)
+            free(job->chunks[k]);
+        free(job->chunks);
+        free(job->chunkSizes);
+        free(job->filterMasks);
+        free(job->offsets);
+
+        job->chunks = NULL;
+        return 0;
+    }
+
+    job->chunksNumber = chunksNumber;
+    return 1;
+}
+
+/**
+ * Разжатие одного чанка и раскладка его пересечения с областью в данные элемента (задача пула потоков)
+ *
+ * Краевые чанки хранятся полного размера, лишние строки и столбцы пропускаются. Поля real/imag
+ * комплексных значений разносятся по действительной и мнимой частям элемента
+ */
+void decodeH5Chunk(void *context, int index)
+{
+    H5ChunkJob *job = (H5ChunkJob *)context;
+    size_t valueSize = (size_t)job->typeSize * (job->isComplex ? 2 : 1);
+    size_t chunkBytes = job->chunkDims[0] * job->chunkDims[1] * valueSize;
+    unsigned char *chunk = job->chunks[index];
+
+    // Бит 0 маски фильтров означает, что deflate для этого чанка не применялся
+    if (job->isDeflated && !(job->filterMasks[index] & 1))
+    {
+        chunk = (unsigned char *)malloc(chunkBytes);
+
+        if (chunk == NULL || inflateH5Chunk(job, job->chunks[index], job->chunkSizes[index], chunk, chunkBytes) != Z_OK)
+        {
+            atomic_store(&job->failed, 1);
+            free(chunk);
+            return;
+        }
+    }
+    else if (job->chunkSizes[index] != chunkBytes)
+    {
+        atomic_store(&job->failed, 1);
+        return;
+    }
+
+    hsize_t *offset = &(job->offsets[2 * index]);
+    hsize_t jStart = offset[0] > (hsize_t)job->col0 ? offset[0] : (hsize_t)job->col0;
+    hsize_t jEnd = offset[0] + job->chunkDims[0] < (hsize_t)(job->col0 + job->cols) ? offset[0] + job->chunkDims[0] : (hsize_t)(job->col0 + job->cols);
+    hsize_t iStart = offset[1] > (hsize_t)job->row0 ? offset[1] : (hsize_t)job->row0;
+    hsize_t iEnd = offset[1] + job->chunkDims[1] < (hsize_t)(job->row0 + job->rows) ? offset[1] + job->chunkDims[1] : (hsize_t)(job->row0 + job->rows);
+    size_t count = iEnd - iStart;
+
+    for (hsize_t j = jStart; j < jEnd; j++)
+    {
+        const unsigned char *source = &chunk[((j - offset[0]) * job->chunkDims[1] + (iStart - offset[1])) * valueSize];
+        size_t position = ((j - job->col0) * (size_t)job->rows + (iStart - job->row0)) * job->typeSize;
+
+        if (!job->isComplex)
+        {
+            memcpy(&(job->realData[position]), source, count * valueSize);
+            continue;
+        }
+
+        for (size_t k = 0; k < count; k++)
+        {
+            memcpy(&(job->realData[position + k * job->typeSize]), &source[k * valueSize], job->typeSize);
+            memcpy(&(job->imagData[position + k * job->typeSize]), &source[k * valueSize + job->typeSize], job->typeSize);
+        }
+    }
+
+    if (chunk != job->chunks[index])
+        free(chunk);
+}
+
+/**
+ * Разжатие чанка, сжатого фильтром deflate (zlib поток), ровно в chunkBytes байт выбранным бэкендом
+ *
+ * libdeflate использует декомпрессор текущего потока пула из job, он переиспользуется для всех чанков потока
+ */
+int inflateH5Chunk(H5ChunkJob *job, const unsigned char *compressedData, size_t compressedSize, unsigned char *chunk, size_t chunkBytes)
+{
+#ifdef I_MAT_USE_LIBDEFLATE
+    if (inflateBackend == IB_LIBDEFLATE && job->decompressors != NULL)
+    {
+        struct libdeflate_decompressor **decompressor = &(job->decompressors[parallelWorkerIndex]);
+
+        if (*decompressor == NULL)
+            *decompressor = libdeflate_alloc_decompressor();
+        if (*decompressor == NULL)
+            return Z_MEM_ERROR;
+
+        enum libdeflate_result ret = libdeflate_zlib_decompress(*decompressor, compressedData, compressedSize, chunk, chunkBytes, NULL);
+
+        return ret == LIBDEFLATE_SUCCESS ? Z_OK : Z_DATA_ERROR;
+    }
+#else
+    (void)job;
+#endif
+
+    z_stream strm;
+
+    strm.zalloc = Z_NULL;
+    strm.zfree = Z_NULL;
+    strm.opaque = Z_NULL;
+    strm.avail_in = 0;
+    strm.next_in = Z_NULL;
+
+    int ret = inflateInit(&strm);
+    if (ret != Z_OK)
+        return ret;
+
+    strm.avail_in = compressedSize;
+    strm.next_in = (unsigned char *)compressedData;
+
+    ret = inflateExactly(&strm, chunk, chunkBytes);
+    inflateEnd(&strm);
+
+    return ret;
+}
+
+/**
+ * Чтение области датасета через H5Dread (датасеты без чанков, с другими фильтрами или незаписанными чанками)
+ *
+ * Действительная и мнимая части читаются отдельно через составные типы из одного поля
+ */
+int readH5Hyperslab(hid_t dataset, H5DatasetInfo *info, int row0, int rows, int col0, int cols, unsigned char *realData, unsigned char *imagData)
+{
+    hsize_t start[2] = {(hsize_t)col0, (hsize_t)row0};
+    hsize_t count[2] = {(hsize_t)cols, (hsize_t)rows};
+
+    hid_t fileSpace = H5Dget_space(dataset);
+    hid_t memorySpace = H5Screate_simple(2, count, NULL);
+    herr_t status = H5Sselect_hyperslab(fileSpace, H5S_SELECT_SET, start, NULL, count, NULL);
+    hid_t nativeType = selectH5NativeType(info->dataTypeCode);
+
+    if (status >= 0 && !info->isComplex)
+        status = H5Dread(dataset, nativeType, memorySpace, fileSpace, H5P_DEFAULT, realData);
+
+    if (status >= 0 && info->isComplex)
+    {
+        hid_t type = H5Dget_type(dataset);
+
+        for (int part = 0; part < 2 && status >= 0; part++)
+        {
+            char *memberName = H5Tget_member_name(type, part);
+            hid_t partType = H5Tcreate(H5T_COMPOUND, info->typeSize);
+
+            H5Tinsert(partType, memberName, 0, nativeType);
+            status = H5Dread(dataset, partType, memorySpace, fileSpace, H5P_DEFAULT, part ? imagData : realData);
+
+            H5Tclose(partType);
+            H5free_memory(memberName);
+        }
+
+        H5Tclose(type);
+    }
+
+    H5Sclose(memorySpace);
+    H5Sclose(fileSpace);
+
+    return status < 0 ? -1 : 0;
+}
+#endif
+
+/**
+ * Чтение прямоугольной области матрицы из элемента v5 файла
+ */
+gsl_matrix *readElementSubMatrix(IMatFile *matFile, int varIndex, int row0, int rows, int col0, int cols, IMatError *error)
+{
+    const IMatVarInfo *varInfo = &(matFile->vars[varIndex]);
+
+    if ((long)row0 + rows > varInfo->sizeI || (long)col0 + cols > varInfo->sizeJ)
+    {
+        setError(error, "Sub-matrix is out of range");
+        return NULL;
+    }
+
+    int dataTypeCode;
+    unsigned char *block = readElementColumns(matFile, varIndex, DT_MATRIX, row0, rows, col0, cols, &dataTypeCode, error);
+    if (block == NULL)
+        return NULL;
+
+    gsl_matrix *result = gsl_matrix_alloc(rows, cols);
+
+    if (dataTypeCode == 9)
+        transposeDouble(result->data, result->tda, (const double *)block, rows, cols);
+    else
+    {
+        double *values = (double *)malloc(sizeof(double) * rows * cols);
+
+        handleSequence(values, DECODE_DOUBLE, block, dataTypeCode, (size_t)rows * cols);
+        transposeDouble(result->data, result->tda, values, rows, cols);
+        free(values);
+    }
+
+    free(block);
+    return result;
+}
+
+/**
+ * Чтение диапазона страниц N-мерного массива из элемента v5 файла
+ *
+ * Страница - срез dims[0] x dims[1] по остальным размерностям, в данных matlab страницы идут подряд,
+ * поэтому диапазон страниц - это диапазон столбцов массива, свернутого в sizeI x sizeJ
+ */
+IMatArray *readElementPages(IMatFile *matFile, int varIndex, int page0, int pages, IMatError *error)
+{
+    const IMatVarInfo *varInfo = &(matFile->vars[varIndex]);
+    int pageColumns = varInfo->dimsNumber > 1 ? varInfo->dims[1] : 0;
+    int pagesNumber = pageColumns ? varInfo->sizeJ / pageColumns : 0;
+
+    if ((long)page0 + pages > pagesNumber)
+    {
+        setError(error, "Pages are out of range");
+        return NULL;
+    }
+
+    int dataTypeCode;
+    unsigned char *block = readElementColumns(matFile, varIndex, DT_ARRAY, 0, varInfo->sizeI, page0 * pageColumns, pages * pageColumns, &dataTypeCode, error);
+    if (block == NULL)
+        return NULL;
+
+    int dims[3] = {varInfo->sizeI, pageColumns, pages};
+    IMatArray *result = allocateMatArray(3, dims);
+
+    if (dataTypeCode == 9)
+        transposeArrayPages(result, (const double *)block);
+    else
+    {
+        size_t size = (size_t)varInfo->sizeI * pageColumns * pages;
+        double *values = (double *)malloc(sizeof(double) * size);
+
+        handleSequence(values, DECODE_DOUBLE, block, dataTypeCode, size);
+        transposeArrayPages(result, values);
+        free(values);
+    }
+
+    free(block);
+    return result;
+}
+
+/**
+ * Чтение блока столбцов rows x cols из элемента v5 файла без декодирования
+ *
+ * Данные matlab лежат по столбцам, поэтому каждый столбец области - непрерывный отрезок разжатых данных.
+ * Несжатый элемент читается по смещениям напрямую, сжатый - с ближайших контрольных точек индекса
+ * (getCheckpointIndex), так что разжимаются только участки потока, которые покрывают нужные столбцы
+ *
+ * Возвращаемый параметр:
+ *  block: unsigned char* - столбцы области подряд в типе dataTypeCode (NULL при ошибке)
+ */
+unsigned char *readElementColumns(IMatFile *matFile, int varIndex, enum EDataTypes target, int row0, int rows, int col0, int cols, int *dataTypeCodeOut,
+                                  IMatError *error)
+{
+    const IMatVarInfo *varInfo = &(matFile->vars[varIndex]);
+
+    if (!isTypeCompatible(target, varInfo->type))
+    {
+        setError(error, "Got error while reading %s. Expected %s, but readed %s", varInfo->name, getDataTypeName(target),
+                 getDataTypeName(varInfo->type));
+        return NULL;
+    }
+
+    ElementMapping mapping;
+    const unsigned char *element = acquireElementData(matFile, varInfo, 0, &mapping, error);
+    if (element == NULL)
+        return NULL;
+
+    int isCompressed = readFromByteInt32((unsigned char *)element) == MI_COMPRESSED;
+    unsigned char header[VAR_HEADER_PREFIX_SIZE];
+    int headerLength;
+
+    // Заголовок miMATRIX: из начала разжатого потока или прямо из несжатого элемента
+    if (isCompressed)
+        headerLength = decompressPrefix(&element[8], varInfo->elementSize, header, VAR_HEADER_PREFIX_SIZE);
+    else
+    {
+        headerLength = 8 + varInfo->elementSize < VAR_HEADER_PREFIX_SIZE ? 8 + varInfo->elementSize : VAR_HEADER_PREFIX_SIZE;
+        memcpy(header, element, headerLength);
+    }
+
+    IMatVarInfo headerInfo;
+    int isComplex;
+    int dataStartIndex = headerLength < 0 ? -1 : handleMatrixHeader(header, headerLength, &headerInfo, &isComplex, error);
+
+    if (!error->isErr && (dataStartIndex < 0 || dataStartIndex + 8 > headerLength))
+        setError(error, "Unexpected end of element data");
+    if (error->isErr)
+    {
+        releaseElementData(&mapping);
+        return NULL;
+    }
+
+    // Данные могут быть записаны в сжатой форме тега (до 4 байт)
+    unsigned char *tagField = &header[dataStartIndex];
+    int isSmallData = tagField[2] || tagField[3];
+    int dataTypeCode = isSmallData ? readFromByteInt16(tagField) : readFromByteInt32(tagField);
+    size_t dataOffset = dataStartIndex + (isSmallData ? 4 : 8);
+
+    if (!isNumericDataCode(dataTypeCode))
+    {
+        setError(error, "Unexpected type when reading data sequence");
+        releaseElementData(&mapping);
+        return NULL;
+    }
+
+    int byteInElem = calculateByteSizeFromMatDataCode(dataTypeCode);
+    size_t dataLength = isSmallData ? (size_t)readFromByteInt16(&tagField[2]) : (size_t)(unsigned int)readFromByteInt32(&tagField[4]);
+
+    if (dataLength < (size_t)varInfo->sizeI * varInfo->sizeJ * byteInElem || (!isCompressed && dataOffset + dataLength > 8 + (size_t)varInfo->elementSize))
+    {
+        setError(error, "Unexpected length of data sequence");
+        releaseElementData(&mapping);
+        return NULL;
+    }
+
+    size_t columnLength = (size_t)rows * byteInElem;
+    unsigned char *block = (unsigned char *)malloc(columnLength * cols);
+
+    if (!isCompressed)
+    {
+        for (int j = 0; j < cols; j++)
+        {
+            size_t start = dataOffset + ((size_t)(col0 + j) * varInfo->sizeI + row0) * byteInElem;
+            memcpy(&block[j * columnLength], &element[start], columnLength);
+        }
+    }
+    else
+    {
+        CheckpointIndex *index = getCheckpointIndex(matFile, varIndex, &element[8], varInfo->elementSize, error);
+
+        if (index != NULL && inflateColumns(&element[8], varInfo->elementSize, index, dataOffset + ((size_t)col0 * varInfo->sizeI + row0) * byteInElem,
+                                            (size_t)varInfo->sizeI * byteInElem, columnLength, cols, block) != Z_OK)
+            setError(error, "Failed to uncompress element %s", varInfo->name);
+    }
+
+    releaseElementData(&mapping);
+
+    if (error->isErr)
+    {
+        free(block);
+        return NULL;
+    }
+
+    *dataTypeCodeOut = dataTypeCode;
+    return block;
+}
+
+/**
+ * Создание потока столбцов: разбор заголовка miMATRIX из начала элемента и выделение буферов блока
+ */
+IMatColumnStream *createColumnStream(IMatFile *matFile, const IMatVarInfo *varInfo, int blockColumns, IMatError *error)
+{
+    if (!isTypeCompatible(DT_ARRAY, varInfo->type))
+    {
+        setError(error, "Got error while reading %s. Expected %s, but readed %s", varInfo->name, getDataTypeName(DT_MATRIX),
+                 getDataTypeName(varInfo->type));
+        return NULL;
+    }
+
+    IMatColumnStream *stream = (IMatColumnStream *)calloc(1, sizeof(IMatColumnStream));
+    if (stream == NULL)
+    {
+        setError(error, "Not enough memory for variable %s", varInfo->name);
+        return NULL;
+    }
+
+    stream->matFile = matFile;
+    stream->inputOffset = varInfo->offset;
+    stream->inputLeft = 8;
+
+    // Тег элемента, дальше читается только сам элемент
+    unsigned char tag[8];
+    if (readColumnStreamInput(stream, tag, 8) != 8)
+    {
+        setError(error, "Unexpected end of file");
+        closeMatColumnStream(stream);
+        return NULL;
+    }
+
+    stream->isCompressed = readFromByteInt32(tag) == MI_COMPRESSED;
+    stream->inputLeft = varInfo->elementSize;
+
+    // Заголовок miMATRIX: начало разжатого потока или начало несжатого элемента вместе с тегом
+    if (stream->isCompressed)
+    {
+        size_t produced = 0;
+
+        stream->input = (unsigned char *)malloc(STREAM_CHUNK_SIZE);
+        stream->isStreamReady = stream->input != NULL && inflateInit(&stream->strm) == Z_OK;
+
+        int ret = stream->isStreamReady ? inflateColumnStream(stream, stream->header, VAR_HEADER_PREFIX_SIZE, &produced) : Z_MEM_ERROR;
+        if (ret != Z_OK && ret != Z_STREAM_END)
+        {
+            setError(error, "Failed to uncompress element, err: %d", ret);
+            closeMatColumnStream(stream);
+            return NULL;
+        }
+
+        stream->headerLength = (int)produced;
+    }
+    else
+    {
+        memcpy(stream->header, tag, 8);
+        stream->headerLength = 8 + (int)readColumnStreamInput(stream, &(stream->header[8]), VAR_HEADER_PREFIX_SIZE - 8);
+    }
+
+    IMatVarInfo headerInfo;
+    int isComplex;
+    int dataStartIndex = handleMatrixHeader(stream->header, stream->headerLength, &headerInfo, &isComplex, error);
+
+    if (!error->isErr && (dataStartIndex < 0 || dataStartIndex + 8 > stream->headerLength))
+        setError(error, "Unexpected end of element data");
+    if (!error->isErr && isComplex)
+        setError(error, "Column streams of complex matrices are not supported");
+    if (error->isErr)
+    {
+        closeMatColumnStream(stream);
+        return NULL;
+    }
+
+    // Данные могут быть записаны в сжатой форме тега (до 4 байт)
+    unsigned char *tagField = &(stream->header[dataStartIndex]);
+    int isSmallData = tagField[2] || tagField[3];
+    size_t dataLength = isSmallData ? (size_t)readFromByteInt16(&tagField[2]) : (size_t)readFromByteUInt32(&tagField[4]);
+
+    stream->dataTypeCode = isSmallData ? readFromByteInt16(tagField) : readFromByteInt32(tagField);
+    stream->headerStart = dataStartIndex + (isSmallData ? 4 : 8);
+
+    if (!isNumericDataCode(stream->dataTypeCode))
+    {
+        setError(error, "Unexpected type when reading data sequence");
+        closeMatColumnStream(stream);
+        return NULL;
+    }
+
+    stream->byteInElem = calculateByteSizeFromMatDataCode(stream->dataTypeCode);
+    stream->sizeI = headerInfo.sizeI;
+    stream->sizeJ = headerInfo.sizeI > 0 ? headerInfo.sizeJ : 0;
+
+    if (dataLength < (size_t)stream->sizeI * stream->sizeJ * stream->byteInElem)
+    {
+        setError(error, "Unexpected length of data sequence");
+        closeMatColumnStream(stream);
+        return NULL;
+    }
+
+    if (blockColumns <= 0)
+        blockColumns = STREAM_CHUNK_SIZE / (sizeof(double) * (stream->sizeI > 0 ? stream->sizeI : 1));
+    if (blockColumns > stream->sizeJ)
+        blockColumns = stream->sizeJ;
+    stream->blockColumns = blockColumns > 0 ? blockColumns : 1;
+
+    // miDOUBLE разжимается прямо в блок, остальные типы - в raw и декодируются в блок
+    size_t blockElems = (size_t)stream->sizeI * stream->blockColumns;
+
+    stream->block = (double *)malloc(sizeof(double) * (blockElems > 0 ? blockElems : 1));
+    if (stream->dataTypeCode != 9)
+        stream->raw = (unsigned char *)malloc(stream->byteInElem * (blockElems > 0 ? blockElems : 1));
+
+    if (stream->block == NULL || (stream->dataTypeCode != 9 && stream->raw == NULL))
+    {
+        setError(error, "Not enough memory for variable %s", varInfo->name);
+        closeMatColumnStream(stream);
+        return NULL;
+    }
+
+    return stream;
+}
+
+/**
+ * Чтение следующего блока столбцов потока
+ *
+ * Возвращаемый параметр: количество столбцов в блоке, 0 - ошибка (поток дальше не читается)
+ */
+int fillColumnBlock(IMatColumnStream *stream, IMatError *error)
+{
+    int blockStart = stream->blockStart + stream->blockLength;
+    int blockLength = stream->sizeJ - blockStart < stream->blockColumns ? stream->sizeJ - blockStart : stream->blockColumns;
+    size_t elemsNumber = (size_t)stream->sizeI * blockLength;
+    unsigned char *destination = stream->dataTypeCode == 9 ? (unsigned char *)stream->block : stream->raw;
+
+    if (pullColumnStream(stream, destination, elemsNumber * stream->byteInElem) != Z_OK)
+    {
+        setError(error, "Failed to uncompress columns %d..%d", blockStart, blockStart + blockLength - 1);
+        stream->column = stream->sizeJ;
+        return 0;
+    }
+
+    if (stream->dataTypeCode != 9)
+        handleSequence(stream->block, DECODE_DOUBLE, stream->raw, stream->dataTypeCode, elemsNumber);
+
+    stream->blockStart = blockStart;
+    stream->blockLength = blockLength;
+
+    return blockLength;
+}
+
+/**
+ * Следующие size байт данных элемента: сначала остаток, прочитанный вместе с заголовком, затем из файла
+ *
+ * Возвращаемый параметр: Z_OK, Z_DATA_ERROR если элемент закончился раньше, или код ошибки zlib
+ */
+int pullColumnStream(IMatColumnStream *stream, unsigned char *destination, size_t size)
+{
+    size_t headerLeft = (size_t)(stream->headerLength - stream->headerStart);
+    size_t fromHeader = size < headerLeft ? size : headerLeft;
+
+    memcpy(destination, &(stream->header[stream->headerStart]), fromHeader);
+    stream->headerStart += (int)fromHeader;
+
+    destination += fromHeader;
+    size -= fromHeader;
+
+    if (size == 0)
+        return Z_OK;
+
+    if (!stream->isCompressed)
+        return readColumnStreamInput(stream, destination, size) == size ? Z_OK : Z_DATA_ERROR;
+
+    size_t produced;
+    int ret = inflateColumnStream(stream, destination, size, &produced);
+
+    if (ret == Z_OK || ret == Z_STREAM_END)
+        return produced == size ? Z_OK : Z_DATA_ERROR;
+
+    return ret;
+}
+
+/**
+ * Разжатие до size байт потока, входные данные дочитываются из файла порциями по STREAM_CHUNK_SIZE
+ *
+ * Возвращаемый параметр: Z_OK, Z_STREAM_END (produced может быть меньше size) или код ошибки zlib
+ */
+int inflateColumnStream(IMatColumnStream *stream, unsigned char *destination, size_t size, size_t *produced)
+{
+    z_stream *strm = &stream->strm;
+    int ret = Z_OK;
+
+    *produced = 0;
+
+    while (*produced < size && ret == Z_OK)
+    {
+        if (strm->avail_in == 0)
+        {
+            strm->next_in = stream->input;
+            strm->avail_in = (uint32_t)readColumnStreamInput(stream, stream->input, STREAM_CHUNK_SIZE);
+
+            // Сжатые данные элемента закончились раньше zlib потока
+            if (strm->avail_in == 0)
+                return Z_DATA_ERROR;
+        }
+
+        // avail_out 32-битный, поэтому большой блок разжимается окнами
+        size_t window = size - *produced < (1u << 30) ? size - *produced : (1u << 30);
+
+        strm->next_out = destination + *produced;
+        strm->avail_out = (uint32_t)window;
+
+        ret = inflate(strm, Z_NO_FLUSH);
+        *produced += window - strm->avail_out;
+
+        // Нет продвижения из-за пустого входа: следующая итерация дочитает порцию
+        if (ret == Z_BUF_ERROR && strm->avail_in == 0)
+            ret = Z_OK;
+    }
+
+    return ret;
+}
+
+/**
+ * Чтение следующих (не больше size) байт элемента потока из файла или из прочитанного в память содержимого
+ *
+ * pread не меняет положение в файле, поэтому потоки и readMatFile* одного IMatFile не мешают друг другу
+ *
+ * Возвращаемый параметр: количество прочитанных байт
+ */
+size_t readColumnStreamInput(IMatColumnStream *stream, unsigned char *destination, size_t size)
+{
+    IMatFile *matFile = stream->matFile;
+    size_t length = size < stream->inputLeft ? size : stream->inputLeft;
+    size_t done = 0;
+
+    if (matFile->contents != NULL)
+    {
+        if (stream->inputOffset >= 0 && (size_t)stream->inputOffset <= matFile->contentsSize)
+        {
+            done = matFile->contentsSize - stream->inputOffset < length ? matFile->contentsSize - stream->inputOffset : length;
+            memcpy(destination, &(matFile->contents[stream->inputOffset]), done);
+        }
+    }
+    else
+    {
+        while (done < length)
+        {
+            ssize_t count = pread(fileno(matFile->file), destination + done, length - done, stream->inputOffset + (long)done);
+            if (count <= 0)
+                break;
+
+            done += (size_t)count;
+        }
+    }
+
+    stream->inputOffset += (long)done;
+    stream->inputLeft -= done;
+
+    return done;
+}
+
+/**
+ * Разжатие столбцов области с контрольных точек индекса
+ *
+ * Входные данные:
+ *  compressedData: const unsigned char* - zlib поток элемента
+ *  compressedSize: size_t               - его длина
+ *  index: CheckpointIndex*              - индекс контрольных точек потока
+ *  start: size_t                        - смещение первого столбца области в разжатом элементе
+ *  stride: size_t                       - расстояние между столбцами (длина столбца матрицы в байтах)
+ *  columnLength: size_t                 - длина столбца области в байтах
+ *  cols: int                            - количество столбцов
+ *  block: unsigned char*                - выходной буфер, столбцы записываются подряд
+ *
+ * Возвращаемый параметр: Z_OK или код ошибки zlib
+ */
+int inflateColumns(const unsigned char *compressedData, size_t compressedSize, CheckpointIndex *index, size_t start, size_t stride,
+                   size_t columnLength, int cols, unsigned char *block)
+{
+    z_stream strm;
+    int isActive = 0;
+    int ret = Z_OK;
+    uint64_t position = 0;
+    unsigned char *skipped = (unsigned char *)malloc(STREAM_CHUNK_SIZE);
+
+    for (int j = 0; j < cols && ret == Z_OK; j++)
+    {
+        uint64_t columnStart = start + j * stride;
+        const InflateCheckpoint *point = findCheckpoint(index, columnStart);
+
+        // Если между текущим положением и столбцом есть контрольная точка, быстрее начать с нее
+        if (!isActive || columnStart < position || point->out > position)
+        {
+            if (isActive)
+                inflateEnd(&strm);
+
+            ret = inflateFromCheckpoint(&strm, compressedData, compressedSize, point);
+            isActive = ret == Z_OK;
+            position = point->out;
+        }
+
+        while (ret == Z_OK && position < columnStart)
+        {
+            size_t length = columnStart - position < STREAM_CHUNK_SIZE ? columnStart - position : STREAM_CHUNK_SIZE;
+
+            ret = inflateExactly(&strm, skipped, length);
+            position += length;
+        }
+
+        if (ret == Z_OK)
+        {
+            ret = inflateExactly(&strm, &block[j * columnLength], columnLength);
+            position += columnLength;
+        }
+    }
+
+    if (isActive)
+        inflateEnd(&strm);
+    free(skipped);
+
+    return ret;
+}
+
+/**
+ * Последняя контрольная точка, которая не дальше offset разжатых данных
+ */
+const InflateCheckpoint *findCheckpoint(CheckpointIndex *index, uint64_t offset)
+{
+    int left = 0, right = index->pointsNumber - 1;
+
+    while (left < right)
+    {
+        int middle = (left + right + 1) / 2;
+
+        if (index->points[middle].out <= offset)
+            left = middle;
+        else
+            right = middle - 1;
+    }
+
+    return &(index->points[left]);
+}
+
+/**
+ * Начало raw inflate с контрольной точки: недочитанные биты байта и окно deflate восстанавливаются
+ */
+int inflateFromCheckpoint(z_stream *strm, const unsigned char *compressedData, size_t compressedSize, const InflateCheckpoint *point)
+{
+    strm->zalloc = Z_NULL;
+    strm->zfree = Z_NULL;
+    strm->opaque = Z_NULL;
+    strm->avail_in = 0;
+    strm->next_in = Z_NULL;
+
+    int ret = inflateInit2(strm, -15);
+    if (ret != Z_OK)
+        return ret;
+
+    strm->next_in = (unsigned char *)&compressedData[point->in];
+    strm->avail_in = compressedSize - point->in;
+
+    if (point->bits)
+        ret = inflatePrime(strm, point->bits, compressedData[point->in - 1] >> (8 - point->bits));
+    if (ret == Z_OK)
+        ret = inflateSetDictionary(strm, point->window, CHECKPOINT_WINDOW_SIZE);
+
+    if (ret != Z_OK)
+        inflateEnd(strm);
+
+    return ret;
+}
+
+/**
+ * Индекс контрольных точек сжатого элемента открытого файла
+ *
+ * Строится при первом обращении (или загружается из файла-спутника, см. setMatIndexSidecar)
+ * и хранится в IMatFile до closeMatFile
+ */
+CheckpointIndex *getCheckpointIndex(IMatFile *matFile, int varIndex, const unsigned char *compressedData, size_t compressedSize, IMatError *error)
+{
+    CheckpointIndex *index = NULL;
+
+#ifndef I_MAT_NO_THREADS
+    pthread_mutex_lock(&matFile->lock);
+#endif
+    if (matFile->indexes != NULL)
+        index = matFile->indexes[varIndex];
+#ifndef I_MAT_NO_THREADS
+    pthread_mutex_unlock(&matFile->lock);
+#endif
+
+    if (index != NULL)
+        return index;
+
+    char *sidecarPath = NULL;
+
+    if (isIndexSidecarEnabled)
+    {
+        sidecarPath = (char *)malloc(strlen(matFile->filePath) + strlen(matFile->vars[varIndex].name) + 8);
+        sprintf(sidecarPath, "%s.%s.zidx", matFile->filePath, matFile->vars[varIndex].name);
+
+        index = loadCheckpointIndex(sidecarPath, matFile->filePath, &(matFile->vars[varIndex]));
+    }
+
+    if (index == NULL)
+    {
+        index = buildCheckpointIndex(compressedData, compressedSize, error);
+
+        if (index != NULL && sidecarPath != NULL)
+            saveCheckpointIndex(sidecarPath, matFile->filePath, &(matFile->vars[varIndex]), index);
+    }
+
+    free(sidecarPath);
+
+    if (index == NULL)
+        return NULL;
+
+    // Индекс мог построить другой поток, пока этот строил свой
+#ifndef I_MAT_NO_THREADS
+    pthread_mutex_lock(&matFile->lock);
+#endif
+    if (matFile->indexes == NULL)
+        matFile->indexes = (CheckpointIndex **)calloc(matFile->varsNumber, sizeof(CheckpointIndex *));
+
+    if (matFile->indexes[varIndex] != NULL)
+    {
+        freeCheckpointIndex(index);
+        index = matFile->indexes[varIndex];
+    }
+    else
+        matFile->indexes[varIndex] = index;
+#ifndef I_MAT_NO_THREADS
+    pthread_mutex_unlock(&matFile->lock);
+#endif
+
+    return index;
+}
+
+/**
+ * Построение индекса контрольных точек zlib потока (как в zran)
+ *
+ * Поток разжимается один раз по блокам deflate (Z_BLOCK). На границе блока, если с прошлой точки разжато
+ * больше I_MAT_CHECKPOINT_SPAN байт, сохраняются смещения, недочитанные биты и последние 32 KB разжатых данных
+ */
+CheckpointIndex *buildCheckpointIndex(const unsigned char *compressedData, size_t compressedSize, IMatError *error)
+{
+    CheckpointIndex *index = (CheckpointIndex *)calloc(1, sizeof(CheckpointIndex));
+    unsigned char *window = (unsigned char *)malloc(CHECKPOINT_WINDOW_SIZE);
+    z_stream strm;
+
+    strm.zalloc = Z_NULL;
+    strm.zfree = Z_NULL;
+    strm.opaque = Z_NULL;
+    strm.avail_in = 0;
+    strm.next_in = Z_NULL;
+
+    int ret = inflateInit(&strm);
+    if (ret != Z_OK)
+    {
+        setError(error, "Failed to uncompress element, err: %d", ret);
+        free(window);
+        free(index);
+        return NULL;
+    }
+
+    strm.next_in = (unsigned char *)compressedData;
+    strm.avail_in = compressedSize;
+    strm.avail_out = 0;
+
+    uint64_t totalIn = 0, totalOut = 0, last = 0;
+
+    while (1)
+    {
+        // Окно используется по кругу, в нем всегда последние разжатые данные
+        if (strm.avail_out == 0)
+        {
+            strm.avail_out = CHECKPOINT_WINDOW_SIZE;
+            strm.next_out = window;
+        }
+
+        totalIn += strm.avail_in;
+        totalOut += strm.avail_out;
+        ret = inflate(&strm, Z_BLOCK);
+        totalIn -= strm.avail_in;
+        totalOut -= strm.avail_out;
+
+        if (ret != Z_OK)
+            break;
+
+        // Конец блока, который не является последним
+        if ((strm.data_type & 128) && !(strm.data_type & 64) && (totalOut == 0 || totalOut - last > I_MAT_CHECKPOINT_SPAN))
+        {
+            addCheckpoint(index, strm.data_type & 7, totalIn, totalOut, window, strm.avail_out);
+            last = totalOut;
+        }
+    }
+
+    inflateEnd(&strm);
+    free(window);
+
+    if (ret != Z_STREAM_END || index->pointsNumber == 0)
+    {
+        setError(error, "Failed to uncompress element, err: %d", ret);
+        freeCheckpointIndex(index);
+        return NULL;
+    }
+
+    return index;
+}
+
+void addCheckpoint(CheckpointIndex *index, int bits, uint64_t in, uint64_t out, const unsigned char *window, int left)
+{
+    if (index->pointsNumber % 16 == 0)
+        index->points = (InflateCheckpoint *)realloc(index->points, sizeof(InflateCheckpoint) * (index->pointsNumber + 16));
+
+    InflateCheckpoint *point = &(index->points[index->pointsNumber++]);
+
+    point->bits = bits;
+    point->in = in;
+    point->out = out;
+
+    // Окно разворачивается так, чтобы данные шли в порядке разжатия
+    if (left)
+        memcpy(point->window, &window[CHECKPOINT_WINDOW_SIZE - left], left);
+    if (left < CHECKPOINT_WINDOW_SIZE)
+        memcpy(&(point->window[left]), window, CHECKPOINT_WINDOW_SIZE - left);
+}
+
+void freeCheckpointIndex(CheckpointIndex *index)
+{
+    if (index == NULL)
+        return;
+
+    free(index->points);
+    free(index);
+}
+
+/**
+ * Загрузка индекса из файла-спутника
+ *
+ * Индекс принимается, только если он построен для того же элемента (смещение и размер) той же версии
+ * mat файла (размер и время изменения) и контрольная сумма точек совпала, иначе возвращается NULL
+ * и индекс строится заново
+ */
+CheckpointIndex *loadCheckpointIndex(char *sidecarPath, char *filePath, const IMatVarInfo *varInfo)
+{
+    FILE *file = fopen(sidecarPath, "rb");
+    if (file == NULL)
+        return NULL;
+
+    int64_t header[5];
+    int64_t expected[5];
+    char magic[8];
+    int pointsNumber = 0;
+
+    fillSidecarHeader(expected, filePath, varInfo);
+
+    int isValid = fread(magic, 8, 1, file) == 1 && memcmp(magic, SIDECAR_MAGIC, 8) == 0 && fread(header, sizeof(header), 1, file) == 1 &&
+                  memcmp(header, expected, sizeof(header)) == 0 && fread(&pointsNumber, sizeof(int), 1, file) == 1 && pointsNumber > 0;
+
+    CheckpointIndex *index = NULL;
+
+    if (isValid)
+    {
+        index = (CheckpointIndex *)calloc(1, sizeof(CheckpointIndex));
+        index->points = (InflateCheckpoint *)malloc(sizeof(InflateCheckpoint) * pointsNumber);
+        index->pointsNumber = pointsNumber;
+
+        uint32_t checksum;
+        int isRead = fread(index->points, sizeof(InflateCheckpoint), pointsNumber, file) == (size_t)pointsNumber &&
+                     fread(&checksum, sizeof(uint32_t), 1, file) == 1;
+
+        if (!isRead || checksum != checksumCheckpoints(index))
+        {
+            freeCheckpointIndex(index);
+            index = NULL;
+        }
+    }
+
+    fclose(file);
+    return index;
+}
+
+/**
+ * Сохранение индекса в файл-спутник (через временный файл, чтобы не оставить недописанный индекс)
+ */
+void saveCheckpointIndex(char *sidecarPath, char *filePath, const IMatVarInfo *varInfo, CheckpointIndex *index)
+{
+    int64_t header[5];
+    char *temporaryPath = (char *)malloc(strlen(sidecarPath) + 5);
+
+    sprintf(temporaryPath, "%s.tmp", sidecarPath);
+    fillSidecarHeader(header, filePath, varInfo);
+
+    FILE *file = fopen(temporaryPath, "wb");
+    if (file != NULL)
+    {
+        int isWritten = fwrite(SIDECAR_MAGIC, 8, 1, file) == 1 && fwrite(header, sizeof(header), 1, file) == 1 &&
+                        fwrite(&(index->pointsNumber), sizeof(int), 1, file) == 1 &&
+                        fwrite(index->points, sizeof(InflateCheckpoint), index->pointsNumber, file) == (size_t)index->pointsNumber;
+        uint32_t checksum = checksumCheckpoints(index);
+
+        isWritten = isWritten && fwrite(&checksum, sizeof(uint32_t), 1, file) == 1;
+
+        if (fclose(file) == 0 && isWritten)
+            rename(temporaryPath, sidecarPath);
+        else
+            remove(temporaryPath);
+    }
+
+    free(temporaryPath);
+}
+
+uint32_t checksumCheckpoints(CheckpointIndex *index)
+{
+    uint32_t checksum = adler32(0L, Z_NULL, 0);
+    const unsigned char *points = (const unsigned char *)index->points;
+    size_t length = sizeof(InflateCheckpoint) * index->pointsNumber;
+
+    // adler32 принимает длину uInt, поэтому большие индексы считаются частями
+    for (size_t i = 0; i < length; i += STREAM_CHUNK_SIZE)
+        checksum = adler32(checksum, &points[i], length - i < STREAM_CHUNK_SIZE ? length - i : STREAM_CHUNK_SIZE);
+
+    return checksum;
+}
+
+void fillSidecarHeader(int64_t *header, char *filePath, const IMatVarInfo *varInfo)
+{
+    struct stat fileStat;
+
+    memset(header, 0, sizeof(int64_t) * 5);
+
+    if (stat(filePath, &fileStat) == 0)
+    {
+        header[0] = fileStat.st_size;
+        header[1] = fileStat.st_mtime;
+    }
+
+    header[2] = varInfo->offset;
+    header[3] = varInfo->elementSize;
+    header[4] = I_MAT_CHECKPOINT_SPAN;
+}
+
+/**
+ * Разжатие и разбор элемента
+ *
+ * Большие векторы и матрицы разжимаются порциями сразу в результирующий gsl объект (streamElement),
+ * остальные элементы разжимаются целиком и разбираются через handleMatrixElement
+ */
+void decodeCompressedElement(IMatError *error, ElmementInfo *eInfo, const unsigned char *compressedData, size_t compressedSize)
+{
+    // libdeflate разжимает только целиком, поэтому с ним потоковое чтение не используется
+    if ((isDenseTarget(eInfo->target) || eInfo->target == DT_ARRAY || eInfo->target == DT_SPARSE || eInfo->target == DT_SPARSE_COMPLEX) &&
+        inflateBackend != IB_LIBDEFLATE)
+    {
+        unsigned char tagField[8];
+
+        if (decompressPrefix(compressedData, compressedSize, tagField, 8) == 8 && readFromByteUInt32(&(tagField[4])) >= I_MAT_STREAM_THRESHOLD)
+        {
+            streamElement(error, eInfo, compressedData, compressedSize);
+            return;
+        }
+    }
+
+    uncompressElement(error, eInfo, compressedData, compressedSize);
+    if (error->isErr)
+        return;
+
+    handleMatrixElement(error, eInfo);
+
+    // Разжатые данные уже перенесены в dataInt/dataInt32/dataDouble или в результат
+    releaseScratch(eInfo->zipData);
+    eInfo->zipData = NULL;
+}
+
+/**
+ * Потоковое разжатие miMATRIX элемента
+ *
+ * Заголовок элемента разжимается в небольшой буфер, результирующий gsl объект выделяется по размерам из заголовка,
+ * а данные разжимаются порциями по STREAM_CHUNK_SIZE байт и каждая порция сразу переносится на свое место в результате.
+ * Пиковая память - размер результата плюс одна порция.
+ */
+void streamElement(IMatError *error, ElmementInfo *eInfo, const unsigned char *compressedData, size_t compressedSize)
+{
+    unsigned char header[VAR_HEADER_PREFIX_SIZE];
+    z_stream localStream;
+    z_stream *strm = acquireInflateStream(&localStream);
+    if (strm == NULL)
+    {
+        setError(error, "Failed to uncompress element, err: %d", Z_MEM_ERROR);
+        return;
+    }
+
+    // Длина сжатых данных берется из 32-битного тега miCOMPRESSED и помещается в avail_in целиком
+    strm->avail_in = (uint32_t)compressedSize;
+    strm->next_in = (unsigned char *)compressedData;
+
+    // Тег, флаги и тег размеров
+    int headerLength = 32;
+    int ret = inflateExactly(strm, header, headerLength);
+
+    // Размеры, по 4 байта на размерность с выравниванием до 8 байт
+    int dimsLength = ret == Z_OK ? readFromByteInt32(&(header[28])) : 0;
+    int paddedDimsLength = (dimsLength + 7) / 8 * 8;
+
+    if (ret == Z_OK && header[0] != MI_MATRIX)
+    {
+        releaseInflateStream(strm);
+        setError(error, "Unexpected format of ungzipted data");
+        return;
+    }
+
+    if (ret == Z_OK && (dimsLength < 8 || dimsLength > 4 * I_MAT_MAX_DIMS))
+    {
+        releaseInflateStream(strm);
+        setError(error, "Unexpected number of dimensions: %d", dimsLength / 4);
+        return;
+    }
+
+    // Размеры и тег имени
+    if (ret == Z_OK)
+    {
+        ret = inflateExactly(strm, &(header[headerLength]), paddedDimsLength + 8);
+        headerLength += paddedDimsLength + 8;
+    }
+
+    int nameIndex = headerLength - 8;
+
+    // Имя: small data элемент уже прочитан вместе с тегом, иначе дочитываем выровненное по 8 байт имя
+    if (ret == Z_OK && header[nameIndex + 2] == 0)
+    {
+        int nameLength = readFromByteInt32(&(header[nameIndex + 4]));
+        int paddedLength = ceil(nameLength / 8.0) * 8;
+
+        if (headerLength + paddedLength + 8 > VAR_HEADER_PREFIX_SIZE)
+        {
+            releaseInflateStream(strm);
+            setError(error, "Unexpected length of variable name: %d", nameLength);
+            return;
+        }
+
+        ret = inflateExactly(strm, &(header[headerLength]), paddedLength);
+        headerLength += paddedLength;
+    }
+
+    // Тег подэлемента с данными
+    if (ret == Z_OK)
+    {
+        ret = inflateExactly(strm, &(header[headerLength]), 8);
+        headerLength += 8;
+    }
+
+    if (ret != Z_OK)
+    {
+        releaseInflateStream(strm);
+        setError(error, "Failed to uncompress element, err: %d", ret);
+        return;
+    }
+
+    IMatVarInfo varInfo;
+    int isComplex;
+
+    varInfo.type = DT_UNKNOWN;
+    handleMatrixHeader(header, headerLength, &varInfo, &isComplex, error);
+    if (error->isErr)
+    {
+        releaseInflateStream(strm);
+        return;
+    }
+
+    memcpy(eInfo->name, varInfo.name, sizeof(eInfo->name));
+    eInfo->sizeI = varInfo.sizeI;
+    eInfo->sizeJ = varInfo.sizeJ;
+    eInfo->type = varInfo.type;
+    eInfo->matClass = varInfo.matClass;
+    eInfo->dimsNumber = varInfo.dimsNumber;
+    memcpy(eInfo->dims, varInfo.dims, sizeof(eInfo->dims));
+
+    if (!isTypeCompatible(eInfo->target, eInfo->type))
+    {
+        releaseInflateStream(strm);
+        setError(error, "Got error while reading %s. Expected %s, but readed %s", eInfo->name, getDataTypeName(eInfo->target),
+                 getDataTypeName(eInfo->type));
+        return;
+    }
+
+    unsigned char *chunk = (unsigned char *)allocateScratch(SCRATCH_CHUNK, STREAM_CHUNK_SIZE);
+
+    if (eInfo->target == DT_SPARSE || eInfo->target == DT_SPARSE_COMPLEX)
+        ret = streamSparseData(strm, chunk, &(header[headerLength - 8]), eInfo, isComplex);
+    else
+    {
+        void *destination = allocateElementResult(eInfo);
+
+        // Действительная часть, затем (если есть) мнимая
+        ret = streamSequence(strm, chunk, &(header[headerLength - 8]), destination, eInfo, 0);
+
+        if (ret == Z_OK && isComplex)
+        {
+            unsigned char tagField[8];
+
+            ret = inflateExactly(strm, tagField, 8);
+            if (ret == Z_OK)
+                ret = streamSequence(strm, chunk, tagField, destination, eInfo, 1);
+        }
+    }
+
+    releaseScratch(chunk);
+    releaseInflateStream(strm);
+
+    if (ret == Z_OK && (eInfo->target == DT_SPARSE || eInfo->target == DT_SPARSE_COMPLEX))
+        finishSparseResult(error, eInfo);
+
+    if (ret != Z_OK)
+    {
+        freeElementResult(eInfo);
+
+        if (ret == Z_DATA_ERROR)
+            setError(error, "Expected and real data sizes don't match");
+        else
+            setError(error, "Failed to uncompress element, err: %d", ret);
+    }
+}
+
+/**
+ * Потоковое чтение подэлемента с данными, тег которого уже разжат
+ *
+ * Возвращаемое значение:
+ * ret: int - Z_OK при успехе, Z_DATA_ERROR если размер или тип данных не совпадают с ожидаемыми
+ */
+int streamSequence(z_stream *strm, unsigned char *chunk, unsigned char *tagField, void *destination, ElmementInfo *eInfo, int isImagPart)
+{
+    size_t elemsNumber = (size_t)eInfo->sizeI * eInfo->sizeJ;
+    int isSmallData = tagField[2] || tagField[3];
+    int dataTypeCode = isSmallData ? readFromByteInt16(tagField) : readFromByteInt32(tagField);
+    size_t byteSize = isSmallData ? (size_t)readFromByteUInt16(&(tagField[2])) : readFromByteUInt32(&(tagField[4]));
+
+    if (!isNumericDataCode(dataTypeCode))
+        return Z_DATA_ERROR;
+
+    int byteInElem = calculateByteSizeFromMatDataCode(dataTypeCode);
+
+    if (byteSize / byteInElem != elemsNumber)
+        return Z_DATA_ERROR;
+
+    if (isSmallData)
+    {
+        scatterSequence(destination, &(tagField[4]), dataTypeCode, 0, elemsNumber, eInfo, isImagPart);
+        return Z_OK;
+    }
+
+    size_t chunkElems = STREAM_CHUNK_SIZE / byteInElem;
+
+    for (size_t start = 0; start < elemsNumber; start += chunkElems)
+    {
+        size_t count = elemsNumber - start < chunkElems ? elemsNumber - start : chunkElems;
+
+        int ret = inflateExactly(strm, chunk, count * byteInElem);
+        if (ret != Z_OK)
+            return ret;
+
+        scatterSequence(destination, chunk, dataTypeCode, start, count, eInfo, isImagPart);
+    }
+
+    // Выравнивание подэлемента до 8 байт
+    int padding = (int)((8 - byteSize % 8) % 8);
+
+    return padding ? inflateExactly(strm, chunk, padding) : Z_OK;
+}
+
+/**
+ * Перенос порции данных (элементы start..start+count в порядке столбцов matlab) в результирующий gsl объект
+ *
+ * Векторы и матрицы в порядке столбцов декодируются прямо на свое место, матрицы и комплексные данные -
+ * небольшими партиями через буфер на стеке
+ */
+void scatterSequence(void *destination, unsigned char *byteSeq, int dataTypeCode, size_t start, size_t count, ElmementInfo *eInfo, int isImagPart)
+{
+    int byteInElem = calculateByteSizeFromMatDataCode(dataTypeCode);
+    // В режиме columnMajor порядок элементов matlab совпадает с порядком в результате
+    int isArray = eInfo->target == DT_ARRAY;
+    int isMatrix = (isMatrixTarget(eInfo->target) || isArray) && !eInfo->columnMajor;
+    int isComplex = eInfo->target == DT_VECTOR_COMPLEX || eInfo->target == DT_MATRIX_COMPLEX || eInfo->target == DT_VECTOR_COMPLEX_FLOAT ||
+                    eInfo->target == DT_MATRIX_COMPLEX_FLOAT;
+    int isInt = eInfo->target == DT_VECTOR_INT || eInfo->target == DT_MATRIX_INT;
+    int isFloat = isFloatTarget(eInfo->target);
+    enum EDecodeTarget decodeTarget = isInt ? DECODE_INT : (isFloat ? DECODE_FLOAT : DECODE_DOUBLE);
+
+    if (!isMatrix && !isComplex)
+    {
+        if (isInt)
+            handleSequence((int *)destination + start, decodeTarget, byteSeq, dataTypeCode, count);
+        else if (isFloat)
+            handleSequence((float *)destination + start, decodeTarget, byteSeq, dataTypeCode, count);
+        else
+            handleSequence((double *)destination + start, decodeTarget, byteSeq, dataTypeCode, count);
+        return;
+    }
+
+    double batch[1024];
+    size_t batchSize = sizeof(batch) / sizeof(batch[0]);
+
+    for (size_t batchStart = 0; batchStart < count; batchStart += batchSize)
+    {
+        size_t batchCount = count - batchStart < batchSize ? count - batchStart : batchSize;
+
+        handleSequence(batch, decodeTarget, &(byteSeq[batchStart * byteInElem]), dataTypeCode, batchCount);
+
+        for (size_t k = 0; k < batchCount; k++)
+        {
+            size_t index = start + batchStart + k;
+
+            // Матрицы matlab хранятся по столбцам, gsl - по строкам; у N-мерного массива так переставляется каждая страница
+            if (isArray)
+            {
+                size_t column = index / eInfo->sizeI;
+                index = (column / eInfo->dims[1] * eInfo->sizeI + index % eInfo->sizeI) * eInfo->dims[1] + column % eInfo->dims[1];
+            }
+            else if (isMatrix)
+                index = (index % eInfo->sizeI) * eInfo->sizeJ + index / eInfo->sizeI;
+
+            if (isInt)
+                ((int *)destination)[index] = ((int *)batch)[k];
+            else if (isFloat)
+                ((float *)destination)[isComplex ? 2 * index + isImagPart : index] = ((float *)batch)[k];
+            else if (isComplex)
+                ((double *)destination)[2 * index + isImagPart] = batch[k];
+            else
+                ((double *)destination)[index] = batch[k];
+        }
+    }
+}
+
+/**
+ * Разбор данных sparse элемента из eInfo->zipData сразу в CSC матрицу gsl
+ *
+ * Подэлементы ir (строки ненулевых значений), jc (начала столбцов, sizeJ + 1) и pr/pi (значения)
+ * декодируются прямо в массивы i, p и data результата, плотная матрица не строится
+ */
+void handleSparseElement(IMatError *error, ElmementInfo *eInfo, int dataStartIndex, int isComplex)
+{
+    int irCode, jcCode, prCode, piCode = 0;
+    size_t length;
+
+    unsigned char *irPointer = locateSequence(eInfo, dataStartIndex, -1, &irCode, &length, error);
+    if (error->isErr)
+        return;
+
+    // Индексы строк sparse массива - int32, поэтому ненулевых значений не больше 2^31 - 1
+    size_t nzmax = getSequenceCount(&(eInfo->zipData[dataStartIndex]));
+    size_t index = dataStartIndex + length;
+
+    if (nzmax > 2147483647)
+    {
+        setError(error, "Expected and real data sizes don't match");
+        return;
+    }
+
+    unsigned char *jcPointer = locateSequence(eInfo, index, eInfo->sizeJ + 1, &jcCode, &length, error);
+    if (error->isErr)
+        return;
+
+    index += length;
+
+    unsigned char *prPointer = locateSequence(eInfo, index, (int64_t)nzmax, &prCode, &length, error);
+    if (error->isErr)
+        return;
+
+    unsigned char *piPointer = NULL;
+
+    if (isComplex)
+    {
+        piPointer = locateSequence(eInfo, index + length, (int64_t)nzmax, &piCode, &length, error);
+        if (error->isErr)
+            return;
+    }
+
+    int *rowIndices, *columnPointers;
+    double *values;
+    int step = allocateSparseResult(eInfo, nzmax, &rowIndices, &columnPointers, &values);
+
+    handleSequence(rowIndices, DECODE_INT, irPointer, irCode, nzmax);
+    handleSequence(columnPointers, DECODE_INT, jcPointer, jcCode, eInfo->sizeJ + 1);
+    scatterSparseSequence(values, DECODE_DOUBLE, step, prPointer, prCode, 0, nzmax);
+
+    if (piPointer != NULL)
+        scatterSparseSequence(values + 1, DECODE_DOUBLE, step, piPointer, piCode, 0, nzmax);
+
+    finishSparseResult(error, eInfo);
+}
+
+/**
+ * Потоковое чтение данных sparse элемента, тег ir которого уже разжат
+ *
+ * Результат выделяется по длине ir, а ir, jc и значения разжимаются порциями сразу в его массивы
+ *
+ * Возвращаемое значение:
+ * ret: int - Z_OK при успехе, Z_DATA_ERROR если размер или тип данных не совпадают с ожидаемыми
+ */
+int streamSparseData(z_stream *strm, unsigned char *chunk, unsigned char *tagField, ElmementInfo *eInfo, int isComplex)
+{
+    // Как и в handleSparseElement, индексы строк int32
+    size_t nzmax = getSequenceCount(tagField);
+    if (nzmax > 2147483647)
+        return Z_DATA_ERROR;
+
+    int *rowIndices, *columnPointers;
+    double *values;
+    int step = allocateSparseResult(eInfo, nzmax, &rowIndices, &columnPointers, &values);
+    unsigned char nextTag[8];
+
+    int ret = streamSparseSequence(strm, chunk, tagField, rowIndices, DECODE_INT, 1, nzmax);
+
+    if (ret == Z_OK)
+        ret = inflateExactly(strm, nextTag, 8);
+    if (ret == Z_OK)
+        ret = streamSparseSequence(strm, chunk, nextTag, columnPointers, DECODE_INT, 1, eInfo->sizeJ + 1);
+
+    if (ret == Z_OK)
+        ret = inflateExactly(strm, nextTag, 8);
+    if (ret == Z_OK)
+        ret = streamSparseSequence(strm, chunk, nextTag, values, DECODE_DOUBLE, step, nzmax);
+
+    if (ret == Z_OK && isComplex)
+    {
+        ret = inflateExactly(strm, nextTag, 8);
+        if (ret == Z_OK)
+            ret = streamSparseSequence(strm, chunk, nextTag, values + 1, DECODE_DOUBLE, step, nzmax);
+    }
+
+    return ret;
+}
+
+/**
+ * Потоковое чтение одного подэлемента sparse элемента (см. streamSequence)
+ */
+int streamSparseSequence(z_stream *strm, unsigned char *chunk, unsigned char *tagField, void *destination, enum EDecodeTarget target, int step,
+                         size_t expectedCount)
+{
+    int isSmallData = tagField[2] || tagField[3];
+    int dataTypeCode = isSmallData ? readFromByteInt16(tagField) : readFromByteInt32(tagField);
+    size_t byteSize = isSmallData ? (size_t)readFromByteUInt16(&(tagField[2])) : readFromByteUInt32(&(tagField[4]));
+
+    if (getSequenceCount(tagField) != expectedCount)
+        return Z_DATA_ERROR;
+
+    if (isSmallData)
+    {
+        scatterSparseSequence(destination, target, step, &(tagField[4]), dataTypeCode, 0, expectedCount);
+        return Z_OK;
+    }
+
+    int byteInElem = calculateByteSizeFromMatDataCode(dataTypeCode);
+    size_t chunkElems = STREAM_CHUNK_SIZE / byteInElem;
+
+    for (size_t start = 0; start < expectedCount; start += chunkElems)
+    {
+        size_t count = expectedCount - start < chunkElems ? expectedCount - start : chunkElems;
+
+        int ret = inflateExactly(strm, chunk, count * byteInElem);
+        if (ret != Z_OK)
+            return ret;
+
+        scatterSparseSequence(destination, target, step, chunk, dataTypeCode, start, count);
+    }
+
+    // Выравнивание подэлемента до 8 байт
+    int padding = (int)((8 - byteSize % 8) % 8);
+
+    return padding ? inflateExactly(strm, chunk, padding) : Z_OK;
+}
+
+/**
+ * Декодирование элементов start..start+count подэлемента в массив результата с шагом step
+ *
+ * Шаг 2 - действительные или мнимые части комплексных значений gsl_spmatrix_complex
+ */
+void scatterSparseSequence(void *destination, enum EDecodeTarget target, int step, const unsigned char *byteSeq, int dataTypeCode, size_t start,
+                           size_t count)
+{
+    if (step == 1)
+    {
+        if (target == DECODE_INT)
+            handleSequence((int *)destination + start, target, byteSeq, dataTypeCode, count);
+        else
+            handleSequence((double *)destination + start, target, byteSeq, dataTypeCode, count);
+        return;
+    }
+
+    int byteInElem = calculateByteSizeFromMatDataCode(dataTypeCode);
+    double batch[1024];
+    size_t batchSize = sizeof(batch) / sizeof(batch[0]);
+
+    for (size_t batchStart = 0; batchStart < count; batchStart += batchSize)
+    {
+        size_t batchCount = count - batchStart < batchSize ? count - batchStart : batchSize;
+
+        handleSequence(batch, DECODE_DOUBLE, &(byteSeq[batchStart * byteInElem]), dataTypeCode, batchCount);
+
+        for (size_t k = 0; k < batchCount; k++)
+            ((double *)destination)[(start + batchStart + k) * step] = batch[k];
+    }
+}
+
+/**
+ * Количество значений в подэлементе по его тегу
+ * (SIZE_MAX, если тип данных не числовой или длина не кратна размеру значения)
+ */
+size_t getSequenceCount(unsigned char *tagField)
+{
+    int isSmallData = tagField[2] || tagField[3];
+    int dataTypeCode = isSmallData ? readFromByteInt16(tagField) : readFromByteInt32(tagField);
+    size_t byteSize = isSmallData ? (size_t)readFromByteUInt16(&(tagField[2])) : readFromByteUInt32(&(tagField[4]));
+
+    if (!isNumericDataCode(dataTypeCode))
+        return SIZE_MAX;
+
+    int byteInElem = calculateByteSizeFromMatDataCode(dataTypeCode);
+
+    return byteSize % byteInElem == 0 ? byteSize / byteInElem : SIZE_MAX;
+}
+
+/**
+ * Выделение CSC матрицы под nzmax ненулевых значений
+ *
+ * Возвращаемое значение:
+ * step: int - шаг значений в data (2 для комплексной матрицы: действительные и мнимые части чередуются)
+ */
+int allocateSparseResult(ElmementInfo *eInfo, size_t nzmax, int **rowIndices, int **columnPointers, double **values)
+{
+    // gsl не выделяет матрицу без места под значения
+    size_t capacity = nzmax > 0 ? nzmax : 1;
+
+    if (eInfo->target == DT_SPARSE_COMPLEX)
+    {
+        gsl_spmatrix_complex *result = gsl_spmatrix_complex_alloc_nzmax(eInfo->sizeI, eInfo->sizeJ, capacity, GSL_SPMATRIX_CSC);
+
+        eInfo->result = result;
+        *rowIndices = result->i;
+        *columnPointers = result->p;
+        *values = result->data;
+
+        // Мнимые части действительной матрицы
+        memset(result->data, 0, sizeof(double) * 2 * capacity);
+        return 2;
+    }
+
+    gsl_spmatrix *result = gsl_spmatrix_alloc_nzmax(eInfo->sizeI, eInfo->sizeJ, capacity, GSL_SPMATRIX_CSC);
+
+    eInfo->result = result;
+    *rowIndices = result->i;
+    *columnPointers = result->p;
+    *values = result->data;
+
+    return 1;
+}
+
+/**
+ * Проверка структуры прочитанной CSC матрицы и запись количества ненулевых значений
+ *
+ * Начала столбцов должны не убывать от 0 до nz <= nzmax, номера строк - лежать в пределах матрицы.
+ * При ошибке результат освобождается
+ */
+void finishSparseResult(IMatError *error, ElmementInfo *eInfo)
+{
+    int *rowIndices, *columnPointers;
+    size_t nzmax, *nz;
+
+    if (eInfo->target == DT_SPARSE_COMPLEX)
+    {
+        gsl_spmatrix_complex *result = (gsl_spmatrix_complex *)eInfo->result;
+
+        rowIndices = result->i;
+        columnPointers = result->p;
+        nzmax = result->nzmax;
+        nz = &result->nz;
+    }
+    else
+    {
+        gsl_spmatrix *result = (gsl_spmatrix *)eInfo->result;
+
+        rowIndices = result->i;
+        columnPointers = result->p;
+        nzmax = result->nzmax;
+        nz = &result->nz;
+    }
+
+    int isValid = columnPointers[0] == 0 && (size_t)columnPointers[eInfo->sizeJ] <= nzmax;
+
+    for (int j = 0; j < eInfo->sizeJ && isValid; j++)
+        isValid = columnPointers[j] <= columnPointers[j + 1];
+
+    for (int k = 0; isValid && k < columnPointers[eInfo->sizeJ]; k++)
+        isValid = rowIndices[k] >= 0 && rowIndices[k] < eInfo->sizeI;
+
+    if (!isValid)
+    {
+        freeElementResult(eInfo);
+        setError(error, "Unexpected structure of sparse matrix %s", eInfo->name);
+        return;
+    }
+
+    *nz = columnPointers[eInfo->sizeJ];
+}
+
+/**
+ * Выделение результирующего gsl объекта под тип target, данные в который будут декодированы напрямую
+ *
+ * Возвращаемое значение:
+ * destination: void* - начало блока данных результата
+ */
+void *allocateElementResult(ElmementInfo *eInfo)
+{
+    size_t elemsNumber = (size_t)eInfo->sizeI * eInfo->sizeJ;
+    // В порядке столбцов matlab матрица A хранится как gsl матрица A^T
+    int rows = eInfo->columnMajor ? eInfo->sizeJ : eInfo->sizeI;
+    int columns = eInfo->columnMajor ? eInfo->sizeI : eInfo->sizeJ;
+
+    switch (eInfo->target)
+    {
+    case DT_VECTOR:
+        eInfo->result = gsl_vector_alloc(elemsNumber);
+        return ((gsl_vector *)eInfo->result)->data;
+    case DT_VECTOR_INT:
+        eInfo->result = gsl_vector_int_alloc(elemsNumber);
+        return ((gsl_vector_int *)eInfo->result)->data;
+    case DT_VECTOR_COMPLEX:
+        eInfo->result = gsl_vector_complex_alloc(elemsNumber);
+        return ((gsl_vector_complex *)eInfo->result)->data;
+    case DT_MATRIX:
+        eInfo->result = gsl_matrix_alloc(rows, columns);
+        return ((gsl_matrix *)eInfo->result)->data;
+    case DT_MATRIX_INT:
+        eInfo->result = gsl_matrix_int_alloc(rows, columns);
+        return ((gsl_matrix_int *)eInfo->result)->data;
+    case DT_VECTOR_FLOAT:
+        eInfo->result = gsl_vector_float_alloc(elemsNumber);
+        return ((gsl_vector_float *)eInfo->result)->data;
+    case DT_VECTOR_COMPLEX_FLOAT:
+        eInfo->result = gsl_vector_complex_float_alloc(elemsNumber);
+        return ((gsl_vector_complex_float *)eInfo->result)->data;
+    case DT_MATRIX_FLOAT:
+        eInfo->result = gsl_matrix_float_alloc(rows, columns);
+        return ((gsl_matrix_float *)eInfo->result)->data;
+    case DT_MATRIX_COMPLEX_FLOAT:
+        eInfo->result = gsl_matrix_complex_float_alloc(rows, columns);
+        return ((gsl_matrix_complex_float *)eInfo->result)->data;
+    case DT_ARRAY:
+        eInfo->result = allocateMatArray(eInfo->dimsNumber, eInfo->dims);
+        return ((IMatArray *)eInfo->result)->data;
+    default:
+        eInfo->result = gsl_matrix_complex_alloc(rows, columns);
+        return ((gsl_matrix_complex *)eInfo->result)->data;
+    }
+}
+
+/**
+ * Разжать ровно size байт в destination
+ *
+ * Выход подается zlib окнами не больше I_MAT_INFLATE_WINDOW байт (avail_out 32-битный)
+ *
+ * Возвращаемое значение:
+ * ret: int - Z_OK при успехе, Z_DATA_ERROR если поток закончился раньше
+ */
+int inflateExactly(z_stream *strm, unsigned char *destination, size_t size)
+{
+    uint64_t statsStart = STATS_START();
+    int ret = Z_OK;
+    size_t produced = 0;
+
+    while (produced < size && ret == Z_OK)
+    {
+        uint32_t window = size - produced < I_MAT_INFLATE_WINDOW ? (uint32_t)(size - produced) : I_MAT_INFLATE_WINDOW;
+
+        strm->next_out = destination + produced;
+        strm->avail_out = window;
+
+        while (strm->avail_out > 0 && ret == Z_OK)
+        {
+            ret = inflate(strm, Z_SYNC_FLUSH);
+
+            if (ret == Z_STREAM_END || (ret == Z_BUF_ERROR && strm->avail_in == 0))
+                ret = strm->avail_out ? Z_DATA_ERROR : Z_OK;
+        }
+
+        produced += window - strm->avail_out;
+    }
+
+    STATS_ADD(inflateNs, statsStart);
+    STATS_COUNT(uncompressedBytes, produced);
+
+    return ret;
+}
+
+/**
+ * Проверка, можно ли прочитать данные типа type в результат типа target
+ */
+int isTypeCompatible(enum EDataTypes target, enum EDataTypes type)
+{
+    // single результат принимает те же данные, что и double: значения приводятся к float при декодировании
+    switch (target)
+    {
+    case DT_VECTOR:
+    case DT_VECTOR_FLOAT:
+        return type == DT_VECTOR || type == DT_DOUBLE || type == DT_EMPTY || type == DT_VECTOR_INT || type == DT_INT;
+    case DT_VECTOR_INT:
+        return type == DT_VECTOR_INT || type == DT_INT || type == DT_EMPTY;
+    case DT_VECTOR_COMPLEX:
+    case DT_VECTOR_COMPLEX_FLOAT:
+        return type == DT_VECTOR_COMPLEX || type == DT_COMPLEX || type == DT_EMPTY;
+    case DT_ARRAY:
+        // Векторы и матрицы читаются как двумерный массив
+        return type == DT_ARRAY || isTypeCompatible(DT_MATRIX, type);
+    case DT_MATRIX:
+    case DT_MATRIX_FLOAT:
+        return type == DT_MATRIX || type == DT_VECTOR || type == DT_DOUBLE || type == DT_EMPTY || type == DT_MATRIX_INT ||
+               type == DT_VECTOR_INT || type == DT_INT;
+    case DT_MATRIX_INT:
+        return type == DT_MATRIX_INT || type == DT_VECTOR_INT || type == DT_INT || type == DT_EMPTY;
+    case DT_MATRIX_COMPLEX:
+    case DT_MATRIX_COMPLEX_FLOAT:
+        return type == DT_MATRIX_COMPLEX || type == DT_VECTOR_COMPLEX || type == DT_COMPLEX || type == DT_EMPTY;
+    case DT_SPARSE_COMPLEX:
+        return type == DT_SPARSE_COMPLEX || type == DT_SPARSE;
+    default:
+        return type == target;
+    }
+}
+
+/**
+ * Результат - gsl вектор или плотная матрица (может собираться при потоковом разжатии и храниться в кэше)
+ */
+int isDenseTarget(enum EDataTypes target)
+{
+    return (target >= DT_VECTOR && target <= DT_MATRIX_COMPLEX) || (target >= DT_VECTOR_FLOAT && target <= DT_MATRIX_COMPLEX_FLOAT);
+}
+
+/**
+ * Результат - плотная gsl матрица (хранится по строкам, в отличие от данных matlab)
+ */
+int isMatrixTarget(enum EDataTypes target)
+{
+    return (target >= DT_MATRIX && target <= DT_MATRIX_COMPLEX) || target == DT_MATRIX_FLOAT || target == DT_MATRIX_COMPLEX_FLOAT;
+}
+
+/**
+ * Результат в single precision (gsl_*_float)
+ */
+int isFloatTarget(enum EDataTypes target)
+{
+    return target >= DT_VECTOR_FLOAT && target <= DT_MATRIX_COMPLEX_FLOAT;
+}
+
+/**
+ * Разбор флагов, размеров и имени miMATRIX элемента
+ *
+ * Входные данные:
+ *  matrixData: unsigned char* - элемент вместе с тегом
+ *  length: size_t             - сколько байт элемента доступно
+ *  varInfo: IMatVarInfo*      - куда записать имя, класс и размеры
+ *  isComplex: int*            - флаг комплексных данных
+ *
+ * Возвращаемое значение:
+ *  dataStartIndex: int - начало подэлемента с данными (или -1 при ошибке)
+ */
+int handleMatrixHeader(unsigned char *matrixData, size_t length, IMatVarInfo *varInfo, int *isComplex, IMatError *error)
+{
+    if (length < 48 || matrixData[0] != MI_MATRIX)
+    {
+        setError(error, "Unexpected format of ungzipted data");
+        return -1;
+    }
+
+    // Проверка на комплексное значение
+    // TODO добавить определение типа массива
+    unsigned char complexFlagMask = 1 << 3;
+    *isComplex = (complexFlagMask & matrixData[17]) ? 1 : 0;
+    varInfo->matClass = matrixData[16];
+
+    // Получаем размеры элемента: по 4 байта на размерность, выравнивание до 8 байт
+    int dimsLength = readFromByteInt32(&(matrixData[28]));
+    int dimsNumber = dimsLength / 4;
+
+    if (dimsLength % 4 != 0 || dimsNumber < 2 || dimsNumber > I_MAT_MAX_DIMS)
+    {
+        setError(error, "Unexpected number of dimensions: %d", dimsNumber);
+        return -1;
+    }
+
+    int nameIndex = 32 + (dimsLength + 7) / 8 * 8;
+    if ((size_t)nameIndex + 8 > length)
+    {
+        setError(error, "Unexpected format of ungzipted data");
+        return -1;
+    }
+
+    // Размерности после первой сворачиваются в столбцы: N-мерный массив хранится как sizeI x (dims[1] * ... * dims[N-1])
+    long long columns = 1;
+
+    varInfo->dimsNumber = dimsNumber;
+    for (int k = 0; k < dimsNumber; k++)
+    {
+        varInfo->dims[k] = readFromByteInt32(&(matrixData[32 + 4 * k]));
+        if (k > 0 && columns <= 2147483647)
+            columns *= varInfo->dims[k];
+    }
+
+    // Значения плотного массива лежат в одном подэлементе с 32-битной длиной, у sparse массива размеры ограничены только size_t
+    uint64_t elemsNumber = varInfo->dims[0] < 0 || columns < 0 ? 0 : (uint64_t)varInfo->dims[0] * columns;
+
+    if (varInfo->dims[0] < 0 || columns < 0 || columns > 2147483647 || elemsNumber > SIZE_MAX ||
+        (varInfo->matClass != MX_SPARSE_CLASS && elemsNumber > UINT32_MAX))
+    {
+        setError(error, "Array is too large");
+        return -1;
+    }
+
+    varInfo->sizeI = varInfo->dims[0];
+    varInfo->sizeJ = (int)columns;
+
+    // Получаем имя и начало данных
+    int isSmallName = matrixData[nameIndex + 2] != 0;
+    int nameLength = isSmallName ? matrixData[nameIndex + 2] : readFromByteInt32(&matrixData[nameIndex + 4]);
+    int dataStartIndex = isSmallName ? nameIndex + 8 : nameIndex + 8 + ceil(nameLength / 8.0) * 8;
+
+    if (nameLength < 0 || nameLength >= (int)sizeof(varInfo->name) || (size_t)(isSmallName ? nameIndex + 4 : nameIndex + 8) + nameLength > length)
+    {
+        setError(error, "Unexpected length of variable name: %d", nameLength);
+        return -1;
+    }
+
+    memcpy(varInfo->name, &matrixData[isSmallName ? nameIndex + 4 : nameIndex + 8], nameLength);
+    varInfo->name[nameLength] = '\0';
+
+    if (elemsNumber == 0)
+        varInfo->type = DT_EMPTY;
+    else if ((size_t)dataStartIndex < length)
+    {
+        int dataTypeCode = matrixData[dataStartIndex];
+        varInfo->type = decideType(varInfo->sizeI, varInfo->sizeJ, *isComplex, dataTypeCode);
+
+        if (dataTypeCode == 12 || dataTypeCode == 13)
+            varInfo->type = DT_INT_64;
+
+        // Массивы больше двух размерностей читаются только как действительный IMatArray
+        if (dimsNumber > 2)
+            varInfo->type = *isComplex ? DT_UNKNOWN : DT_ARRAY;
+    }
+
+    // У sparse массива первым идет подэлемент ir, тип определяется по классу
+    if (varInfo->matClass == MX_SPARSE_CLASS && elemsNumber != 0)
+        varInfo->type = *isComplex ? DT_SPARSE_COMPLEX : DT_SPARSE;
+
+    // Так же struct (и объекты) и cell массивы, в том числе пустые
+    if (varInfo->matClass == MX_STRUCT_CLASS || varInfo->matClass == MX_OBJECT_CLASS)
+        varInfo->type = DT_STRUCT;
+    else if (varInfo->matClass == MX_CELL_CLASS)
+        varInfo->type = DT_CELL;
+
+    // Класс и размеры читаемой переменной для статистики
+    if (threadStats != NULL)
+    {
+        threadStats->stats.matClass = varInfo->matClass;
+        threadStats->stats.dimsNumber = varInfo->dimsNumber;
+        memcpy(threadStats->stats.dims, varInfo->dims, sizeof(threadStats->stats.dims));
+    }
+
+    return dataStartIndex;
+}
+
+/**
+ * Заполнение записи индекса для элемента верхнего уровня без разжатия данных
+ *
+ * Разжимается только начало элемента (VAR_HEADER_PREFIX_SIZE байт) - этого хватает на флаги, размеры и имя
+ */
+void handleVarInfo(FILE *file, int elementType, size_t elementSize, IMatVarInfo *varInfo, IMatError *error)
+{
+    // Для разжатия начала элемента достаточно сжатых данных того же размера с запасом на заголовки блоков
+    unsigned char data[2 * VAR_HEADER_PREFIX_SIZE];
+    size_t available = fread(data, 1, elementSize < sizeof(data) ? elementSize : sizeof(data), file);
+
+    handleVarData(elementType, elementSize, data, available, varInfo, error);
+}
+
+/**
+ * Заполнение записи индекса по началу данных элемента (data - данные после тега, доступно available байт)
+ */
+void handleVarData(int elementType, size_t elementSize, const unsigned char *data, size_t available, IMatVarInfo *varInfo, IMatError *error)
+{
+    unsigned char prefix[VAR_HEADER_PREFIX_SIZE];
+    int prefixLength;
+
+    if (elementType == MI_COMPRESSED)
+    {
+        prefixLength = decompressPrefix(data, available < 2 * VAR_HEADER_PREFIX_SIZE ? available : 2 * VAR_HEADER_PREFIX_SIZE, prefix,
+                                        VAR_HEADER_PREFIX_SIZE);
+        if (prefixLength < 0)
+        {
+            setError(error, "Failed to uncompress element, err: %d", prefixLength);
+            return;
+        }
+    }
+    else if (elementType == MI_MATRIX)
+    {
+        uint32_t tagSize = (uint32_t)elementSize;
+        size_t dataLength = available < VAR_HEADER_PREFIX_SIZE - 8 ? available : VAR_HEADER_PREFIX_SIZE - 8;
+
+        // Тег уже прочитан, восстанавливаем его в начале буфера
+        prefix[0] = MI_MATRIX;
+        memset(&prefix[1], 0, 3);
+        memcpy(&prefix[4], &tagSize, 4);
+        memcpy(&prefix[8], data, dataLength);
+        prefixLength = 8 + (int)dataLength;
+    }
+    else
+    {
+        setError(error, "Unexpected element type: %d", elementType);
+        return;
+    }
+
+    int isComplex;
+    varInfo->type = DT_UNKNOWN;
+
+    handleMatrixHeader(prefix, prefixLength, varInfo, &isComplex, error);
+}
+
+/**
+ * Разбор miMATRIX элемента из eInfo->zipData
+ *
+ * Данные декодируются сразу в тип, который ожидает вызывающая функция (eInfo->target):
+ * в dataDouble, dataInt32 или dataInt. Некомплексные векторы декодируются прямо в результирующий gsl вектор.
+ */
+void handleMatrixElement(IMatError *error, ElmementInfo *eInfo)
+{
+    IMatVarInfo varInfo;
+    int isComplex;
+
+    varInfo.type = DT_UNKNOWN;
+
+    int dataStartIndex = handleMatrixHeader(eInfo->zipData, eInfo->zipSize, &varInfo, &isComplex, error);
+    if (error->isErr)
+        return;
+
+    memcpy(eInfo->name, varInfo.name, sizeof(eInfo->name));
+    eInfo->sizeI = varInfo.sizeI;
+    eInfo->sizeJ = varInfo.sizeJ;
+    eInfo->matClass = varInfo.matClass;
+    eInfo->dimsNumber = varInfo.dimsNumber;
+    memcpy(eInfo->dims, varInfo.dims, sizeof(eInfo->dims));
+    size_t expectedSize = (size_t)eInfo->sizeI * eInfo->sizeJ;
+
+    // struct и cell массивы разбираются только в дерево (openMatTree), несовпадение типов сообщит convertElementTo*
+    if (varInfo.type == DT_STRUCT || varInfo.type == DT_CELL)
+    {
+        eInfo->type = varInfo.type;
+        return;
+    }
+
+    // sparse массив читается только в CSC матрицу, несовпадение типов сообщит convertElementTo*
+    if (varInfo.type == DT_SPARSE || varInfo.type == DT_SPARSE_COMPLEX || eInfo->target == DT_SPARSE || eInfo->target == DT_SPARSE_COMPLEX)
+    {
+        eInfo->type = varInfo.type;
+
+        if (isTypeCompatible(eInfo->target, eInfo->type))
+            handleSparseElement(error, eInfo, dataStartIndex, isComplex);
+        return;
+    }
+
+    // Если записан пустой элемент
+    if (expectedSize == 0)
+    {
+        eInfo->type = DT_EMPTY;
+
+        // В порядке столбцов пустая матрица, как и непустая, возвращается размера sizeJ x sizeI
+        if (eInfo->columnMajor && isMatrixTarget(eInfo->target))
+            allocateElementResult(eInfo);
+        return;
+    }
+
+    int dataTypeCode;
+    size_t sequenceLength;
+    unsigned char *dataPointer = locateSequence(eInfo, dataStartIndex, expectedSize, &dataTypeCode, &sequenceLength, error);
+    if (error->isErr)
+        return;
+
+    eInfo->type = varInfo.type;
+
+    // Мнимая часть идет сразу после действительной и может быть записана в другом типе
+    int imagTypeCode = 0;
+    unsigned char *imagDataPointer = NULL;
+
+    if (isComplex)
+    {
+        imagDataPointer = locateSequence(eInfo, dataStartIndex + sequenceLength, expectedSize, &imagTypeCode, &sequenceLength, error);
+        if (error->isErr)
+            return;
+    }
+
+    enum EDecodeTarget decodeTarget = selectDecodeTarget(eInfo->target, isComplex, dataTypeCode);
+    int isCompatible = isTypeCompatible(eInfo->target, eInfo->type);
+
+    // Векторы и матрицы в порядке столбцов декодируем сразу в результат
+    if (isDenseTarget(eInfo->target) && (!isMatrixTarget(eInfo->target) || eInfo->columnMajor) && isCompatible)
+    {
+        void *destination = allocateElementResult(eInfo);
+
+        scatterSequence(destination, dataPointer, dataTypeCode, 0, expectedSize, eInfo, 0);
+        if (isComplex)
+            scatterSequence(destination, imagDataPointer, imagTypeCode, 0, expectedSize, eInfo, 1);
+        return;
+    }
+
+    // double матрица транспонируется прямо из данных элемента (разжатого буфера или отображенного файла)
+    if (eInfo->target == DT_MATRIX && dataTypeCode == 9 && !isComplex && isCompatible && (uintptr_t)dataPointer % sizeof(double) == 0)
+    {
+        allocateElementResult(eInfo);
+        gsl_matrix *result = (gsl_matrix *)eInfo->result;
+
+        transposeDouble(result->data, result->tda, (const double *)dataPointer, eInfo->sizeI, eInfo->sizeJ);
+        return;
+    }
+
+    // И каждая страница N-мерного массива
+    if (eInfo->target == DT_ARRAY && dataTypeCode == 9 && !isComplex && isCompatible && (uintptr_t)dataPointer % sizeof(double) == 0)
+    {
+        allocateElementResult(eInfo);
+        transposeArrayPages((IMatArray *)eInfo->result, (const double *)dataPointer);
+        return;
+    }
+
+    // Так же single матрица из данных miSINGLE
+    if (eInfo->target == DT_MATRIX_FLOAT && dataTypeCode == 7 && !isComplex && isCompatible && (uintptr_t)dataPointer % sizeof(float) == 0)
+    {
+        allocateElementResult(eInfo);
+        gsl_matrix_float *result = (gsl_matrix_float *)eInfo->result;
+
+        transposeFloat(result->data, result->tda, (const float *)dataPointer, eInfo->sizeI, eInfo->sizeJ);
+        return;
+    }
+
+    switch (decodeTarget)
+    {
+    case DECODE_DOUBLE:
+        eInfo->dataDouble = (double *)allocateScratch(SCRATCH_DOUBLE, sizeof(double) * expectedSize * (isComplex ? 2 : 1));
+        handleSequence(eInfo->dataDouble, decodeTarget, dataPointer, dataTypeCode, expectedSize);
+        break;
+    case DECODE_INT:
+        eInfo->dataInt32 = (int *)allocateScratch(SCRATCH_INT32, sizeof(int) * expectedSize);
+        handleSequence(eInfo->dataInt32, decodeTarget, dataPointer, dataTypeCode, expectedSize);
+        break;
+    case DECODE_INT_64:
+        eInfo->dataInt = (int64_t *)allocateScratch(SCRATCH_INT64, sizeof(int64_t) * expectedSize);
+        handleSequence(eInfo->dataInt, decodeTarget, dataPointer, dataTypeCode, expectedSize);
+        break;
+    case DECODE_FLOAT:
+        eInfo->dataFloat = (float *)allocateScratch(SCRATCH_FLOAT, sizeof(float) * expectedSize * (isComplex ? 2 : 1));
+        handleSequence(eInfo->dataFloat, decodeTarget, dataPointer, dataTypeCode, expectedSize);
+        break;
+    }
+
+    if (isComplex && decodeTarget == DECODE_FLOAT)
+        handleSequence(&(eInfo->dataFloat[expectedSize]), DECODE_FLOAT, imagDataPointer, imagTypeCode, expectedSize);
+    else if (isComplex)
+        handleSequence(&(eInfo->dataDouble[expectedSize]), DECODE_DOUBLE, imagDataPointer, imagTypeCode, expectedSize);
+}
+
+/**
+ * Проверка подэлемента с данными, начинающегося с startIndex в данных элемента
+ *
+ * Подэлемент должен целиком лежать в данных элемента, иметь числовой тип и содержать expectedSize значений
+ *
+ * Возвращаемое значение:
+ * data: unsigned char* - начало данных подэлемента (NULL при ошибке)
+ * dataTypeCode: int*   - код типа данных matlab
+ * length: size_t*      - длина подэлемента с тегом и выравниванием до 8 байт
+ */
+unsigned char *locateSequence(ElmementInfo *eInfo, size_t startIndex, int64_t expectedSize, int *dataTypeCode, size_t *length, IMatError *error)
+{
+    if (startIndex + 8 > eInfo->zipSize)
+    {
+        setError(error, "Unexpected end of element data");
+        return NULL;
+    }
+
+    unsigned char *tagField = &(eInfo->zipData[startIndex]);
+
+    // Проверяем smalldata или нет
+    int isSmallData = tagField[2] || tagField[3];
+    *dataTypeCode = isSmallData ? readFromByteInt16(tagField) : readFromByteInt32(tagField);
+
+    if (!isNumericDataCode(*dataTypeCode))
+    {
+        setError(error, "Unexpected type when reading data sequence");
+        return NULL;
+    }
+
+    int byteInElem = calculateByteSizeFromMatDataCode(*dataTypeCode);
+    size_t byteSize = isSmallData ? (size_t)readFromByteUInt16(&(tagField[2])) : readFromByteUInt32(&(tagField[4]));
+
+    // Проверка на совпадение размеров (expectedSize < 0 - количество значений заранее не известно)
+    if ((expectedSize >= 0 && byteSize / byteInElem != (uint64_t)expectedSize) || byteSize % byteInElem != 0)
+    {
+        setError(error, "Expected and real data sizes don't match");
+        return NULL;
+    }
+
+    *length = isSmallData ? 8 : 8 + (byteSize + 7) / 8 * 8;
+
+    if (!isSmallData && startIndex + 8 + byteSize > eInfo->zipSize)
+    {
+        setError(error, "Unexpected end of element data");
+        return NULL;
+    }
+
+    return &(tagField[isSmallData ? 4 : 8]);
+}
+
+/**
+ * Декодирование последовательности чисел из mat файла сразу в тип назначения
+ *
+ * Входные параметры:
+ *  destination: void*            - выходной массив типа int, int64_t или double
+ *  target: EDecodeTarget         - тип выходного массива
+ *  byteSeq: const unsigned char* - данные подэлемента (без тега)
+ *  dataTypeCode: int             - код типа данных matlab (miINT8 ... miUINT64, miDOUBLE)
+ *  size: size_t                  - количество элементов
+ */
+void handleSequence(void *destination, enum EDecodeTarget target, const unsigned char *byteSeq, int dataTypeCode, size_t size)
+{
+    selectDecodeKernel(dataTypeCode, target)(destination, byteSeq, size);
+}
+
+/**
+ * Тип, в который нужно декодировать данные, чтобы не было промежуточных копий
+ */
+enum EDecodeTarget selectDecodeTarget(enum EDataTypes target, int isComplex, int dataTypeCode)
+{
+    // single результат не проходит через double, в какой бы тип ни были записаны данные
+    if (isFloatTarget(target))
+        return DECODE_FLOAT;
+
+    if (isComplex || dataTypeCode == 9 || dataTypeCode == 7)
+        return DECODE_DOUBLE;
+
+    switch (target)
+    {
+    case DT_DOUBLE:
+    case DT_VECTOR:
+    case DT_MATRIX:
+    case DT_ARRAY:
+        return DECODE_DOUBLE;
+    case DT_INT:
+    case DT_VECTOR_INT:
+    case DT_MATRIX_INT:
+        return DECODE_INT;
+    default:
+        return DECODE_INT_64;
+    }
+}
+
+/**
+ * Является ли код типа данных числовым типом, который умеет декодировать библиотека
+ */
+int isNumericDataCode(int dataTypeCode)
+{
+    return (dataTypeCode >= 1 && dataTypeCode <= 7) || dataTypeCode == 9 || dataTypeCode == 12 || dataTypeCode == 13;
+}
+
+// Скалярные декодеры для каждой пары (тип в mat файле, тип назначения), векторизуются компилятором
+#define DECODE_KERNEL(name, sourceType, destinationType)                                                                          \
+    void name(void *destination, const unsigned char *byteSeq, size_t size)                                                       \
+    {                                                                                                                             \
+        const sourceType *source = (const sourceType *)byteSeq;                                                                   \
+        destinationType *result = (destinationType *)destination;                                                                 \
+                                                                                                                                  \
+        for (size_t k = 0; k < size; k++)                                                                                         \
+            result[k] = (destinationType)source[k];                                                                               \
+    }
+
+#define DECODE_KERNELS(suffix, sourceType)                                                                                        \
+    DECODE_KERNEL(decode##suffix##ToInt, sourceType, int)                                                                         \
+    DECODE_KERNEL(decode##suffix##ToInt64, sourceType, int64_t)                                                                   \
+    DECODE_KERNEL(decode##suffix##ToDouble, sourceType, double)                                                                   \
+    DECODE_KERNEL(decode##suffix##ToFloat, sourceType, float)
+
+DECODE_KERNELS(Int8, int8_t)
+DECODE_KERNELS(UInt8, uint8_t)
+DECODE_KERNELS(Int16, int16_t)
+DECODE_KERNELS(UInt16, uint16_t)
+DECODE_KERNELS(Int32, int32_t)
+DECODE_KERNELS(UInt32, uint32_t)
+DECODE_KERNELS(Int64, int64_t)
+DECODE_KERNELS(UInt64, uint64_t)
+DECODE_KERNELS(Single, float)
+DECODE_KERNELS(Double, double)
+
+#define DECODE_KERNELS_ROW(suffix) {decode##suffix##ToInt, decode##suffix##ToInt64, decode##suffix##ToDouble, decode##suffix##ToFloat}
+
+// Индекс - код типа данных matlab, второй индекс - EDecodeTarget
+static const DecodeKernel scalarDecodeKernels[14][4] = {
+    [1] = DECODE_KERNELS_ROW(Int8),   [2] = DECODE_KERNELS_ROW(UInt8),  [3] = DECODE_KERNELS_ROW(Int16),  [4] = DECODE_KERNELS_ROW(UInt16),
+    [5] = DECODE_KERNELS_ROW(Int32),  [6] = DECODE_KERNELS_ROW(UInt32), [7] = DECODE_KERNELS_ROW(Single), [9] = DECODE_KERNELS_ROW(Double),
+    [12] = DECODE_KERNELS_ROW(Int64), [13] = DECODE_KERNELS_ROW(UInt64)};
+
+#ifdef I_MAT_X86_DISPATCH
+// SSE2 декодеры 8 и 16 битных целых: 16 байт расширяются до int32 через unpack (знаковые - сдвигом с сохранением знака),
+// хвост обрабатывается скалярным декодером
+#define SSE2_WIDEN_KERNEL(name, byteInElem, widen, destinationType, store, scalarKernel)                                         \
+    void name(void *destination, const unsigned char *byteSeq, size_t size)                                                       \
+    {                                                                                                                             \
+        destinationType *result = (destinationType *)destination;                                                                 \
+        size_t step = 16 / byteInElem;                                                                                            \
+        size_t k = 0;                                                                                                             \
+                                                                                                                                  \
+        for (; k + step <= size; k += step)                                                                                       \
+        {                                                                                                                         \
+            __m128i v[4];                                                                                                         \
+            widen(&byteSeq[k * byteInElem], v);                                                                                   \
+                                                                                                                                  \
+            for (size_t b = 0; b < step / 4; b++)                                                                                 \
+                store(&result[k + 4 * b], v[b]);                                                                                  \
+        }                                                                                                                         \
+                                                                                                                                  \
+        scalarKernel(&result[k], &byteSeq[k * byteInElem], size - k);                                                             \
+    }
+
+static inline void storeIntBlock(int *destination, __m128i v)
+{
+    _mm_storeu_si128((__m128i *)destination, v);
+}
+
+static inline void storeDoubleBlock(double *destination, __m128i v)
+{
+    _mm_storeu_pd(destination, _mm_cvtepi32_pd(v));
+    _mm_storeu_pd(destination + 2, _mm_cvtepi32_pd(_mm_unpackhi_epi64(v, v)));
+}
+
+static inline void storeFloatBlock(float *destination, __m128i v)
+{
+    _mm_storeu_ps(destination, _mm_cvtepi32_ps(v));
+}
+
+static inline void widenUInt8Sse2(const unsigned char *byteSeq, __m128i *v)
+{
+    __m128i zero = _mm_setzero_si128();
+    __m128i x = _mm_loadu_si128((const __m128i *)byteSeq);
+    __m128i low = _mm_unpacklo_epi8(x, zero);
+    __m128i high = _mm_unpackhi_epi8(x, zero);
+
+    v[0] = _mm_unpacklo_epi16(low, zero);
+    v[1] = _mm_unpackhi_epi16(low, zero);
+    v[2] = _mm_unpacklo_epi16(high, zero);
+    v[3] = _mm_unpackhi_epi16(high, zero);
+}
+
+static inline void widenInt8Sse2(const unsigned char *byteSeq, __m128i *v)
+{
+    __m128i x = _mm_loadu_si128((const __m128i *)byteSeq);
+    __m128i low = _mm_srai_epi16(_mm_unpacklo_epi8(x, x), 8);
+    __m128i high = _mm_srai_epi16(_mm_unpackhi_epi8(x, x), 8);
+
+    v[0] = _mm_srai_epi32(_mm_unpacklo_epi16(low, low), 16);
+    v[1] = _mm_srai_epi32(_mm_unpackhi_epi16(low, low), 16);
+    v[2] = _mm_srai_epi32(_mm_unpacklo_epi16(high, high), 16);
+    v[3] = _mm_srai_epi32(_mm_unpackhi_epi16(high, high), 16);
+}
+
+static inline void widenUInt16Sse2(const unsigned char *byteSeq, __m128i *v)
+{
+    __m128i zero = _mm_setzero_si128();
+    __m128i x = _mm_loadu_si128((const __m128i *)byteSeq);
+
+    v[0] = _mm_unpacklo_epi16(x, zero);
+    v[1] = _mm_unpackhi_epi16(x, zero);
+}
+
+static inline void widenInt16Sse2(const unsigned char *byteSeq, __m128i *v)
+{
+    __m128i x = _mm_loadu_si128((const __m128i *)byteSeq);
+
+    v[0] = _mm_srai_epi32(_mm_unpacklo_epi16(x, x), 16);
+    v[1] = _mm_srai_epi32(_mm_unpackhi_epi16(x, x), 16);
+}
+
+SSE2_WIDEN_KERNEL(decodeUInt8ToIntSse2, 1, widenUInt8Sse2, int, storeIntBlock, decodeUInt8ToInt)
+SSE2_WIDEN_KERNEL(decodeUInt8ToDoubleSse2, 1, widenUInt8Sse2, double, storeDoubleBlock, decodeUInt8ToDouble)
+SSE2_WIDEN_KERNEL(decodeInt8ToIntSse2, 1, widenInt8Sse2, int, storeIntBlock, decodeInt8ToInt)
+SSE2_WIDEN_KERNEL(decodeInt8ToDoubleSse2, 1, widenInt8Sse2, double, storeDoubleBlock, decodeInt8ToDouble)
+SSE2_WIDEN_KERNEL(decodeUInt16ToIntSse2, 2, widenUInt16Sse2, int, storeIntBlock, decodeUInt16ToInt)
+SSE2_WIDEN_KERNEL(decodeUInt16ToDoubleSse2, 2, widenUInt16Sse2, double, storeDoubleBlock, decodeUInt16ToDouble)
+SSE2_WIDEN_KERNEL(decodeInt16ToIntSse2, 2, widenInt16Sse2, int, storeIntBlock, decodeInt16ToInt)
+SSE2_WIDEN_KERNEL(decodeInt16ToDoubleSse2, 2, widenInt16Sse2, double, storeDoubleBlock, decodeInt16ToDouble)
+SSE2_WIDEN_KERNEL(decodeUInt8ToFloatSse2, 1, widenUInt8Sse2, float, storeFloatBlock, decodeUInt8ToFloat)
+SSE2_WIDEN_KERNEL(decodeInt8ToFloatSse2, 1, widenInt8Sse2, float, storeFloatBlock, decodeInt8ToFloat)
+SSE2_WIDEN_KERNEL(decodeUInt16ToFloatSse2, 2, widenUInt16Sse2, float, storeFloatBlock, decodeUInt16ToFloat)
+SSE2_WIDEN_KERNEL(decodeInt16ToFloatSse2, 2, widenInt16Sse2, float, storeFloatBlock, decodeInt16ToFloat)
+
+// Приведение single <-> double: по 4 значения через cvtps2pd / cvtpd2ps
+void decodeSingleToDoubleSse2(void *destination, const unsigned char *byteSeq, size_t size)
+{
+    double *result = (double *)destination;
+    size_t k = 0;
+
+    for (; k + 4 <= size; k += 4)
+    {
+        __m128 v = _mm_loadu_ps((const float *)&byteSeq[k * 4]);
+
+        _mm_storeu_pd(&result[k], _mm_cvtps_pd(v));
+        _mm_storeu_pd(&result[k + 2], _mm_cvtps_pd(_mm_movehl_ps(v, v)));
+    }
+
+    decodeSingleToDouble(&result[k], &byteSeq[k * 4], size - k);
+}
+
+void decodeDoubleToFloatSse2(void *destination, const unsigned char *byteSeq, size_t size)
+{
+    float *result = (float *)destination;
+    size_t k = 0;
+
+    for (; k + 4 <= size; k += 4)
+    {
+        __m128 low = _mm_cvtpd_ps(_mm_loadu_pd((const double *)&byteSeq[k * 8]));
+        __m128 high = _mm_cvtpd_ps(_mm_loadu_pd((const double *)&byteSeq[(k + 2) * 8]));
+
+        _mm_storeu_ps(&result[k], _mm_movelh_ps(low, high));
+    }
+
+    decodeDoubleToFloat(&result[k], &byteSeq[k * 8], size - k);
+}
+
+static const DecodeKernel sse2DecodeKernels[14][4] = {
+    [1] = {decodeInt8ToIntSse2, NULL, decodeInt8ToDoubleSse2, decodeInt8ToFloatSse2},
+    [2] = {decodeUInt8ToIntSse2, NULL, decodeUInt8ToDoubleSse2, decodeUInt8ToFloatSse2},
+    [3] = {decodeInt16ToIntSse2, NULL, decodeInt16ToDoubleSse2, decodeInt16ToFloatSse2},
+    [4] = {decodeUInt16ToIntSse2, NULL, decodeUInt16ToDoubleSse2, decodeUInt16ToFloatSse2},
+    [7] = {NULL, NULL, decodeSingleToDoubleSse2, NULL},
+    [9] = {NULL, NULL, NULL, decodeDoubleToFloatSse2},
+};
+
+// AVX2 декодеры: 8 элементов за раз расширяются до int32 через vpmovsx/vpmovzx
+#define AVX2_WIDEN_KERNELS(sourceSuffix, byteInElem, load, widen)                                                                 \
+    __attribute__((target("avx2"))) void decode##sourceSuffix##ToIntAvx2(void *destination, const unsigned char *byteSeq,         \
+                                                                         size_t size)                                             \
+    {                                                                                                                             \
+        int *result = (int *)destination;                                                                                         \
+        size_t k = 0;                                                                                                             \
+                                                                                                                                  \
+        for (; k + 8 <= size; k += 8)                                                                                             \
+            _mm256_storeu_si256((__m256i *)&result[k], widen(load((const __m128i *)&byteSeq[k * byteInElem])));                  \
+                                                                                                                                  \
+        decode##sourceSuffix##ToInt(&result[k], &byteSeq[k * byteInElem], size - k);                                              \
+    }                                                                                                                             \
+                                                                                                                                  \
+    __attribute__((target("avx2"))) void decode##sourceSuffix##ToDoubleAvx2(void *destination, const unsigned char *byteSeq,      \
+                                                                            size_t size)                                          \
+    {                                                                                                                             \
+        double *result = (double *)destination;                                                                                   \
+        size_t k = 0;                                                                                                             \
+                                                                                                                                  \
+        for (; k + 8 <= size; k += 8)                                                                                             \
+        {                                                                                                                         \
+            __m256i v = widen(load((const __m128i *)&byteSeq[k * byteInElem]));                                                  \
+            _mm256_storeu_pd(&result[k], _mm256_cvtepi32_pd(_mm256_castsi256_si128(v)));                                         \
+            _mm256_storeu_pd(&result[k + 4], _mm256_cvtepi32_pd(_mm256_extracti128_si256(v, 1)));                                 \
+        }                                                                                                                         \
+                                                                                                                                  \
+        decode##sourceSuffix##ToDouble(&result[k], &byteSeq[k * byteInElem], size - k);                                           \
+    }                                                                                                                             \
+                                                                                                                                  \
+    __attribute__((target("avx2"))) void decode##sourceSuffix##ToFloatAvx2(void *destination, const unsigned char *byteSeq,       \
+                                                                           size_t size)                                           \
+    {                                                                                                                             \
+        float *result = (float *)destination;                                                                                     \
+        size_t k = 0;                                                                                                             \
+                                                                                                                                  \
+        for (; k + 8 <= size; k += 8)                                                                                             \
+            _mm256_storeu_ps(&result[k], _mm256_cvtepi32_ps(widen(load((const __m128i *)&byteSeq[k * byteInElem]))));            \
+                                                                                                                                  \
+        decode##sourceSuffix##ToFloat(&result[k], &byteSeq[k * byteInElem], size - k);                                            \
+    }
+
+AVX2_WIDEN_KERNELS(UInt8, 1, _mm_loadl_epi64, _mm256_cvtepu8_epi32)
+AVX2_WIDEN_KERNELS(Int8, 1, _mm_loadl_epi64, _mm256_cvtepi8_epi32)
+AVX2_WIDEN_KERNELS(UInt16, 2, _mm_loadu_si128, _mm256_cvtepu16_epi32)
+AVX2_WIDEN_KERNELS(Int16, 2, _mm_loadu_si128, _mm256_cvtepi16_epi32)
+
+__attribute__((target("avx2"))) void decodeInt32ToDoubleAvx2(void *destination, const unsigned char *byteSeq, size_t size)
+{
+    double *result = (double *)destination;
+    size_t k = 0;
+
+    for (; k + 4 <= size; k += 4)
+        _mm256_storeu_pd(&result[k], _mm256_cvtepi32_pd(_mm_loadu_si128((const __m128i *)&byteSeq[k * 4])));
+
+    decodeInt32ToDouble(&result[k], &byteSeq[k * 4], size - k);
+}
+
+__attribute__((target("avx2"))) void decodeInt32ToFloatAvx2(void *destination, const unsigned char *byteSeq, size_t size)
+{
+    float *result = (float *)destination;
+    size_t k = 0;
+
+    for (; k + 8 <= size; k += 8)
+        _mm256_storeu_ps(&result[k], _mm256_cvtepi32_ps(_mm256_loadu_si256((const __m256i *)&byteSeq[k * 4])));
+
+    decodeInt32ToFloat(&result[k], &byteSeq[k * 4], size - k);
+}
+
+__attribute__((target("avx2"))) void decodeSingleToDoubleAvx2(void *destination, const unsigned char *byteSeq, size_t size)
+{
+    double *result = (double *)destination;
+    size_t k = 0;
+
+    for (; k + 4 <= size; k += 4)
+        _mm256_storeu_pd(&result[k], _mm256_cvtps_pd(_mm_loadu_ps((const float *)&byteSeq[k * 4])));
+
+    decodeSingleToDouble(&result[k], &byteSeq[k * 4], size - k);
+}
+
+__attribute__((target("avx2"))) void decodeDoubleToFloatAvx2(void *destination, const unsigned char *byteSeq, size_t size)
+{
+    float *result = (float *)destination;
+    size_t k = 0;
+
+    for (; k + 4 <= size; k += 4)
+        _mm_storeu_ps(&result[k], _mm256_cvtpd_ps(_mm256_loadu_pd((const double *)&byteSeq[k * 8])));
+
+    decodeDoubleToFloat(&result[k], &byteSeq[k * 8], size - k);
+}
+
+static const DecodeKernel avx2DecodeKernels[14][4] = {
+    [1] = {decodeInt8ToIntAvx2, NULL, decodeInt8ToDoubleAvx2, decodeInt8ToFloatAvx2},
+    [2] = {decodeUInt8ToIntAvx2, NULL, decodeUInt8ToDoubleAvx2, decodeUInt8ToFloatAvx2},
+    [3] = {decodeInt16ToIntAvx2, NULL, decodeInt16ToDoubleAvx2, decodeInt16ToFloatAvx2},
+    [4] = {decodeUInt16ToIntAvx2, NULL, decodeUInt16ToDoubleAvx2, decodeUInt16ToFloatAvx2},
+    [5] = {NULL, NULL, decodeInt32ToDoubleAvx2, decodeInt32ToFloatAvx2},
+    [7] = {NULL, NULL, decodeSingleToDoubleAvx2, NULL},
+    [9] = {NULL, NULL, NULL, decodeDoubleToFloatAvx2},
+};
+#endif
+
+/**
+ * Выбор декодера для пары (тип в mat файле, тип назначения) по возможностям процессора
+ */
+DecodeKernel selectDecodeKernel(int dataTypeCode, enum EDecodeTarget target)
+{
+#ifdef I_MAT_X86_DISPATCH
+    if (__builtin_cpu_supports("avx2") && avx2DecodeKernels[dataTypeCode][target] != NULL)
+        return avx2DecodeKernels[dataTypeCode][target];
+
+    if (sse2DecodeKernels[dataTypeCode][target] != NULL)
+        return sse2DecodeKernels[dataTypeCode][target];
+#endif
+
+    return scalarDecodeKernels[dataTypeCode][target];
+}
+
+/**
+ * Разархивировать сжатые данные
+ */
+void uncompressElement(IMatError *error, ElmementInfo *eInfo, const unsigned char *compressedData, size_t compressedSize)
+{
+    uint64_t statsStart = STATS_START();
+
+    int result = decompressData(compressedData, compressedSize, &eInfo->zipData, &eInfo->zipSize, 1);
+
+    STATS_ADD(inflateNs, statsStart);
+    STATS_COUNT(uncompressedBytes, eInfo->zipSize);
+
+    if (result != Z_OK)
+    {
+        setError(error, "Failed to uncompress element, err: %d", result);
+        return;
+    }
+}
+
+/**
+ * Разархивировать сжатый miMATRIX элемент в буфер точного размера
+ *
+ * Сначала разжимаются первые 8 байт - тег miMATRIX, в котором записан размер элемента,
+ * затем выделяется один буфер под весь элемент и остаток разжимается прямо в него
+ *
+ * Входные параметры:
+ *  compressed_data: const unsigned char* - сжатые данные
+ *  compressed_size: size_t               - размер сжатых данных
+ *  uncompressed_data: unsigned char**    - указатель на выходной буфер (выделяется функцией)
+ *  uncompressed_size: size_t*            - указатель на размер разжатых данных
+ *
+ * Возвращаемое значение:
+ * ret: int - 0 - успех,не 0 - ошибка
+ */
+int decompressData(const unsigned char *compressed_data, size_t compressed_size, unsigned char **uncompressed_data, size_t *uncompressed_size,
+                   int isScratch)
+{
+    // Очищаем выходный буфер
+    *uncompressed_size = 0;
+    *uncompressed_data = NULL;
+
+#ifdef I_MAT_USE_LIBDEFLATE
+    // При ошибке libdeflate поток разбирается заново через zlib, чтобы вернуть код ошибки zlib
+    if (inflateBackend == IB_LIBDEFLATE &&
+        decompressDataLibdeflate(compressed_data, compressed_size, uncompressed_data, uncompressed_size, isScratch) == Z_OK)
+        return Z_OK;
+#endif
+
+    int ret;
+    unsigned char tagField[8];
+    z_stream localStream;
+
+    // Initialize zlib stream
+    z_stream *strm = acquireInflateStream(&localStream);
+    if (strm == NULL)
+        return Z_MEM_ERROR;
+
+    // Сжатые данные подаются окнами, в pendingInput - то, что еще не попало в avail_in
+    size_t pendingInput = compressed_size;
+
+    strm->avail_in = 0;
+    strm->next_in = (unsigned char *)compressed_data;
+
+    // Разжимаем тег элемента
+    ret = inflateWindows(strm, tagField, 8, &pendingInput);
+
+    if (ret != Z_OK)
+    {
+        releaseInflateStream(strm);
+        return ret;
+    }
+
+    size_t elementSize = readFromByteUInt32(&(tagField[4]));
+    if (elementSize > SIZE_MAX - 8)
+    {
+        releaseInflateStream(strm);
+        return Z_MEM_ERROR;
+    }
+
+    // Буфер контекста чтения (setMatReader) переиспользуется, если результат не нужен вызывающему надолго
+    unsigned char *out = (unsigned char *)(isScratch ? allocateScratch(SCRATCH_INFLATE, 8 + elementSize) : malloc(8 + elementSize));
+    if (out == NULL)
+    {
+        releaseInflateStream(strm);
+        return Z_MEM_ERROR;
+    }
+
+    memcpy(out, tagField, 8);
+
+    // Разжимаем остаток элемента сразу на свое место
+    ret = elementSize ? inflateWindows(strm, out + 8, elementSize, &pendingInput) : Z_OK;
+
+    // Clean up
+    releaseInflateStream(strm);
+
+    if (ret != Z_OK)
+    {
+        releaseScratch(out);
+        return ret;
+    }
+
+    *uncompressed_data = out;
+    *uncompressed_size = 8 + elementSize;
+
+    return Z_OK;
+}
+
+/**
+ * Разжать size байт в destination, подавая zlib вход и выход окнами не больше I_MAT_INFLATE_WINDOW байт
+ *
+ * Входные параметры:
+ *  strm: z_stream*       - поток, next_in которого указывает на еще не разжатые данные
+ *  pendingInput: size_t* - сколько сжатых байт после текущего окна (strm->avail_in) еще не подано в поток
+ *
+ * Возвращаемое значение:
+ * ret: int - Z_OK при успехе, Z_DATA_ERROR если поток закончился раньше, иначе код ошибки zlib
+ */
+int inflateWindows(z_stream *strm, unsigned char *destination, size_t size, size_t *pendingInput)
+{
+    size_t produced = 0;
+
+    while (produced < size)
+    {
+        // next_in уже стоит на месте, достаточно открыть следующее окно
+        if (strm->avail_in == 0 && *pendingInput > 0)
+        {
+            strm->avail_in = *pendingInput < I_MAT_INFLATE_WINDOW ? (uint32_t)*pendingInput : I_MAT_INFLATE_WINDOW;
+            *pendingInput -= strm->avail_in;
+        }
+
+        uint32_t window = size - produced < I_MAT_INFLATE_WINDOW ? (uint32_t)(size - produced) : I_MAT_INFLATE_WINDOW;
+
+        strm->next_out = destination + produced;
+        strm->avail_out = window;
+
+        int ret = inflate(strm, Z_SYNC_FLUSH);
+        produced += window - strm->avail_out;
+
+        if (ret == Z_STREAM_END || (ret == Z_BUF_ERROR && strm->avail_in == 0 && *pendingInput == 0))
+            return produced < size ? Z_DATA_ERROR : Z_OK;
+        if (ret != Z_OK && ret != Z_BUF_ERROR)
+            return ret;
+    }
+
+    return Z_OK;
+}
+
+#ifdef I_MAT_USE_LIBDEFLATE
+/**
+ * Разархивировать сжатый miMATRIX элемент через libdeflate
+ *
+ * Размер элемента берется из разжатого через zlib тега, после чего весь поток разжимается
+ * за один вызов libdeflate_zlib_decompress в буфер точного размера
+ *
+ * Возвращаемое значение:
+ * ret: int - Z_OK при успехе, иначе код ошибки zlib
+ */
+int decompressDataLibdeflate(const unsigned char *compressedData, size_t compressedSize, unsigned char **uncompressedData, size_t *uncompressedSize,
+                              int isScratch)
+{
+    unsigned char tagField[8];
+
+    if (decompressPrefix(compressedData, compressedSize, tagField, 8) != 8)
+        return Z_DATA_ERROR;
+
+    // libdeflate принимает длины в size_t, окна нужны только zlib
+    size_t elementSize = readFromByteUInt32(&(tagField[4]));
+    if (elementSize > SIZE_MAX - 8)
+        return Z_MEM_ERROR;
+
+    // Декомпрессор контекста чтения создается один раз
+    IMatReader *reader = threadReader;
+    struct libdeflate_decompressor *decompressor = reader != NULL ? reader->decompressor : NULL;
+
+    if (decompressor == NULL)
+        decompressor = libdeflate_alloc_decompressor();
+    if (decompressor == NULL)
+        return Z_MEM_ERROR;
+    if (reader != NULL)
+        reader->decompressor = decompressor;
+
+    unsigned char *out = (unsigned char *)(isScratch ? allocateScratch(SCRATCH_INFLATE, 8 + elementSize) : malloc(8 + elementSize));
+    if (out == NULL)
+    {
+        if (reader == NULL)
+            libdeflate_free_decompressor(decompressor);
+        return Z_MEM_ERROR;
+    }
+
+    // Без actual_out_nbytes_ret libdeflate требует, чтобы поток разжался ровно в 8 + elementSize байт
+    enum libdeflate_result ret = libdeflate_zlib_decompress(decompressor, compressedData, compressedSize, out, 8 + elementSize, NULL);
+    if (reader == NULL)
+        libdeflate_free_decompressor(decompressor);
+
+    if (ret != LIBDEFLATE_SUCCESS)
+    {
+        releaseScratch(out);
+        return Z_DATA_ERROR;
+    }
+
+    *uncompressedData = out;
+    *uncompressedSize = 8 + elementSize;
+
+    return Z_OK;
+}
+#endif
+
+/**
+ * Разархивировать только начало сжатого элемента
+ *
+ * Входные параметры:
+ *  compressedData: const unsigned char* - начало сжатых данных
+ *  compressedSize: size_t               - сколько сжатых байт доступно
+ *  prefix: unsigned char*               - выходной буфер
+ *  prefixSize: int                      - сколько байт нужно разжать
+ *
+ * Возвращаемое значение:
+ * ret: int - количество разжатых байт или код ошибки zlib (< 0)
+ */
+int decompressPrefix(const unsigned char *compressedData, size_t compressedSize, unsigned char *prefix, int prefixSize)
+{
+    z_stream localStream;
+    z_stream *strm = acquireInflateStream(&localStream);
+
+    if (strm == NULL)
+        return Z_MEM_ERROR;
+
+    // Для начала элемента хватает первого окна сжатых данных
+    strm->avail_in = compressedSize < I_MAT_INFLATE_WINDOW ? (uint32_t)compressedSize : I_MAT_INFLATE_WINDOW;
+    strm->next_in = (unsigned char *)compressedData;
+    strm->avail_out = prefixSize;
+    strm->next_out = prefix;
+
+    int ret = inflate(strm, Z_SYNC_FLUSH);
+
+    int have = prefixSize - strm->avail_out;
+    releaseInflateStream(strm);
+
+    if (ret != Z_OK && ret != Z_STREAM_END && ret != Z_BUF_ERROR)
+        return ret;
+
+    return have;
+}
+
+/**
+ * Выделение miMATRIX элемента с записанным заголовком и тегами данных
+ *
+ * Используется при записи mat файлов и при сборке элемента из датасета v7.3 файла.
+ * Данные частей заполняет вызывающая функция, выравнивание до 8 байт заполнено нулями.
+ *
+ * Входные данные:
+ *  name: const char*  - имя переменной (до 63 символов)
+ *  matClass: int      - класс массива matlab (MX_DOUBLE_CLASS и т.д.)
+ *  arrayFlags: int    - флаги массива (ARRAY_FLAG_COMPLEX, ARRAY_FLAG_LOGICAL)
+ *  sizeI, sizeJ: int  - размеры
+ *  dataTypeCode: int  - код типа данных matlab
+ *  typeSize: int      - размер одного значения в байтах
+ *
+ * Возвращаемый параметр:
+ *  element: unsigned char* - элемент вместе с тегом (NULL при ошибке)
+ *  realData, imagData      - начало данных действительной и мнимой (NULL для некомплексных) частей
+ *  elementLength: size_t*  - длина элемента с тегом
+ */
+unsigned char *allocateMatrixElement(const char *name, int matClass, int arrayFlags, int sizeI, int sizeJ, int dataTypeCode, int typeSize,
+                                     unsigned char **realData, unsigned char **imagData, size_t *elementLength, IMatError *error)
 {
-    gsl_matrix_complex *result;
-    cleanError(error);
+    int nameLength = (int)strlen(name);
+    if (nameLength == 0 || nameLength >= 64)
+    {
+        setError(error, "Unexpected length of variable name: %d", nameLength);
+        return NULL;
+    }
 
-    ElmementInfo eInfo;
+    int isComplex = arrayFlags & ARRAY_FLAG_COMPLEX ? 1 : 0;
+    size_t dataByteSize = (size_t)sizeI * sizeJ * typeSize;
+    size_t partLength = 8 + (dataByteSize + 7) / 8 * 8;
+    size_t length = 48 + (nameLength + 7) / 8 * 8 + partLength * (isComplex ? 2 : 1);
 
-    openMatEngine(filePath, &eInfo, error);
-    if (error->isErr)
-        return result;
+    // Длина элемента без тега записывается в 32-битное поле
+    if (length - 8 > UINT32_MAX)
+    {
+        setError(error, "Variable %s is too large", name);
+        return NULL;
+    }
 
-    if (eInfo.type != DT_MATRIX_COMPLEX && eInfo.type != DT_VECTOR_COMPLEX && eInfo.type != DT_COMPLEX && eInfo.type != DT_EMPTY)
+    unsigned char *element = (unsigned char *)calloc(length, 1);
+    if (element == NULL)
     {
-        setError(error, "Got error while reading %s. Expected %s, but readed %s", eInfo.name, getDataTypeName(DT_MATRIX_COMPLEX),
-                 getDataTypeName(eInfo.type));
-        return result;
+        setError(error, "Not enough memory for variable %s", name);
+        return NULL;
     }
 
-    result = gsl_matrix_complex_alloc(eInfo.sizeI, eInfo.sizeJ);
-    int elemsNumber = eInfo.sizeI * eInfo.sizeJ;
+    int headerLength =
+        buildMatrixElementHeader(element, name, matClass, arrayFlags, sizeI, sizeJ, dataTypeCode, (uint32_t)dataByteSize, (uint32_t)(length - 8));
+
+    *elementLength = length;
+    *realData = &element[headerLength];
+    *imagData = NULL;
 
-    for (int i = 0; i < eInfo.sizeI; i++)
+    // Тег мнимой части идет после выровненной действительной части
+    if (isComplex)
     {
-        for (int j = 0; j < eInfo.sizeJ; j++)
-        {
-            gsl_matrix_complex_set(result, i, j,
-                                   eInfo.dataDouble[i + eInfo.sizeI * j] + I * eInfo.dataDouble[elemsNumber + i + eInfo.sizeI * j]);
-        }
+        unsigned char *imagTag = &element[headerLength - 8 + partLength];
+        uint32_t byteSize = (uint32_t)dataByteSize;
+
+        memcpy(imagTag, &dataTypeCode, 4);
+        memcpy(&imagTag[4], &byteSize, 4);
+        *imagData = &imagTag[8];
     }
 
-    if (eInfo.type != DT_EMPTY)
-        free(eInfo.dataDouble);
-    return result;
+    return element;
+}
+
+/**
+ * Запись заголовка miMATRIX элемента: тег, флаги, размеры, имя и тег действительной части
+ *
+ * Входные данные:
+ *  element: unsigned char* - выходной буфер (не меньше 128 байт)
+ *  dataByteSize: uint32_t  - размер данных действительной части в байтах
+ *  elementSize: uint32_t   - размер элемента без тега
+ *
+ * Возвращаемый параметр: длина заголовка вместе с тегом действительной части
+ */
+int buildMatrixElementHeader(unsigned char *element, const char *name, int matClass, int arrayFlags, int sizeI, int sizeJ, int dataTypeCode,
+                             uint32_t dataByteSize, uint32_t elementSize)
+{
+    int nameLength = (int)strlen(name);
+    int dataStartIndex = 48 + (nameLength + 7) / 8 * 8;
+    int value;
+
+    memset(element, 0, dataStartIndex + 8);
+
+    value = MI_MATRIX;
+    memcpy(element, &value, 4);
+    memcpy(&element[4], &elementSize, 4);
+
+    // Флаги массива (miUINT32): класс в первом байте, флаги во втором
+    value = 6;
+    memcpy(&element[8], &value, 4);
+    value = 8;
+    memcpy(&element[12], &value, 4);
+    element[16] = (unsigned char)matClass;
+    element[17] = (unsigned char)arrayFlags;
+
+    // Размеры (miINT32)
+    value = 5;
+    memcpy(&element[24], &value, 4);
+    value = 8;
+    memcpy(&element[28], &value, 4);
+    memcpy(&element[32], &sizeI, 4);
+    memcpy(&element[36], &sizeJ, 4);
+
+    // Имя (miINT8) в обычной, не сжатой форме
+    value = 1;
+    memcpy(&element[40], &value, 4);
+    memcpy(&element[44], &nameLength, 4);
+    memcpy(&element[48], name, nameLength);
+
+    memcpy(&element[dataStartIndex], &dataTypeCode, 4);
+    memcpy(&element[dataStartIndex + 4], &dataByteSize, 4);
+
+    return dataStartIndex + 8;
 }
 
-void openMatEngine(char *filePath, ElmementInfo *eInfo, IMatError *error)
+/**
+ * Запись mat файла с одним элементом
+ *
+ * Элемент (собранный allocateMatrixElement) освобождается. Если файл не удалось записать полностью, он удаляется
+ *
+ * Входные данные:
+ *  filePath: char*         - путь к mat файлу
+ *  element: unsigned char* - элемент вместе с тегом
+ *  elementLength: size_t   - длина элемента с тегом
+ *  level: int              - уровень сжатия zlib, I_MAT_COMPRESSION_NONE - записать элемент без сжатия
+ */
+void saveMatEngine(char *filePath, unsigned char *element, size_t elementLength, int level, IMatError *error)
 {
-    FILE *file = fopen(filePath, "rb");
-    if (file == NULL)
+    if (level < I_MAT_COMPRESSION_DEFAULT || level > 9)
     {
-        char errString[264];
-        sprintf(errString, "Unable to open file: %s", filePath);
-        setError(error, errString);
+        setError(error, "Unexpected compression level: %d", level);
+        free(element);
         return;
     }
 
-    handleMatHeader(file, error);
-    if (error->isErr)
+    FILE *file = fopen(filePath, "wb");
+    if (file == NULL)
     {
-        fclose(file);
+        setError(error, "Unable to create file: %s", filePath);
+        free(element);
         return;
     }
 
-    handleElement(file, error, eInfo);
+    int isWritten = writeMatHeader(file);
 
-    fclose(file);
-    return;
-}
+    if (isWritten && level == I_MAT_COMPRESSION_NONE)
+        isWritten = fwrite(element, elementLength, 1, file) == 1;
+    else if (isWritten)
+        isWritten = writeCompressedElement(file, element, elementLength, level, error);
 
-/**
- * Очищает ошибку
- */
-void cleanError(IMatError *error)
-{
-    error->isErr = 0;
-    sprintf(error->stringErr, "");
+    free(element);
+
+    if (fclose(file) != 0)
+        isWritten = 0;
+
+    if (!isWritten)
+    {
+        if (!error->isErr)
+            setError(error, "Unable to write file: %s", filePath);
+        remove(filePath);
+    }
 }
 
 /**
- * Задает ошибке переданную строку
+ * Запись 128-байтового заголовка mat файла версии 5
  *
- * @param error ошибка, которую нужно установить
- * @param format форматированная строка с описанием ошибки
- * @param ... список аргументов для форматированной строки
+ * Возвращаемый параметр: 1, если заголовок записан
  */
-void setError(IMatError *error, const char *format, ...)
+int writeMatHeader(FILE *file)
 {
-    va_list args;
+    unsigned char header[128];
+    char description[117];
+    char date[64];
+    time_t now = time(NULL);
 
-    va_start(args, format);
-    vsprintf(error->stringErr, format, args);
-    va_end(args);
+    strftime(date, sizeof(date), "%a %b %d %H:%M:%S %Y", localtime(&now));
+    snprintf(description, sizeof(description), "MATLAB 5.0 MAT-file, Platform: i_mat, Created on: %s", date);
 
-    error->isErr = 1;
+    // Текст дополняется пробелами, смещение подсистемы не используется
+    memset(header, ' ', 116);
+    memcpy(header, description, strlen(description));
+    memset(&header[116], 0, 8);
+
+    int version = MAT_VERSION_5;
+    memcpy(&header[124], &version, 2);
+    header[126] = 'I';
+    header[127] = 'M';
+
+    return fwrite(header, 128, 1, file) == 1;
 }
 
 /**
- * Проверяем header mat-файла
+ * Сжатие элемента в один zlib поток и запись его как miCOMPRESSED элемента
+ *
+ * Элемент делится на блоки по I_MAT_DEFLATE_BLOCK_SIZE байт, которые сжимаются независимо в пуле потоков
+ * (raw deflate). Все блоки, кроме последнего, завершаются Z_FULL_FLUSH, поэтому их конкатенация - корректный
+ * deflate поток. Контрольная сумма потока собирается из сумм блоков через adler32_combine.
+ *
+ * Возвращаемый параметр: 1, если элемент записан
  */
-void handleMatHeader(FILE *file, IMatError *error)
+int writeCompressedElement(FILE *file, const unsigned char *element, size_t elementLength, int level, IMatError *error)
 {
-    unsigned char *header = (unsigned char *)malloc(128);
+    DeflateJob job;
+
+    job.data = element;
+    job.dataSize = elementLength;
+    job.blockSize = I_MAT_DEFLATE_BLOCK_SIZE;
+    job.blocksNumber = (int)((job.dataSize + job.blockSize - 1) / job.blockSize);
+    job.level = level;
+    job.blocks = (unsigned char **)calloc(job.blocksNumber, sizeof(unsigned char *));
+    job.blockLengths = (size_t *)calloc(job.blocksNumber, sizeof(size_t));
+    job.checksums = (uint32_t *)calloc(job.blocksNumber, sizeof(uint32_t));
+    atomic_init(&job.failed, 0);
+
+    runParallel(deflateBlock, &job, job.blocksNumber, 0);
+
+    // Заголовок zlib: метод deflate с окном 32 KB, уровень в FLEVEL, FCHECK дополняет до кратного 31
+    unsigned char zlibHeader[2] = {0x78, 0};
+    int levelFlag = level == I_MAT_COMPRESSION_DEFAULT || level == 6 ? 2 : (level < 2 ? 0 : (level < 6 ? 1 : 3));
+    zlibHeader[1] = (unsigned char)(levelFlag << 6);
+    zlibHeader[1] += 31 - (zlibHeader[0] * 256 + zlibHeader[1]) % 31;
+
+    size_t compressedSize = 2 + 4;
+    uint32_t checksum = 1;
+
+    for (int i = 0; i < job.blocksNumber; i++)
+    {
+        size_t blockStart = (size_t)i * job.blockSize;
+        size_t blockSize = job.dataSize - blockStart < job.blockSize ? job.dataSize - blockStart : job.blockSize;
 
-    fread(header, 128, 1, file);
+        compressedSize += job.blockLengths[i];
+        checksum = adler32_combine(checksum, job.checksums[i], blockSize);
+    }
 
-    char description[117];
-    strncpy(description, header, 116);
-    description[117] = '\0';
+    int isWritten = 0;
 
-    if (header[126] != 'I')
+    if (atomic_load(&job.failed))
+        setError(error, "Failed to compress element");
+    else if (compressedSize > UINT32_MAX)
+        setError(error, "Compressed element is too large");
+    else
     {
-        setError(error, "Unexpected Byte Order");
-        free(header);
-        return;
+        uint32_t tagField[2] = {MI_COMPRESSED, (uint32_t)compressedSize};
+        unsigned char trailer[4] = {checksum >> 24, checksum >> 16, checksum >> 8, checksum};
+
+        isWritten = fwrite(tagField, 8, 1, file) == 1 && fwrite(zlibHeader, 2, 1, file) == 1;
+        for (int i = 0; i < job.blocksNumber && isWritten; i++)
+            isWritten = fwrite(job.blocks[i], job.blockLengths[i], 1, file) == 1;
+        isWritten = isWritten && fwrite(trailer, 4, 1, file) == 1;
     }
 
-    free(header);
+    for (int i = 0; i < job.blocksNumber; i++)
+        free(job.blocks[i]);
+    free(job.blocks);
+    free(job.blockLengths);
+    free(job.checksums);
+
+    return isWritten;
 }
 
 /**
- * Обработка заголовочного тега элемента
+ * Сжатие одного блока элемента (задача пула потоков)
  */
-void handleElement(FILE *file, IMatError *error, ElmementInfo *eInfo)
+void deflateBlock(void *context, int index)
 {
-    // Читаем мета данные скомпресированных данных и извлекаем их
-    unsigned char *tagField = (unsigned char *)malloc(8);
-    fread(tagField, 8, 1, file);
+    DeflateJob *job = (DeflateJob *)context;
+    size_t blockStart = (size_t)index * job->blockSize;
+    size_t blockSize = job->dataSize - blockStart < job->blockSize ? job->dataSize - blockStart : job->blockSize;
+    int isLast = index == job->blocksNumber - 1;
+    z_stream strm;
+
+    strm.zalloc = Z_NULL;
+    strm.zfree = Z_NULL;
+    strm.opaque = Z_NULL;
 
-    eInfo->sizeI = readFromByteInt32(&(tagField[4]));
-    eInfo->zipData = (unsigned char *)malloc(eInfo->sizeI);
+    // Отрицательный размер окна - raw deflate без заголовка и контрольной суммы zlib
+    if (deflateInit2(&strm, job->level, Z_DEFLATED, -15, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+    {
+        atomic_store(&job->failed, 1);
+        return;
+    }
 
-    fread(eInfo->zipData, eInfo->sizeI, 1, file);
+    // Запас на пустой stored блок, которым завершается Z_FULL_FLUSH
+    size_t bound = deflateBound(&strm, blockSize) + 16;
+    unsigned char *block = (unsigned char *)malloc(bound);
 
-    free(tagField);
+    strm.next_in = (unsigned char *)&(job->data[blockStart]);
+    strm.avail_in = blockSize;
+    strm.next_out = block;
+    strm.avail_out = bound;
 
-    uncompressElement(error, eInfo);
-    if (error->isErr)
-        return;
+    int ret = block != NULL ? deflate(&strm, isLast ? Z_FINISH : Z_FULL_FLUSH) : Z_MEM_ERROR;
 
-    if (eInfo->zipData[0] != 14)
+    if ((isLast && ret != Z_STREAM_END) || (!isLast && (ret != Z_OK || strm.avail_in != 0)))
     {
-        setError(error, "Unexpected format of ungzipted data");
-        return;
+        atomic_store(&job->failed, 1);
+        free(block);
+        block = NULL;
     }
 
-    // Проверка на комплексное значение
-    // TODO добавить определение типа массива
-    unsigned char complexFlagMask = 1 << 3;
-    int isComplex = 0;
-    unsigned char *complexDataPointer;
+    job->blocks[index] = block;
+    job->blockLengths[index] = bound - strm.avail_out;
+    job->checksums[index] = adler32(adler32(0, Z_NULL, 0), &(job->data[blockStart]), blockSize);
 
-    if (complexFlagMask & eInfo->zipData[17])
-        isComplex = 1;
+    deflateEnd(&strm);
+}
 
-    // Получаем размеры элемента
-    // TODO добавить поддержку многомерных массивов
-    if (eInfo->zipData[28] != 8)
+/**
+ * Копирование gsl матрицы (по строкам, шаг tda) в данные элемента в порядке столбцов matlab
+ */
+void gatherDouble(double *destination, const double *source, size_t tda, int sizeI, int sizeJ)
+{
+    // Непрерывная gsl матрица sizeI x sizeJ - это матрица sizeJ x sizeI в порядке столбцов
+    if (tda == (size_t)sizeJ)
     {
-        setError(error, "Multidimensional data");
+        transposeDouble(destination, sizeI, source, sizeJ, sizeI);
         return;
     }
 
-    eInfo->sizeI = readFromByteInt32(&(eInfo->zipData[32]));
-    eInfo->sizeJ = readFromByteInt32(&(eInfo->zipData[36]));
-    int expectedSize = eInfo->sizeI * eInfo->sizeJ;
+    for (int j = 0; j < sizeJ; j++)
+        for (int i = 0; i < sizeI; i++)
+            destination[i + (size_t)sizeI * j] = source[i * tda + j];
+}
 
-    // Если записан пустой элемент
-    if (expectedSize == 0)
+void gatherInt(int *destination, const int *source, size_t tda, int sizeI, int sizeJ)
+{
+    if (tda == (size_t)sizeJ)
     {
-        eInfo->type = DT_EMPTY;
+        transposeInt(destination, sizeI, source, sizeJ, sizeI);
         return;
     }
 
-    // Получаем имя и начало данных
-    int nameLength = eInfo->zipData[42] ? eInfo->zipData[42] : readFromByteInt32(&eInfo->zipData[44]);
-    int dataStartIndex = eInfo->zipData[42] ? 48 : 40 + 8 + ceil(nameLength / 8.0) * 8;
-    memcpy(eInfo->name, &eInfo->zipData[eInfo->zipData[42] ? 44 : 48], nameLength);
-    eInfo->name[nameLength] = '\0';
-
-    int dataTypeCode = eInfo->zipData[dataStartIndex];
-
-    eInfo->type = decideType(eInfo->sizeI, eInfo->sizeJ, isComplex, dataTypeCode);
-    //  Определяем signed или unsigned int
-    int isSigned = (dataTypeCode == 1 || dataTypeCode == 3 || dataTypeCode == 5 || dataTypeCode == 12) ? 1 : 0;
+    for (int j = 0; j < sizeJ; j++)
+        for (int i = 0; i < sizeI; i++)
+            destination[i + (size_t)sizeI * j] = source[i * tda + j];
+}
 
-    // TODO Вынести handle Data в отдельную функцию, результа которой обрабатывать в зависимости от complex
-    // Определяем элемент int или double
-    if (dataTypeCode < 7 || dataTypeCode == 12 || dataTypeCode == 13)
+/**
+ * Копирование комплексной gsl матрицы в действительную и мнимую части элемента
+ */
+void gatherComplex(double *realDestination, double *imagDestination, const double *source, size_t tda, int sizeI, int sizeJ)
+{
+    TRANSPOSE_PARALLEL_FOR
+    for (int j0 = 0; j0 < sizeJ; j0 += TRANSPOSE_BLOCK)
     {
-        // Проверяем smalldata или нет
-        int isSmallData = eInfo->zipData[dataStartIndex + 2];
-
-        int byteInInt = calculateByteSizeFromMatDataCode(dataTypeCode);
-
-        // Меняем тип на int_64 если надо
-        if (byteInInt == 8)
-            eInfo->type = DT_INT_64;
+        int j1 = j0 + TRANSPOSE_BLOCK < sizeJ ? j0 + TRANSPOSE_BLOCK : sizeJ;
 
-        // Проверка на совпадение размеров
-        int realSize = (isSmallData ? readFromByteInt16(&(eInfo->zipData[dataStartIndex + 2]))
-                                    : readFromByteInt32(&(eInfo->zipData[dataStartIndex + 4]))) /
-                       byteInInt;
-
-        if (realSize != expectedSize)
+        for (int i0 = 0; i0 < sizeI; i0 += TRANSPOSE_BLOCK)
         {
-            setError(error, "Expected and real data sizes don't match");
-            return;
+            int i1 = i0 + TRANSPOSE_BLOCK < sizeI ? i0 + TRANSPOSE_BLOCK : sizeI;
+
+            for (int j = j0; j < j1; j++)
+                for (int i = i0; i < i1; i++)
+                {
+                    realDestination[i + (size_t)sizeI * j] = source[2 * (i * tda + j)];
+                    imagDestination[i + (size_t)sizeI * j] = source[2 * (i * tda + j) + 1];
+                }
         }
+    }
+}
 
-        // Создаем буферный массив для дальнейшей проверки является ли это комплексными данными или нет
-        int64_t *destinationArray = (int64_t *)malloc(sizeof(int64_t) * expectedSize);
+/**
+ * Транспонирование double матрицы из порядка matlab (по столбцам) в порядок gsl (по строкам)
+ *
+ * Матрица обходится блоками TRANSPOSE_BLOCK x TRANSPOSE_BLOCK, чтобы и чтение столбцов, и запись строк
+ * оставались в кэше. Внутри блока используются AVX (4x4) или SSE2 (2x2) перестановки.
+ *
+ * Входные параметры:
+ *  destination: double*  - данные gsl матрицы sizeI x sizeJ
+ *  tda: size_t           - шаг строк gsl матрицы
+ *  source: const double* - данные matlab (элемент (i, j) лежит в source[i + sizeI * j])
+ */
+void transposeDouble(double *destination, size_t tda, const double *source, int sizeI, int sizeJ)
+{
+    uint64_t statsStart = STATS_START();
 
-        // Чуть меняем указатели в зависимости от small data или нет
-        handleIntSequence(destinationArray, &(eInfo->zipData[dataStartIndex + (isSmallData ? 4 : 8)]), byteInInt, expectedSize, isSigned);
+    TRANSPOSE_PARALLEL_FOR
+    for (int i0 = 0; i0 < sizeI; i0 += TRANSPOSE_BLOCK)
+    {
+        int i1 = i0 + TRANSPOSE_BLOCK < sizeI ? i0 + TRANSPOSE_BLOCK : sizeI;
 
-        if (isComplex)
+        for (int j0 = 0; j0 < sizeJ; j0 += TRANSPOSE_BLOCK)
         {
-            // Задаем указатель для комплексной части
-            int dataLengthWithTag = isSmallData ? 8 : 8 + ceil(1. * readFromByteInt32(&(eInfo->zipData[dataStartIndex + 4])) / 8) * 8;
-            complexDataPointer = &(eInfo->zipData[dataStartIndex + dataLengthWithTag]);
+            int j1 = j0 + TRANSPOSE_BLOCK < sizeJ ? j0 + TRANSPOSE_BLOCK : sizeJ;
+            int i = i0;
+            int jVec = j0;
 
-            eInfo->dataDouble = (double *)malloc(sizeof(double) * 2 * expectedSize);
+#if defined(__AVX__)
+            jVec = j0 + (j1 - j0) / 4 * 4;
 
-            for (int i = 0; i < expectedSize; i++)
+            for (; i + 4 <= i1; i += 4)
             {
-                eInfo->dataDouble[i] = (double)(destinationArray[i]);
+                for (int j = j0; j < jVec; j += 4)
+                {
+                    __m256d c0 = _mm256_loadu_pd(&source[i + (size_t)sizeI * j]);
+                    __m256d c1 = _mm256_loadu_pd(&source[i + (size_t)sizeI * (j + 1)]);
+                    __m256d c2 = _mm256_loadu_pd(&source[i + (size_t)sizeI * (j + 2)]);
+                    __m256d c3 = _mm256_loadu_pd(&source[i + (size_t)sizeI * (j + 3)]);
+
+                    __m256d t0 = _mm256_unpacklo_pd(c0, c1);
+                    __m256d t1 = _mm256_unpackhi_pd(c0, c1);
+                    __m256d t2 = _mm256_unpacklo_pd(c2, c3);
+                    __m256d t3 = _mm256_unpackhi_pd(c2, c3);
+
+                    _mm256_storeu_pd(&destination[i * tda + j], _mm256_permute2f128_pd(t0, t2, 0x20));
+                    _mm256_storeu_pd(&destination[(i + 1) * tda + j], _mm256_permute2f128_pd(t1, t3, 0x20));
+                    _mm256_storeu_pd(&destination[(i + 2) * tda + j], _mm256_permute2f128_pd(t0, t2, 0x31));
+                    _mm256_storeu_pd(&destination[(i + 3) * tda + j], _mm256_permute2f128_pd(t1, t3, 0x31));
+                }
+
+                for (int k = i; k < i + 4; k++)
+                    for (int j = jVec; j < j1; j++)
+                        destination[k * tda + j] = source[k + (size_t)sizeI * j];
             }
+#elif defined(__SSE2__)
+            jVec = j0 + (j1 - j0) / 2 * 2;
 
-            free(destinationArray);
-        }
-        else
-        {
-            eInfo->dataInt = destinationArray;
+            for (; i + 2 <= i1; i += 2)
+            {
+                for (int j = j0; j < jVec; j += 2)
+                {
+                    __m128d c0 = _mm_loadu_pd(&source[i + (size_t)sizeI * j]);
+                    __m128d c1 = _mm_loadu_pd(&source[i + (size_t)sizeI * (j + 1)]);
+
+                    _mm_storeu_pd(&destination[i * tda + j], _mm_unpacklo_pd(c0, c1));
+                    _mm_storeu_pd(&destination[(i + 1) * tda + j], _mm_unpackhi_pd(c0, c1));
+                }
+
+                for (int j = jVec; j < j1; j++)
+                {
+                    destination[i * tda + j] = source[i + (size_t)sizeI * j];
+                    destination[(i + 1) * tda + j] = source[i + 1 + (size_t)sizeI * j];
+                }
+            }
+#endif
+
+            // Оставшиеся строки блока
+            for (; i < i1; i++)
+                for (int j = j0; j < j1; j++)
+                    destination[i * tda + j] = source[i + (size_t)sizeI * j];
         }
     }
-    else if (dataTypeCode == 9)
-    {
-        eInfo->dataDouble = (double *)malloc(sizeof(double) * expectedSize * (isComplex ? 2 : 1));
 
-        // Проверка на совпадение размеров
-        if (readFromByteInt32(&(eInfo->zipData[dataStartIndex + 4])) / 8 != expectedSize)
-        {
-            setError(error, "Expected and real data sizes don't match");
-            return;
-        }
+    STATS_ADD(transposeNs, statsStart);
+}
+
+#if defined(__SSE2__)
+/**
+ * Транспонирование блока 4x4 из int32 столбцов matlab в 4 строки
+ */
+static inline void transposeInt4x4(const int *source, int sizeI, int i, int j, __m128i *rows)
+{
+    __m128 c0 = _mm_castsi128_ps(_mm_loadu_si128((const __m128i *)&source[i + (size_t)sizeI * j]));
+    __m128 c1 = _mm_castsi128_ps(_mm_loadu_si128((const __m128i *)&source[i + (size_t)sizeI * (j + 1)]));
+    __m128 c2 = _mm_castsi128_ps(_mm_loadu_si128((const __m128i *)&source[i + (size_t)sizeI * (j + 2)]));
+    __m128 c3 = _mm_castsi128_ps(_mm_loadu_si128((const __m128i *)&source[i + (size_t)sizeI * (j + 3)]));
 
-        handleDoubleSequence(eInfo->dataDouble, &(eInfo->zipData[dataStartIndex + 8]), expectedSize);
+    _MM_TRANSPOSE4_PS(c0, c1, c2, c3);
 
-        // Задаем указатель для комплексной части (будет использован только если она существует)
-        complexDataPointer = &(eInfo->zipData[dataStartIndex + 8 * (expectedSize + 1)]);
-    }
-    else
-    {
-        setError(error, "Unexpected type when reading data sequence");
-        return;
-    }
+    rows[0] = _mm_castps_si128(c0);
+    rows[1] = _mm_castps_si128(c1);
+    rows[2] = _mm_castps_si128(c2);
+    rows[3] = _mm_castps_si128(c3);
+}
+#endif
 
-    // FIXME Временная часть, убрать когда будет переделана обработка элемента
-    if (isComplex)
+/**
+ * Транспонирование int данных в int матрицу gsl (см. transposeDouble)
+ */
+void transposeInt(int *destination, size_t tda, const int *source, int sizeI, int sizeJ)
+{
+    uint64_t statsStart = STATS_START();
+
+    TRANSPOSE_PARALLEL_FOR
+    for (int i0 = 0; i0 < sizeI; i0 += TRANSPOSE_BLOCK)
     {
-        // Проверяем вдруг все воображаемые части чисел записаны в int(лол)
-        dataTypeCode = complexDataPointer[0];
+        int i1 = i0 + TRANSPOSE_BLOCK < sizeI ? i0 + TRANSPOSE_BLOCK : sizeI;
 
-        if (dataTypeCode == 9)
-        {
-            handleDoubleSequence(&(eInfo->dataDouble[expectedSize]), &(complexDataPointer[8]), expectedSize);
-        }
-        else if (dataTypeCode < 7 || dataTypeCode == 12 || dataTypeCode == 13)
+        for (int j0 = 0; j0 < sizeJ; j0 += TRANSPOSE_BLOCK)
         {
-            // Проверяем smalldata или нет
-            int isSmallData = complexDataPointer[2];
+            int j1 = j0 + TRANSPOSE_BLOCK < sizeJ ? j0 + TRANSPOSE_BLOCK : sizeJ;
+            int i = i0;
 
-            int byteInInt = calculateByteSizeFromMatDataCode(dataTypeCode);
+#if defined(__SSE2__)
+            int jVec = j0 + (j1 - j0) / 4 * 4;
 
-            // Создаем буферный массив для переноса в double
-            int64_t *destinationArray = (int64_t *)malloc(sizeof(int64_t) * expectedSize);
+            for (; i + 4 <= i1; i += 4)
+            {
+                for (int j = j0; j < jVec; j += 4)
+                {
+                    __m128i rows[4];
+                    transposeInt4x4(source, sizeI, i, j, rows);
 
-            // Чуть меняем указатели в зависимости от small data или нет
-            handleIntSequence(destinationArray, &(complexDataPointer[isSmallData ? 4 : 8]), byteInInt, expectedSize, isSigned);
+                    for (int r = 0; r < 4; r++)
+                        _mm_storeu_si128((__m128i *)&destination[(i + r) * tda + j], rows[r]);
+                }
 
-            for (int i = 0; i < expectedSize; i++)
-            {
-                eInfo->dataDouble[expectedSize + i] = (double)(destinationArray[i]);
+                for (int k = i; k < i + 4; k++)
+                    for (int j = jVec; j < j1; j++)
+                        destination[k * tda + j] = source[k + (size_t)sizeI * j];
             }
+#endif
 
-            free(destinationArray);
-        }
-        else
-        {
-            setError(error, "unexpected type when reading complex part of data sequence");
-            return;
+            for (; i < i1; i++)
+                for (int j = j0; j < j1; j++)
+                    destination[i * tda + j] = source[i + (size_t)sizeI * j];
         }
     }
+
+    STATS_ADD(transposeNs, statsStart);
 }
 
 /**
- * Обработка int последовательности
+ * Транспонирование комплексной матрицы: в source сначала лежат все действительные части (по столбцам),
+ * затем все мнимые; в gsl действительная и мнимая части каждого элемента идут подряд
  */
-void handleIntSequence(int64_t *destinationArray, unsigned char *intDataInByteSeq, int byteInInt, int size, int isSigned)
+void transposeComplex(double *destination, size_t tda, const double *source, int sizeI, int sizeJ)
 {
-    for (int i = 0; i < size; i++)
+    const double *imagSource = source + (size_t)sizeI * sizeJ;
+    uint64_t statsStart = STATS_START();
+
+    TRANSPOSE_PARALLEL_FOR
+    for (int i0 = 0; i0 < sizeI; i0 += TRANSPOSE_BLOCK)
     {
-        destinationArray[i] = readFromByteWithOffset(&(intDataInByteSeq[i * byteInInt]), byteInInt, isSigned);
+        int i1 = i0 + TRANSPOSE_BLOCK < sizeI ? i0 + TRANSPOSE_BLOCK : sizeI;
+
+        for (int j0 = 0; j0 < sizeJ; j0 += TRANSPOSE_BLOCK)
+        {
+            int j1 = j0 + TRANSPOSE_BLOCK < sizeJ ? j0 + TRANSPOSE_BLOCK : sizeJ;
+
+            for (int j = j0; j < j1; j++)
+            {
+                const double *re = &source[(size_t)sizeI * j];
+                const double *im = &imagSource[(size_t)sizeI * j];
+                int i = i0;
+
+#if defined(__SSE2__)
+                for (; i + 2 <= i1; i += 2)
+                {
+                    __m128d reals = _mm_loadu_pd(&re[i]);
+                    __m128d imags = _mm_loadu_pd(&im[i]);
+
+                    _mm_storeu_pd(&destination[2 * (i * tda + j)], _mm_unpacklo_pd(reals, imags));
+                    _mm_storeu_pd(&destination[2 * ((i + 1) * tda + j)], _mm_unpackhi_pd(reals, imags));
+                }
+#endif
+
+                for (; i < i1; i++)
+                {
+                    destination[2 * (i * tda + j)] = re[i];
+                    destination[2 * (i * tda + j) + 1] = im[i];
+                }
+            }
+        }
     }
+
+    STATS_ADD(transposeNs, statsStart);
 }
 
 /**
- * Обработка double последовательности
+ * Транспонирование single данных в float матрицу gsl (см. transposeDouble), блоки 4x4 через _MM_TRANSPOSE4_PS
  */
-void handleDoubleSequence(double *destinationArray, unsigned char *doubleDataInByteSeq, int size)
+void transposeFloat(float *destination, size_t tda, const float *source, int sizeI, int sizeJ)
 {
-    for (int i = 0; i < size; i++)
+    uint64_t statsStart = STATS_START();
+
+    TRANSPOSE_PARALLEL_FOR
+    for (int i0 = 0; i0 < sizeI; i0 += TRANSPOSE_BLOCK)
     {
-        destinationArray[i] = ((double *)doubleDataInByteSeq)[i];
-    }
-}
+        int i1 = i0 + TRANSPOSE_BLOCK < sizeI ? i0 + TRANSPOSE_BLOCK : sizeI;
 
-/**
- * Разархивировать сжатые данные
- */
-void uncompressElement(IMatError *error, ElmementInfo *eInfo)
-{
-    unsigned char *spaceToUncompress;
+        for (int j0 = 0; j0 < sizeJ; j0 += TRANSPOSE_BLOCK)
+        {
+            int j1 = j0 + TRANSPOSE_BLOCK < sizeJ ? j0 + TRANSPOSE_BLOCK : sizeJ;
+            int i = i0;
+
+#if defined(__SSE2__)
+            int jVec = j0 + (j1 - j0) / 4 * 4;
 
-    int uncompressedSize = eInfo->sizeI < 214748364 ? eInfo->sizeI * 10 : 2147483647;
+            for (; i + 4 <= i1; i += 4)
+            {
+                for (int j = j0; j < jVec; j += 4)
+                {
+                    __m128 c0 = _mm_loadu_ps(&source[i + (size_t)sizeI * j]);
+                    __m128 c1 = _mm_loadu_ps(&source[i + (size_t)sizeI * (j + 1)]);
+                    __m128 c2 = _mm_loadu_ps(&source[i + (size_t)sizeI * (j + 2)]);
+                    __m128 c3 = _mm_loadu_ps(&source[i + (size_t)sizeI * (j + 3)]);
 
-    int result = decompressData(eInfo->zipData, eInfo->sizeI, &spaceToUncompress, &uncompressedSize);
+                    _MM_TRANSPOSE4_PS(c0, c1, c2, c3);
 
-    if (result != Z_OK)
-    {
-        char errStr[80];
-        sprintf(errStr, "Failed to uncompress element, err: %d", result);
-        setError(error, errStr);
-        free(spaceToUncompress);
+                    _mm_storeu_ps(&destination[i * tda + j], c0);
+                    _mm_storeu_ps(&destination[(i + 1) * tda + j], c1);
+                    _mm_storeu_ps(&destination[(i + 2) * tda + j], c2);
+                    _mm_storeu_ps(&destination[(i + 3) * tda + j], c3);
+                }
 
-        return;
+                for (int k = i; k < i + 4; k++)
+                    for (int j = jVec; j < j1; j++)
+                        destination[k * tda + j] = source[k + (size_t)sizeI * j];
+            }
+#endif
+
+            for (; i < i1; i++)
+                for (int j = j0; j < j1; j++)
+                    destination[i * tda + j] = source[i + (size_t)sizeI * j];
+        }
     }
 
-    // Заменяем сжатый элемент на разжатый
-    free(eInfo->zipData);
-    eInfo->zipData = (unsigned char *)malloc(uncompressedSize);
-    memcpy(eInfo->zipData, spaceToUncompress, uncompressedSize);
-    free(spaceToUncompress);
+    STATS_ADD(transposeNs, statsStart);
 }
 
 /**
- * Разархивировать сжатые данные по частям
- *
- * Входные параметры:
- *  compressed_data: const unsigned char* - сжатые данные
- *  compressed_size: int                  - размер сжатых данных
- *  uncompressed_data: unsigned char**    - указатель на выходной буфер
- *  uncompressed_size: int*               - указатель на размер выходного буфера
- *
- * Возвращаемое значение:
- * ret: int - 0 - успех,не 0 - ошибка
+ * Транспонирование комплексной single матрицы (см. transposeComplex)
  */
-int decompressData(const unsigned char *compressed_data, int compressed_size, unsigned char **uncompressed_data, int *uncompressed_size)
+void transposeComplexFloat(float *destination, size_t tda, const float *source, int sizeI, int sizeJ)
 {
-    // Размер буфера
-    const int CHUNK = *uncompressed_size;
-
-    // Очищаем выходный буфер
-    *uncompressed_size = 0;
-    *uncompressed_data = NULL;
-
-    int ret;
-    unsigned have;
-    z_stream strm;
-    unsigned char *out = (unsigned char *)malloc(CHUNK);
-    if (out == NULL)
-    {
-        return Z_MEM_ERROR;
-    }
-
-    // Initialize zlib stream
-    strm.zalloc = Z_NULL;
-    strm.zfree = Z_NULL;
-    strm.opaque = Z_NULL;
-    strm.avail_in = 0;
-    strm.next_in = Z_NULL;
-    ret = inflateInit(&strm);
-    if (ret != Z_OK)
-    {
-        return ret;
-    }
-
-    strm.avail_in = compressed_size;
-    strm.next_in = (unsigned char *)compressed_data;
+    const float *imagSource = source + (size_t)sizeI * sizeJ;
+    uint64_t statsStart = STATS_START();
 
-    // Decompress data
-    do
+    TRANSPOSE_PARALLEL_FOR
+    for (int i0 = 0; i0 < sizeI; i0 += TRANSPOSE_BLOCK)
     {
-        strm.avail_out = CHUNK;
-        strm.next_out = out;
-        ret = inflate(&strm, Z_SYNC_FLUSH);
-        have = CHUNK - strm.avail_out;
+        int i1 = i0 + TRANSPOSE_BLOCK < sizeI ? i0 + TRANSPOSE_BLOCK : sizeI;
 
-        // Reallocate memory for uncompressed data
-        *uncompressed_data = (unsigned char *)realloc(*uncompressed_data, *uncompressed_size + have);
-        if (*uncompressed_data == NULL)
+        for (int j0 = 0; j0 < sizeJ; j0 += TRANSPOSE_BLOCK)
         {
-            return Z_MEM_ERROR;
-        }
+            int j1 = j0 + TRANSPOSE_BLOCK < sizeJ ? j0 + TRANSPOSE_BLOCK : sizeJ;
 
-        // Copy decompressed data to output buffer
-        memcpy(*uncompressed_data + *uncompressed_size, out, have);
-        *uncompressed_size += have;
-    } while (ret == Z_OK);
+            for (int j = j0; j < j1; j++)
+            {
+                const float *re = &source[(size_t)sizeI * j];
+                const float *im = &imagSource[(size_t)sizeI * j];
+                int i = i0;
 
-    // Clean up
-    inflateEnd(&strm);
+#if defined(__SSE2__)
+                for (; i + 4 <= i1; i += 4)
+                {
+                    __m128 reals = _mm_loadu_ps(&re[i]);
+                    __m128 imags = _mm_loadu_ps(&im[i]);
+                    __m128 low = _mm_unpacklo_ps(reals, imags);
+                    __m128 high = _mm_unpackhi_ps(reals, imags);
+
+                    // Каждое комплексное значение - 8 байт в своей строке результата
+                    _mm_storel_pi((__m64 *)&destination[2 * (i * tda + j)], low);
+                    _mm_storeh_pi((__m64 *)&destination[2 * ((i + 1) * tda + j)], low);
+                    _mm_storel_pi((__m64 *)&destination[2 * ((i + 2) * tda + j)], high);
+                    _mm_storeh_pi((__m64 *)&destination[2 * ((i + 3) * tda + j)], high);
+                }
+#endif
 
-    if (ret == Z_STREAM_END || ret == Z_BUF_ERROR)
-    {
-        return Z_OK;
+                for (; i < i1; i++)
+                {
+                    destination[2 * (i * tda + j)] = re[i];
+                    destination[2 * (i * tda + j) + 1] = im[i];
+                }
+            }
+        }
     }
 
-    return ret;
+    STATS_ADD(transposeNs, statsStart);
 }
 
 // Чтение знаковых int
@@ -788,9 +8565,9 @@ uint64_t readFromByteUInt64(unsigned char *byteSeq)
     return num;
 }
 
-int readFromByteUInt32(unsigned char *byteSeq)
+uint32_t readFromByteUInt32(unsigned char *byteSeq)
 {
-    return (int)((byteSeq[3] << 24) | (byteSeq[2] << 16) | (byteSeq[1] << 8) | byteSeq[0]);
+    return ((uint32_t)byteSeq[3] << 24) | ((uint32_t)byteSeq[2] << 16) | ((uint32_t)byteSeq[1] << 8) | byteSeq[0];
 }
 
 int readFromByteUInt16(unsigned char *byteSeq)
@@ -806,24 +8583,6 @@ int readFromByteUInt8(unsigned char *byteSeq)
 /**
  * Читаем из байтовой последовательности
  */
-int64_t readFromByteWithOffset(unsigned char *byteSeq, int byteInInt, int isSigned)
-{
-    switch (byteInInt)
-    {
-    case 1:
-        return isSigned ? readFromByteInt8(byteSeq) : readFromByteUInt8(byteSeq);
-
-    case 2:
-        return isSigned ? readFromByteInt16(byteSeq) : readFromByteUInt16(byteSeq);
-
-    case 4:
-        return isSigned ? readFromByteInt32(byteSeq) : readFromByteUInt32(byteSeq);
-
-    case 8:
-        return isSigned ? readFromByteInt64(byteSeq) : readFromByteUInt64(byteSeq);
-    }
-}
-
 /**
  * @brief Получаем количество байт на хранение одного int числа в зависимости от dataType
  */
@@ -839,7 +8598,9 @@ int calculateByteSizeFromMatDataCode(int dataType)
         return 2;
     case 5:
     case 6:
+    case 7:
         return 4;
+    case 9:
     case 12:
     case 13:
         return 8;
@@ -858,27 +8619,29 @@ int calculateByteSizeFromMatDataCode(int dataType)
 enum EDataTypes decideType(int sizeI, int sizeJ, int isComplex, int typeCode)
 {
     enum EDataTypes dataType;
+    // miDOUBLE и miSINGLE - вещественные данные, остальные коды - целые
+    int isInteger = typeCode != 9 && typeCode != 7;
 
     if (sizeI == 1)
     {
         if (sizeJ == 1)
         {
-            dataType = isComplex ? DT_COMPLEX : (typeCode != 9 ? DT_INT : DT_DOUBLE);
+            dataType = isComplex ? DT_COMPLEX : (isInteger ? DT_INT : DT_DOUBLE);
         }
         else
         {
-            dataType = isComplex ? DT_VECTOR_COMPLEX : (typeCode != 9 ? DT_VECTOR_INT : DT_VECTOR);
+            dataType = isComplex ? DT_VECTOR_COMPLEX : (isInteger ? DT_VECTOR_INT : DT_VECTOR);
         }
     }
     else
     {
         if (sizeJ == 1)
         {
-            dataType = isComplex ? DT_VECTOR_COMPLEX : (typeCode != 9 ? DT_VECTOR_INT : DT_VECTOR);
+            dataType = isComplex ? DT_VECTOR_COMPLEX : (isInteger ? DT_VECTOR_INT : DT_VECTOR);
         }
         else
         {
-            dataType = isComplex ? DT_MATRIX_COMPLEX : (typeCode != 9 ? DT_MATRIX_INT : DT_MATRIX);
+            dataType = isComplex ? DT_MATRIX_COMPLEX : (isInteger ? DT_MATRIX_INT : DT_MATRIX);
         }
     }
 
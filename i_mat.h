@@ -5,8 +5,12 @@
 #include <stdint.h>
 
 #include <gsl/gsl_matrix.h>
+#include <gsl/gsl_spmatrix.h>
 #include <gsl/gsl_vector.h>
 
+// Наибольшее количество размерностей массива
+#define I_MAT_MAX_DIMS 32
+
 /**
  * Структура для отслеживания ошибок при выполнени функции
  *
@@ -19,6 +23,99 @@ typedef struct
     char stringErr[264];
 } IMatError;
 
+/**
+ * Тип данных переменной, определяемый по размерам и коду типа данных
+ */
+enum EDataTypes
+{
+    DT_INT,
+    DT_INT_64,
+    DT_DOUBLE,
+    DT_COMPLEX,
+    DT_VECTOR,
+    DT_VECTOR_INT,
+    DT_VECTOR_COMPLEX,
+    DT_MATRIX,
+    DT_MATRIX_INT,
+    DT_MATRIX_COMPLEX,
+    DT_SPARSE,
+    DT_SPARSE_COMPLEX,
+    DT_VECTOR_FLOAT,
+    DT_VECTOR_COMPLEX_FLOAT,
+    DT_MATRIX_FLOAT,
+    DT_MATRIX_COMPLEX_FLOAT,
+    DT_ARRAY,
+    DT_STRUCT,
+    DT_CELL,
+    DT_EMPTY,
+    DT_UNKNOWN
+};
+
+/**
+ * Запись индекса переменных mat файла
+ *
+ * name: char*            - имя переменной
+ * type: EDataTypes       - тип данных переменной
+ * matClass: int          - класс массива matlab (mxDOUBLE_CLASS = 6 и т.д.)
+ * sizeI: int             - количество строк
+ * sizeJ: int             - количество столбцов
+ * offset: long           - смещение тега элемента от начала файла (-1 для v7.3 файлов)
+ * elementSize: size_t    - размер элемента без тега (0 для v7.3 файлов)
+ * dimsNumber: int        - количество размерностей (2 для чисел, векторов и матриц)
+ * dims: int[]            - размеры; у N-мерного массива (DT_ARRAY) sizeJ - произведение размеров со второго
+ */
+typedef struct
+{
+    char name[64];
+    enum EDataTypes type;
+    int matClass;
+    int sizeI;
+    int sizeJ;
+    long offset;
+    size_t elementSize;
+    int dimsNumber;
+    int dims[I_MAT_MAX_DIMS];
+} IMatVarInfo;
+
+/**
+ * N-мерный массив double одним блоком: элемент (i0, i1, ..., iN-1) лежит в data[i0 * strides[0] + ... + iN-1 * strides[N-1]]
+ *
+ * Страница - матрица dims[0] x dims[1] при фиксированных остальных индексах. Страницы идут подряд в порядке matlab
+ * (третий индекс меняется быстрее четвертого и т.д.), а внутри страницы данные лежат по строкам, как в gsl_matrix:
+ * strides = {dims[1], 1, dims[0] * dims[1], dims[0] * dims[1] * dims[2], ...}
+ *
+ * dimsNumber: int  - количество размерностей (не меньше 2)
+ * dims: size_t[]   - размеры
+ * strides: size_t[] - шаги по размерностям в элементах
+ * data: double*    - данные
+ */
+typedef struct
+{
+    int dimsNumber;
+    size_t dims[I_MAT_MAX_DIMS];
+    size_t strides[I_MAT_MAX_DIMS];
+    double *data;
+} IMatArray;
+
+/**
+ * Алгоритм разжатия данных mat файла
+ *
+ * IB_ZLIB       - потоковый inflate zlib
+ * IB_ZLIB_NG    - потоковый inflate через нативный API zlib-ng (сборка с -DI_MAT_USE_ZLIB_NG вместо zlib)
+ * IB_LIBDEFLATE - элемент разжимается целиком за один вызов libdeflate (сборка с -DI_MAT_USE_LIBDEFLATE)
+ */
+enum EInflateBackend
+{
+    IB_ZLIB,
+    IB_ZLIB_NG,
+    IB_LIBDEFLATE
+};
+
+/**
+ * Открытый mat файл с несколькими переменными
+ */
+typedef struct IMatFile IMatFile;
+
 /**
  * double res = openMatDouble("file.mat", error);
  *
@@ -159,4 +256,697 @@ gsl_matrix_int *openMatMatrixInt(char *filePath, IMatError *error);
  */
 gsl_matrix_complex *openMatMatrixComplex(char *filePath, IMatError *error);
 
+/**
+ * gsl_matrix *res = openMatMatrixColMajor("file.mat", error);
+ *
+ * Чтение matrix double в порядке столбцов matlab, без транспонирования. Результат - gsl матрица
+ * размера sizeJ x sizeI (A^T, в том числе для пустой матрицы), т.е. res->data - столбцы A подряд с ведущей размерностью sizeI,
+ * и его можно передавать в BLAS/LAPACK как column-major матрицу. Элемент A(i, j) - gsl_matrix_get(res, j, i).
+ * Данные разжимаются и декодируются прямо в блок результата, без промежуточного буфера.
+ *
+ * Входные данные:
+ *  filePath: char* - путь к mat файлу
+ *  error: IMatError - структура для отслеживания ошибок
+ *
+ * Возвращаемый параметр:
+ *  res: gsl_matrix* - результат выполнения функции
+ */
+gsl_matrix *openMatMatrixColMajor(char *filePath, IMatError *error);
+
+/**
+ * Чтение matrix int и matrix complex double в порядке столбцов matlab (см. openMatMatrixColMajor)
+ */
+gsl_matrix_int *openMatMatrixIntColMajor(char *filePath, IMatError *error);
+gsl_matrix_complex *openMatMatrixComplexColMajor(char *filePath, IMatError *error);
+
+/**
+ * gsl_matrix_float *res = openMatMatrixFloat("file.mat", error);
+ *
+ * Чтение вектора или матрицы в single precision. Данные miSINGLE (save переменной класса single)
+ * декодируются в float без промежуточного double буфера; double и целые данные приводятся к float при загрузке.
+ * Обратное тоже работает: openMatVector / openMatMatrix* читают single переменные с приведением к double.
+ *
+ * Входные данные:
+ *  filePath: char* - путь к mat файлу
+ *  error: IMatError - структура для отслеживания ошибок
+ *
+ * Возвращаемый параметр:
+ *  res: gsl_matrix_float* - результат выполнения функции
+ */
+gsl_matrix_float *openMatMatrixFloat(char *filePath, IMatError *error);
+gsl_matrix_complex_float *openMatMatrixComplexFloat(char *filePath, IMatError *error);
+gsl_vector_float *openMatVectorFloat(char *filePath, IMatError *error);
+gsl_vector_complex_float *openMatVectorComplexFloat(char *filePath, IMatError *error);
+
+/**
+ * int ok = setMatInflateBackend(IB_ZLIB);
+ *
+ * Выбор алгоритма разжатия для всех последующих чтений. По умолчанию выбран libdeflate, если библиотека
+ * собрана с ним, иначе потоковый inflate. С libdeflate крупные векторы и матрицы разжимаются целиком,
+ * без потокового чтения (I_MAT_STREAM_THRESHOLD не действует).
+ *
+ * Входные данные:
+ *  backend: EInflateBackend - алгоритм разжатия
+ *
+ * Возвращаемый параметр:
+ *  ok: int - 1, если алгоритм собран в библиотеку и выбран, иначе 0
+ */
+int setMatInflateBackend(enum EInflateBackend backend);
+
+/**
+ * Текущий алгоритм разжатия
+ */
+enum EInflateBackend getMatInflateBackend(void);
+
+/**
+ * IMatFile *matFile = openMatFile("file.mat", error);
+ *
+ * Открытие mat файла с несколькими переменными. Теги элементов верхнего уровня
+ * просматриваются один раз, для каждого разжимается только начало (флаги, размеры и имя).
+ * Данные переменных разжимаются только при чтении по имени.
+ * v7.3 (HDF5) файлы открываются, если библиотека собрана с -DI_MAT_USE_HDF5: индекс строится
+ * по датасетам корневой группы.
+ *
+ * Входные данные:
+ *  filePath: char* - путь к mat файлу
+ *  error: IMatError - структура для отслеживания ошибок
+ *
+ * Возвращаемый параметр:
+ *  matFile: IMatFile* - открытый файл, закрывается через closeMatFile
+ */
+IMatFile *openMatFile(char *filePath, IMatError *error);
+
+/**
+ * closeMatFile(matFile);
+ *
+ * Закрытие mat файла и освобождение индекса переменных
+ */
+void closeMatFile(IMatFile *matFile);
+
+/**
+ * int n = getMatFileVarsNumber(matFile);
+ *
+ * Количество переменных в открытом mat файле
+ */
+int getMatFileVarsNumber(IMatFile *matFile);
+
+/**
+ * const IMatVarInfo *info = getMatFileVarInfo(matFile, index);
+ *
+ * Запись индекса переменной по ее номеру в файле (NULL, если номер вне диапазона)
+ */
+const IMatVarInfo *getMatFileVarInfo(IMatFile *matFile, int index);
+
+/**
+ * Чтение переменной по имени из открытого mat файла. Функции можно вызывать для одного файла
+ * из нескольких потоков одновременно
+ *
+ * Входные данные:
+ *  matFile: IMatFile* - открытый mat файл
+ *  name: char* - имя переменной
+ *  error: IMatError - структура для отслеживания ошибок
+ *
+ * Возвращаемый параметр совпадает с соответствующей функцией openMat*
+ */
+int readMatFileInt(IMatFile *matFile, char *name, IMatError *error);
+int64_t readMatFileInt64(IMatFile *matFile, char *name, IMatError *error);
+double readMatFileDouble(IMatFile *matFile, char *name, IMatError *error);
+complex double readMatFileComplex(IMatFile *matFile, char *name, IMatError *error);
+gsl_vector *readMatFileVector(IMatFile *matFile, char *name, IMatError *error);
+gsl_vector_int *readMatFileVectorInt(IMatFile *matFile, char *name, IMatError *error);
+gsl_vector_complex *readMatFileVectorComplex(IMatFile *matFile, char *name, IMatError *error);
+gsl_matrix *readMatFileMatrix(IMatFile *matFile, char *name, IMatError *error);
+gsl_matrix_int *readMatFileMatrixInt(IMatFile *matFile, char *name, IMatError *error);
+gsl_matrix_complex *readMatFileMatrixComplex(IMatFile *matFile, char *name, IMatError *error);
+
+/**
+ * Чтение матрицы по имени из открытого mat файла в порядке столбцов matlab (см. openMatMatrixColMajor)
+ */
+gsl_matrix *readMatFileMatrixColMajor(IMatFile *matFile, char *name, IMatError *error);
+gsl_matrix_int *readMatFileMatrixIntColMajor(IMatFile *matFile, char *name, IMatError *error);
+gsl_matrix_complex *readMatFileMatrixComplexColMajor(IMatFile *matFile, char *name, IMatError *error);
+
+/**
+ * Чтение векторов и матриц в single precision из открытого mat файла (см. openMatMatrixFloat)
+ */
+gsl_vector_float *readMatFileVectorFloat(IMatFile *matFile, char *name, IMatError *error);
+gsl_vector_complex_float *readMatFileVectorComplexFloat(IMatFile *matFile, char *name, IMatError *error);
+gsl_matrix_float *readMatFileMatrixFloat(IMatFile *matFile, char *name, IMatError *error);
+gsl_matrix_complex_float *readMatFileMatrixComplexFloat(IMatFile *matFile, char *name, IMatError *error);
+
+/**
+ * gsl_spmatrix *res = openMatSpMatrix("file.mat", error);
+ *
+ * Чтение sparse матрицы (mxSPARSE_CLASS) в CSC матрицу gsl. Подэлементы ir, jc и pr декодируются
+ * прямо в массивы i, p и data результата без плотной матрицы. Большие элементы (от I_MAT_STREAM_THRESHOLD)
+ * разжимаются порциями, без буфера под весь разжатый элемент. logical sparse читается как матрица из 0 и 1.
+ *
+ * Входные данные:
+ *  filePath: char* - путь к mat файлу
+ *  error: IMatError - структура для отслеживания ошибок
+ *
+ * Возвращаемый параметр:
+ *  res: gsl_spmatrix* - CSC матрица, освобождается через gsl_spmatrix_free
+ */
+gsl_spmatrix *openMatSpMatrix(char *filePath, IMatError *error);
+
+/**
+ * Чтение комплексной (или действительной, с нулевыми мнимыми частями) sparse матрицы в CSC gsl_spmatrix_complex
+ */
+gsl_spmatrix_complex *openMatSpMatrixComplex(char *filePath, IMatError *error);
+
+/**
+ * Чтение sparse матриц из открытого mat файла (см. openMatSpMatrix)
+ */
+gsl_spmatrix *readMatFileSpMatrix(IMatFile *matFile, char *name, IMatError *error);
+gsl_spmatrix_complex *readMatFileSpMatrixComplex(IMatFile *matFile, char *name, IMatError *error);
+
+/**
+ * IMatArray *res = openMatArray("file.mat", error);
+ *
+ * Чтение N-мерного массива (например, 3-D куба) в IMatArray. Страницы транспонируются в порядок строк при
+ * декодировании, поэтому getMatArrayPage возвращает gsl_matrix_view страницы без копирования. Векторы и матрицы
+ * тоже читаются (dimsNumber = 2, одна страница). Комплексные N-мерные массивы не поддерживаются.
+ *
+ * Входные данные:
+ *  filePath: char* - путь к mat файлу
+ *  error: IMatError - структура для отслеживания ошибок
+ *
+ * Возвращаемый параметр:
+ *  res: IMatArray* - массив, освобождается через freeMatArray
+ */
+IMatArray *openMatArray(char *filePath, IMatError *error);
+
+/**
+ * Чтение N-мерного массива по имени из открытого mat файла (см. openMatArray)
+ */
+IMatArray *readMatFileArray(IMatFile *matFile, char *name, IMatError *error);
+
+/**
+ * IMatArray *res = openMatArrayPages("file.mat", "A", page0, pages, error);
+ *
+ * Чтение страниц page0 ... page0 + pages - 1 N-мерного массива (номер страницы - линейный индекс по размерностям
+ * с третьей, с 0). Страницы - непрерывный участок данных matlab, поэтому несжатый v5 элемент читается по смещению,
+ * а сжатый разжимается от ближайшей контрольной точки индекса (см. openMatSubMatrix), остальные страницы не декодируются.
+ *
+ * Входные данные:
+ *  filePath: char*    - путь к mat файлу (v5)
+ *  name: char*        - имя переменной, NULL - первая переменная файла
+ *  page0, pages: int  - первая страница и количество страниц
+ *  error: IMatError   - структура для отслеживания ошибок
+ *
+ * Возвращаемый параметр:
+ *  res: IMatArray* - трехмерный массив dims[0] x dims[1] x pages
+ */
+IMatArray *openMatArrayPages(char *filePath, char *name, int page0, int pages, IMatError *error);
+
+/**
+ * Чтение страниц N-мерного массива из открытого mat файла (см. openMatArrayPages)
+ */
+IMatArray *readMatFileArrayPages(IMatFile *matFile, char *name, int page0, int pages, IMatError *error);
+
+/**
+ * Освобождение массива, прочитанного openMatArray*
+ */
+void freeMatArray(IMatArray *array);
+
+/**
+ * Количество страниц dims[0] x dims[1] массива (произведение размеров с третьей)
+ */
+size_t getMatArrayPagesNumber(const IMatArray *array);
+
+/**
+ * gsl_matrix_view page = getMatArrayPage(array, k);
+ *
+ * Страница k массива как матрица gsl dims[0] x dims[1] без копирования: A(:, :, k) в обозначениях matlab.
+ * Представление действительно, пока массив не освобожден
+ */
+gsl_matrix_view getMatArrayPage(IMatArray *array, size_t page);
+
+/**
+ * Узел дерева struct или cell переменной (см. openMatTree)
+ *
+ * name: char[64]         - имя поля struct (у корня - имя переменной, у элемента cell массива - пустая строка)
+ * type: EDataTypes       - DT_STRUCT, DT_CELL или тип, в котором можно прочитать лист через readMatNode
+ * matClass: int          - класс массива matlab (1 - cell, 2 - struct, 3 - object, 6 - double и т.д.)
+ * dimsNumber: int        - количество размерностей
+ * dims: int[]            - размеры
+ * offset: size_t         - смещение miMATRIX подэлемента (вместе с тегом) в разжатых данных переменной
+ * length: size_t         - длина подэлемента вместе с тегом
+ * fieldsNumber: int      - количество полей struct (0 для остальных узлов)
+ * fieldNames: char**     - имена полей struct, общие для всех элементов struct массива
+ * childrenNumber: int    - количество дочерних узлов: элементы * поля для struct, элементы для cell
+ * children: IMatNode*    - дочерние узлы, поле f элемента k struct массива - children[k * fieldsNumber + f]
+ */
+typedef struct IMatNode
+{
+    char name[64];
+    enum EDataTypes type;
+    int matClass;
+    int dimsNumber;
+    int dims[I_MAT_MAX_DIMS];
+    size_t offset;
+    size_t length;
+    int fieldsNumber;
+    char **fieldNames;
+    int childrenNumber;
+    struct IMatNode *children;
+} IMatNode;
+
+/**
+ * Разобранная struct или cell переменная: разжатые данные и дерево узлов над ними
+ */
+typedef struct IMatTree IMatTree;
+
+/**
+ * IMatTree *tree = openMatTree("file.mat", error);
+ *
+ * Разбор struct или cell переменной в дерево полей и элементов. Переменная разжимается один раз, но декодируются
+ * только заголовки вложенных массивов (имена полей, класс, размеры, положение в данных). Числовые листья
+ * декодируются при обращении через readMatNode, остальные поля не конвертируются.
+ *
+ * Входные данные:
+ *  filePath: char* - путь к mat файлу (v5)
+ *  error: IMatError - структура для отслеживания ошибок
+ *
+ * Возвращаемый параметр:
+ *  tree: IMatTree* - дерево переменной, освобождается через freeMatTree
+ */
+IMatTree *openMatTree(char *filePath, IMatError *error);
+
+/**
+ * Разбор struct или cell переменной по имени из открытого mat файла (см. openMatTree), NULL - первая переменная
+ */
+IMatTree *readMatFileTree(IMatFile *matFile, char *name, IMatError *error);
+
+/**
+ * Освобождение дерева вместе с разжатыми данными. Прочитанные через readMatNode результаты остаются действительными
+ */
+void freeMatTree(IMatTree *tree);
+
+/**
+ * Корень дерева - сама переменная
+ */
+const IMatNode *getMatTreeRoot(const IMatTree *tree);
+
+/**
+ * const IMatNode *node = getMatNodeField(parent, index, "field");
+ *
+ * Поле field элемента index (с 0, в порядке matlab) struct массива. NULL, если parent не struct,
+ * такого поля нет или индекс вне массива
+ */
+const IMatNode *getMatNodeField(const IMatNode *node, int index, const char *field);
+
+/**
+ * Элемент index (с 0, в порядке matlab) cell массива. NULL, если node не cell или индекс вне массива
+ */
+const IMatNode *getMatNodeCell(const IMatNode *node, int index);
+
+/**
+ * const IMatNode *node = findMatNode(tree, "solver.stages(2).coeffs{3}");
+ *
+ * Поиск узла по пути в обозначениях matlab от корня: .field - поле, (k) - элемент struct массива,
+ * {k} - элемент cell массива, индексы с 1. Без индекса берется первый элемент struct массива. NULL, если узла нет
+ */
+const IMatNode *findMatNode(const IMatTree *tree, const char *path);
+
+/**
+ * readMatNode(tree, node, DT_MATRIX, &matrix, error);
+ *
+ * Декодирование листа дерева, только при вызове и только этого листа
+ *
+ * Входные данные:
+ *  tree: IMatTree*        - дерево, которому принадлежит узел
+ *  node: const IMatNode*  - лист (не struct и не cell)
+ *  type: EDataTypes       - ожидаемый тип результата (DT_INT ... DT_ARRAY)
+ *  destination: void*     - куда записать результат, как в IMatBatchItem: double* для DT_DOUBLE, gsl_matrix** для DT_MATRIX и т.д.
+ *  error: IMatError       - структура для отслеживания ошибок
+ */
+void readMatNode(IMatTree *tree, const IMatNode *node, enum EDataTypes type, void *destination, IMatError *error);
+
+/**
+ * gsl_matrix *block = openMatSubMatrix("file.mat", "A", row0, rows, col0, cols, error);
+ *
+ * Чтение прямоугольной области A(row0 : row0 + rows - 1, col0 : col0 + cols - 1) матрицы (индексы с 0).
+ * Для v7.3 файлов читаются и разжимаются только чанки датасета, которые пересекают область.
+ * Несжатый v5 элемент читается по смещениям столбцов. Для сжатого v5 элемента при первом чтении строится
+ * индекс контрольных точек потока (каждые I_MAT_CHECKPOINT_SPAN байт, 16 MB по умолчанию), и дальше
+ * разжимаются только участки от ближайших точек до нужных столбцов. Индекс хранится до closeMatFile,
+ * поэтому повторные чтения через readMatFileSubMatrix его не строят.
+ *
+ * Входные данные:
+ *  filePath: char*  - путь к mat файлу
+ *  name: char*      - имя переменной, NULL - первая переменная файла
+ *  row0, rows: int  - первая строка и количество строк
+ *  col0, cols: int  - первый столбец и количество столбцов
+ *  error: IMatError - структура для отслеживания ошибок
+ *
+ * Возвращаемый параметр:
+ *  block: gsl_matrix* - матрица rows x cols
+ */
+gsl_matrix *openMatSubMatrix(char *filePath, char *name, int row0, int rows, int col0, int cols, IMatError *error);
+
+/**
+ * Чтение прямоугольной области матрицы из открытого mat файла (см. openMatSubMatrix)
+ */
+gsl_matrix *readMatFileSubMatrix(IMatFile *matFile, char *name, int row0, int rows, int col0, int cols, IMatError *error);
+
+/**
+ * Поток столбцов матрицы (см. openMatColumnStream)
+ */
+typedef struct IMatColumnStream IMatColumnStream;
+
+/**
+ * IMatColumnStream *stream = openMatColumnStream("file.mat", "A", blockColumns, error);
+ *
+ * Последовательное чтение матрицы по столбцам с памятью, ограниченной размером блока. Элемент v5 файла читается
+ * из файла (pread) и разжимается порциями по мере продвижения по столбцам, столбцы декодируются в double блоками
+ * по blockColumns. В памяти одновременно только блок, порция сжатых данных и состояние zlib, поэтому так можно
+ * обработать матрицу больше оперативной памяти. Возвращаться к прочитанным столбцам нельзя. N-мерный массив
+ * читается как матрица dims[0] x (произведение остальных размеров). Комплексные матрицы и v7.3 файлы
+ * не поддерживаются.
+ *
+ * Входные данные:
+ *  filePath: char*    - путь к mat файлу (v5)
+ *  name: char*        - имя переменной, NULL - первая переменная файла
+ *  blockColumns: int  - количество столбцов в блоке, 0 - столько, чтобы блок занимал около 256 KB
+ *  error: IMatError   - структура для отслеживания ошибок
+ *
+ * Возвращаемый параметр:
+ *  stream: IMatColumnStream* - поток, закрывается через closeMatColumnStream
+ */
+IMatColumnStream *openMatColumnStream(char *filePath, char *name, int blockColumns, IMatError *error);
+
+/**
+ * Поток столбцов переменной открытого mat файла (см. openMatColumnStream). Файл не должен закрываться раньше потока,
+ * несколько потоков одного файла можно читать из разных потоков выполнения
+ */
+IMatColumnStream *readMatFileColumnStream(IMatFile *matFile, char *name, int blockColumns, IMatError *error);
+
+/**
+ * while (nextMatColumn(stream, &column, error)) { ... }
+ *
+ * Следующий столбец матрицы. Вид указывает на блок потока и действителен до следующего вызова nextMatColumn
+ * или nextMatColumns. После ошибки поток считается законченным.
+ *
+ * Входные данные:
+ *  stream: IMatColumnStream* - поток
+ *  column: gsl_vector_view*  - вид столбца (sizeI значений)
+ *  error: IMatError          - структура для отслеживания ошибок
+ *
+ * Возвращаемый параметр: 1 - столбец прочитан, 0 - столбцы закончились или ошибка
+ */
+int nextMatColumn(IMatColumnStream *stream, gsl_vector_view *column, IMatError *error);
+
+/**
+ * Следующий блок столбцов (не больше blockColumns): строка k вида - столбец k блока, то есть блок возвращается
+ * в порядке столбцов matlab, как в openMatMatrixColMajor. Вид действителен до следующего вызова.
+ *
+ * Возвращаемый параметр: количество столбцов в блоке, 0 - столбцы закончились или ошибка
+ */
+int nextMatColumns(IMatColumnStream *stream, gsl_matrix_view *block, IMatError *error);
+
+/**
+ * Размеры матрицы потока: sizeI - строк (длина столбца), sizeJ - столбцов
+ */
+void getMatColumnStreamSize(const IMatColumnStream *stream, int *sizeI, int *sizeJ);
+
+/**
+ * Закрытие потока столбцов (и файла, если поток открыт openMatColumnStream)
+ */
+void closeMatColumnStream(IMatColumnStream *stream);
+
+/**
+ * setMatIndexSidecar(1);
+ *
+ * Сохранение индексов контрольных точек в файлы-спутники "<файл>.<переменная>.zidx" рядом с mat файлом,
+ * чтобы индекс не строился заново в следующих запусках. Индекс из файла-спутника используется, только если
+ * размер и время изменения mat файла не поменялись. По умолчанию выключено.
+ *
+ * Входные данные:
+ *  isEnabled: int - 1 - читать и сохранять файлы-спутники, 0 - держать индексы только в памяти
+ */
+void setMatIndexSidecar(int isEnabled);
+
+/**
+ * setMatCacheDir("/var/cache/i_mat", 4ull << 30);
+ *
+ * Кэш декодированных векторов и матриц на диске. Результат openMatVector*, openMatMatrix* и readMatFile*
+ * сохраняется в каталоге кэша в раскладке gsl структуры, и следующее чтение той же переменной читает его
+ * одним блоком, без разжатия, декодирования и транспонирования. Ключ - путь, размер, время изменения и inode
+ * mat файла, имя переменной и тип результата, поэтому измененный файл читается заново.
+ * Когда кэш больше maxBytes, удаляются записи, к которым дольше всего не обращались.
+ * Вызывается до чтений, по умолчанию кэш выключен.
+ *
+ * Входные данные:
+ *  dirPath: const char* - существующий каталог кэша, NULL - выключить кэш
+ *  maxBytes: size_t     - предельный размер кэша в байтах, 0 - без ограничения
+ */
+void setMatCacheDir(const char *dirPath, size_t maxBytes);
+
+/**
+ * Функции выделения памяти для IMatReader (например, поверх арены или пула)
+ *
+ * allocate: void *(*)(void *opaque, size_t size) - выделение блока, NULL при нехватке памяти
+ * release: void (*)(void *opaque, void *data)     - освобождение блока, выделенного allocate
+ * opaque: void*                                   - передается в обе функции
+ */
+typedef struct
+{
+    void *(*allocate)(void *opaque, size_t size);
+    void (*release)(void *opaque, void *data);
+    void *opaque;
+} IMatAllocator;
+
+/**
+ * Контекст чтения с переиспользуемыми z_stream и буферами (см. createMatReader)
+ */
+typedef struct IMatReader IMatReader;
+
+/**
+ * IMatReader *reader = createMatReader(&allocator);
+ *
+ * Создание контекста чтения. Контекст хранит z_stream (сбрасывается через inflateReset вместо inflateInit/inflateEnd
+ * на каждое чтение), декомпрессор libdeflate и буферы для прочитанного элемента, разжатых данных, порций потокового
+ * разжатия и промежуточных массивов декодирования. Буферы растут до размера самой большой прочитанной переменной
+ * и освобождаются только в freeMatReader, поэтому повторные openMat* и readMatFile* не выделяют их заново.
+ * Буферы и внутреннее состояние zlib выделяются через allocator, результаты (gsl структуры) - как обычно.
+ *
+ * Входные данные:
+ *  allocator: const IMatAllocator* - функции выделения памяти (копируются), NULL - malloc и free
+ *
+ * Возвращаемый параметр:
+ *  reader: IMatReader* - контекст, освобождается через freeMatReader
+ */
+IMatReader *createMatReader(const IMatAllocator *allocator);
+
+/**
+ * Освобождение контекста и его буферов. Если контекст привязан к вызывающему потоку, привязка снимается
+ */
+void freeMatReader(IMatReader *reader);
+
+/**
+ * setMatReader(reader);
+ *
+ * Привязка контекста к вызывающему потоку: openMat* и readMatFile* этого потока используют его z_stream и буферы.
+ * Контекст не разделяется между потоками - каждому потоку нужен свой. Потоки openMatBatch и readMatFileBatch
+ * работают без контекста.
+ *
+ * Входные данные:
+ *  reader: IMatReader* - контекст, NULL - снять привязку
+ */
+void setMatReader(IMatReader *reader);
+
+/**
+ * Статистика одного чтения переменной (см. setMatStatsCallback)
+ *
+ * filePath: const char*      - путь к mat файлу (действителен только внутри обработчика)
+ * name: const char*          - имя переменной, NULL для openMat*
+ * isErr: int                 - чтение закончилось ошибкой (в том числе несовпадением типа переменной)
+ * isCached: int              - результат взят из кэша (setMatCacheDir), стадии не выполнялись
+ * compressedBytes: size_t    - размер элемента в файле вместе с тегом
+ * uncompressedBytes: size_t  - размер разжатого элемента (для несжатого - compressedBytes)
+ * readNs: uint64_t           - открытие файла и чтение (или отображение в память) элемента
+ * inflateNs: uint64_t        - разжатие
+ * decodeNs: uint64_t         - разбор элемента, перевод данных в тип результата и сборка gsl структуры
+ * transposeNs: uint64_t      - транспонирование из порядка matlab в порядок gsl
+ * totalNs: uint64_t          - все чтение, включая то, что не попало в стадии
+ * allocationsNumber: int     - выделения памяти библиотекой: буферы, состояние zlib, результат
+ * peakScratchBytes: size_t   - наибольший суммарный размер одновременно занятых промежуточных буферов
+ * matClass: int              - класс массива matlab (mxDOUBLE_CLASS = 6 и т.д.), 0 - не определен
+ * dimsNumber: int            - количество размерностей
+ * dims: int[]                - размеры
+ */
+typedef struct
+{
+    const char *filePath;
+    const char *name;
+    int isErr;
+    int isCached;
+    size_t compressedBytes;
+    size_t uncompressedBytes;
+    uint64_t readNs;
+    uint64_t inflateNs;
+    uint64_t decodeNs;
+    uint64_t transposeNs;
+    uint64_t totalNs;
+    int allocationsNumber;
+    size_t peakScratchBytes;
+    int matClass;
+    int dimsNumber;
+    int dims[I_MAT_MAX_DIMS];
+} IMatStats;
+
+/**
+ * Обработчик статистики: вызывается в потоке, который читал переменную, после каждого openMat* и readMatFile*
+ */
+typedef void (*IMatStatsCallback)(const IMatStats *stats, void *opaque);
+
+/**
+ * setMatStatsCallback(exportStats, metrics);
+ *
+ * Сбор статистики чтений: openMat* и readMatFile* (в том числе внутри openMatBatch, readMatFileBatch и openMatAsync)
+ * замеряют свои стадии и передают IMatStats в callback. Без обработчика чтение проверяет только один указатель на
+ * стадию, время не замеряется. При отображении файла в память (mmap) страницы читаются с диска при первом
+ * обращении, поэтому это время попадает в inflate или decode, а не в read. При потоковом разжатии больших
+ * переменных перестановка в порядок gsl совмещена с декодированием и входит в decodeNs. У v7.3 файлов
+ * заполняются только общее время, ошибка и кэш. Вызывается до чтений, по умолчанию выключено.
+ *
+ * Входные данные:
+ *  callback: IMatStatsCallback - обработчик, NULL - выключить сбор
+ *  opaque: void*               - передается в callback
+ */
+void setMatStatsCallback(IMatStatsCallback callback, void *opaque);
+
+/**
+ * Запрос на чтение одной переменной для openMatBatch
+ *
+ * filePath: char*      - путь к mat файлу
+ * name: char*          - имя переменной, NULL - единственная переменная файла (как в openMat*)
+ * type: EDataTypes     - ожидаемый тип результата (DT_INT ... DT_ARRAY)
+ * destination: void*   - куда записать результат: int*, int64_t*, double*, complex double* для чисел,
+ *                        gsl_vector**, gsl_matrix_int**, gsl_spmatrix**, gsl_matrix_float**, IMatArray** и т.д. для gsl структур
+ * error: IMatError     - результат чтения этой переменной (заполняется openMatBatch)
+ */
+typedef struct
+{
+    char *filePath;
+    char *name;
+    enum EDataTypes type;
+    void *destination;
+    IMatError error;
+} IMatBatchItem;
+
+/**
+ * int errorsNumber = openMatBatch(items, itemsNumber, threadsNumber);
+ *
+ * Чтение набора переменных (из одного или разных файлов) на пуле потоков.
+ * Запросы независимы: ошибка одного не прерывает остальные и записывается в его поле error.
+ *
+ * Входные данные:
+ *  items: IMatBatchItem* - массив запросов
+ *  itemsNumber: int      - количество запросов
+ *  threadsNumber: int    - количество потоков, 0 - по количеству процессоров
+ *
+ * Возвращаемый параметр:
+ *  errorsNumber: int - количество запросов, завершившихся ошибкой
+ */
+int openMatBatch(IMatBatchItem *items, int itemsNumber, int threadsNumber);
+
+/**
+ * int errorsNumber = readMatFileBatch(matFile, items, itemsNumber, threadsNumber);
+ *
+ * Параллельное чтение нескольких переменных одного открытого mat файла: каждая переменная - отдельный
+ * zlib поток, поэтому они разжимаются и декодируются на разных потоках одновременно. Поле filePath
+ * запросов не используется, name обязательно. Результаты записываются в destination каждого запроса,
+ * так что порядок результатов совпадает с порядком запросов (для всех переменных файла в порядке
+ * getMatFileVarInfo - в порядке файла).
+ *
+ * Входные данные:
+ *  matFile: IMatFile*    - открытый mat файл
+ *  items: IMatBatchItem* - массив запросов
+ *  itemsNumber: int      - количество запросов
+ *  threadsNumber: int    - количество потоков, 0 - по количеству процессоров
+ *
+ * Возвращаемый параметр:
+ *  errorsNumber: int - количество запросов, завершившихся ошибкой
+ */
+int readMatFileBatch(IMatFile *matFile, IMatBatchItem *items, int itemsNumber, int threadsNumber);
+
+/**
+ * Фоновая загрузка одной переменной (см. openMatAsync)
+ */
+typedef struct IMatAsync IMatAsync;
+
+/**
+ * Функция, которую фоновый поток вызывает после загрузки: результат уже записан в item->destination, ошибка - в item->error
+ */
+typedef void (*IMatAsyncCallback)(IMatBatchItem *item, void *opaque);
+
+/**
+ * IMatAsync *request = openMatAsync(&item, callback, opaque);
+ *
+ * Загрузка переменной в фоне: элемент переменной находится по заголовку и тегам файла и читается в память только он
+ * (через io_uring при сборке с -DI_MAT_USE_URING, иначе или если io_uring недоступен - в фоновом потоке), затем
+ * переменная разжимается и декодируется в том же фоновом потоке. Чтение через io_uring ставится в очередь сразу
+ * в openMatAsync, поэтому следующий файл читается с диска, пока вызывающий поток работает с текущим.
+ * Запрос описывается как в openMatBatch: filePath, name (NULL - единственная переменная файла), type и destination.
+ * item должен существовать до waitMatAsync. v7.3 файлы читаются в фоновом потоке обычным путем.
+ * При сборке с -DI_MAT_NO_THREADS переменная загружается сразу в openMatAsync.
+ *
+ * Входные данные:
+ *  item: IMatBatchItem*        - запрос
+ *  callback: IMatAsyncCallback - вызывается в фоновом потоке после загрузки, NULL - не вызывать
+ *  opaque: void*               - передается в callback
+ *
+ * Возвращаемый параметр:
+ *  request: IMatAsync* - запрос, освобождается через waitMatAsync (NULL при нехватке памяти)
+ */
+IMatAsync *openMatAsync(IMatBatchItem *item, IMatAsyncCallback callback, void *opaque);
+
+/**
+ * Проверка без ожидания: 1 - загрузка (вместе с callback) закончена, 0 - еще идет
+ */
+int pollMatAsync(IMatAsync *request);
+
+/**
+ * int isErr = waitMatAsync(request);
+ *
+ * Ожидание окончания загрузки и освобождение запроса. Вызывается для каждого openMatAsync, в том числе
+ * после того, как pollMatAsync вернул 1
+ *
+ * Возвращаемый параметр:
+ *  isErr: int - 1, если загрузка закончилась ошибкой (текст в item->error)
+ */
+int waitMatAsync(IMatAsync *request);
+
+// Уровень сжатия для saveMat*: 1..9 - как в zlib, I_MAT_COMPRESSION_NONE - элемент записывается без сжатия (как save -v6)
+#define I_MAT_COMPRESSION_DEFAULT -1
+#define I_MAT_COMPRESSION_NONE 0
+
+/**
+ * saveMatMatrix("A.mat", "A", matrix, I_MAT_COMPRESSION_DEFAULT, error);
+ *
+ * Запись mat файла (v5/v7) с одной переменной, который читается openMat* и MATLAB. Целые значения
+ * записываются как int32 (int64 для saveMatInt64), векторы - как столбцы, матрицы - в порядке столбцов matlab.
+ * Большие переменные сжимаются блоками на пуле потоков в один zlib поток. Существующий файл перезаписывается.
+ *
+ * Входные данные:
+ *  filePath: char*  - путь к mat файлу
+ *  name: char*      - имя переменной (до 63 символов)
+ *  value / vector / matrix - записываемое значение
+ *  level: int       - уровень сжатия (I_MAT_COMPRESSION_DEFAULT, 1..9 или I_MAT_COMPRESSION_NONE)
+ *  error: IMatError - структура для отслеживания ошибок
+ */
+void saveMatInt(char *filePath, char *name, int value, int level, IMatError *error);
+void saveMatInt64(char *filePath, char *name, int64_t value, int level, IMatError *error);
+void saveMatDouble(char *filePath, char *name, double value, int level, IMatError *error);
+void saveMatComplex(char *filePath, char *name, complex double value, int level, IMatError *error);
+void saveMatVector(char *filePath, char *name, const gsl_vector *vector, int level, IMatError *error);
+void saveMatVectorInt(char *filePath, char *name, const gsl_vector_int *vector, int level, IMatError *error);
+void saveMatVectorComplex(char *filePath, char *name, const gsl_vector_complex *vector, int level, IMatError *error);
+void saveMatMatrix(char *filePath, char *name, const gsl_matrix *matrix, int level, IMatError *error);
+void saveMatMatrixInt(char *filePath, char *name, const gsl_matrix_int *matrix, int level, IMatError *error);
+void saveMatMatrixComplex(char *filePath, char *name, const gsl_matrix_complex *matrix, int level, IMatError *error);
+
 #endif // I_MAT_H_
\ No newline at end of file